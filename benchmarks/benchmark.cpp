@@ -15,13 +15,10 @@
 #include <iostream>
 #include <fstream>
 
-// measuring time
-#include <chrono>
-
 // tie
 #include <tuple>
 
-// table printing
+// std::vector
 #include <vector>
 
 // std::set
@@ -30,6 +27,22 @@
 // AgAVLTree
 #include "AgAVLTree.h"
 
+// Timer, table and format_integer
+#include "benchmark_utils.h"
+
+// name under which the results of AgAVLTree are reported (the no_pool build allocates every node with new)
+// the compact build links nodes by 32-bit indices instead of pointers
+#if defined (AG_AVL_BENCH_COMPACT)
+using       tree_t                          = AgAVLTreeCompact<int32_t>;
+constexpr   const char *    treeName        = "AgAVLTree (compact)";
+#elif defined (AG_AVL_NO_POOL)
+using       tree_t                          = AgAVLTree<int32_t>;
+constexpr   const char *    treeName        = "AgAVLTree (new)";
+#else
+using       tree_t                          = AgAVLTree<int32_t>;
+constexpr   const char *    treeName        = "AgAVLTree";
+#endif
+
 // ┌─┬─┐
 // │ │ │
 // ├─┼─┤
@@ -46,139 +59,6 @@
 
 // constexpr   wchar_t     crossLine       = '┼';
 
-struct Timer {
-
-    private:
-
-    std::chrono::high_resolution_clock::time_point      mStart;
-    std::chrono::high_resolution_clock::time_point      mEnd;
-
-    public:
-
-    Timer ()
-    {
-        reset ();
-    }
-
-    int64_t
-    elapsed ()
-    {
-        mEnd        = std::chrono::high_resolution_clock::now ();
-        auto diff   = std::chrono::duration_cast<std::chrono::milliseconds> (mEnd - mStart).count ();
-
-        return diff;
-    }
-
-    void
-    reset ()
-    {
-        mStart      = std::chrono::high_resolution_clock::now ();
-    }
-};
-
-struct table {
-
-    private:
-
-    std::vector<std::string>                mHeaders;
-    std::vector<std::vector<std::string>>   mRows;
-
-    public:
-
-    table ()
-    {}
-
-    void
-    add_headers (std::initializer_list<std::string> pHeaders)
-    {
-        if (pHeaders.size () == 0)
-        {
-            std::cout << "ZERO COLOUMNS NOT ALLOWED IN TABLE\n";
-            std::exit (1);
-        }
-        mHeaders            = pHeaders;
-    }
-
-    void
-    add_row (std::initializer_list<std::string> pElems)
-    {
-        if (pElems.size () != mHeaders.size ())
-        {
-            std::cout << "NUMBER OF COLOUMNS IN ROW MUST MATCH NUMBER OF COLOUMNS IN HEADER\n";
-            std::exit (1);
-        }
-
-        mRows.push_back (pElems);
-    }
-
-    friend std::ostream
-    &operator<< (std::ostream &stream, const table &pOther)
-    {
-        int32_t                 cols    = (int32_t)pOther.mHeaders.size ();
-        int32_t                 width   = 0;
-
-        std::vector<int32_t>    sz (cols);
-
-        for(int32_t col = 0; col < cols; ++col) {
-            sz[col] = (int32_t)pOther.mHeaders[col].size ();
-        }
-
-        for (auto &e : pOther.mRows) {
-            for (int32_t col = 0; col < cols; ++col) {
-
-                sz[col] = std::max (sz[col], (int32_t)e[col].size ());
-            }
-        }
-
-        for (auto &e : sz) {
-            e       += 4;
-            width   += e;
-        }
-
-        // print the headers
-        for (int32_t i = 0; i < width; ++i) {
-            stream << '-';
-        }
-        stream << '-' << '\n';
-
-        for (int32_t i = 0; i < cols; ++i) {
-            stream << "| ";
-            stream << pOther.mHeaders[i];
-            for (int32_t pad = (int32_t)pOther.mHeaders[i].size () + 2; pad < sz[i]; ++pad) {
-                stream << ' ';
-            }
-        }
-        stream << '|' << '\n';
-
-        for (int32_t i = 0; i < width; ++i) {
-            stream << '-';
-        }
-        stream << '-' << '\n';
-
-        for (auto &row : pOther.mRows) {
-            for (int32_t i = 0; i < cols; ++i) {
-                stream << "| ";
-                stream << row[i];
-                for (int32_t pad = (int32_t)row[i].size () + 2; pad < sz[i]; ++pad) {
-                    stream << ' ';
-                }
-            }
-            stream << '|' << '\n';
-        }
-
-        if (pOther.mRows.size () == 0) {
-            return stream;
-        }
-
-        for (int32_t i = 0; i < width; ++i) {
-            stream << '-';
-        }
-        stream << '-' << '\n';
-
-        return stream;
-    }
-};
-
 bool
 streq (const char *pA, const char *pB)
 {
@@ -197,41 +77,8 @@ streq (const char *pA, const char *pB)
     return true;
 }
 
-template <typename T>
-std::string
-format_integer (T pNum)
-{
-
-    T           cpy {pNum};
-    int32_t     len {};
-
-    std::string res;
-
-    if(pNum == 0) {
-        return "0";
-    }
-
-    while (cpy) {
-        ++len, cpy /= 10;
-    }
-
-    for (int32_t i = 0, d; i < len; ++i) {
-
-        d = pNum % 10;
-        pNum /= 10;
-
-        res += (char) (d + '0');
-        if (i % 3 == 2 && i != len - 1) {
-            res += ',';
-        }
-    }
-
-    for (auto i = 0; i < (int32_t)(res.size () / 2); ++i) {
-        std::swap (res[i], res[res.size () - i - 1]);
-    }
-
-    return res;
-}
+// number of records given to each call of insert_batch
+constexpr   int32_t         batchSize       = 65'536;
 
 int32_t     *buffInsert;
 int32_t     *buffFind;
@@ -297,8 +144,8 @@ run_benchmark (int pN)
     std::set<int32_t>               tree1;
     std::set<int32_t>::iterator     it1;
 
-    AgAVLTree<int32_t>              tree2;
-    AgAVLTree<int32_t>::iterator    it2;
+    tree_t                          tree2;
+    tree_t::iterator                it2;
 
     Timer                           timer;
     int64_t                         measured;
@@ -336,7 +183,42 @@ run_benchmark (int pN)
         cntr                        += flag;
     }
     measured = timer.elapsed ();
-    results.add_row ({"Insertion", "AgAVLTree", format_integer (cntr), format_integer (measured)});
+    results.add_row ({"Insertion", treeName, format_integer (cntr), format_integer (measured)});
+
+    // insert the same records into another tree in batches, which are each sorted and merged into the tree at once
+    {
+        tree_t                      tree3;
+
+        cntr = 0;
+        timer.reset ();
+        for (auto i = 0; i < pN; i += batchSize) {
+            cntr                    += (int32_t)tree3.insert_batch (buffInsert + i, buffInsert + std::min (pN, i + batchSize));
+        }
+        measured = timer.elapsed ();
+        results.add_row ({"Batch ins.", treeName, format_integer (cntr), format_integer (measured)});
+    }
+
+    // insert the same records into other trees, each with a hint of end () (which is right whenever a record is greater than all before it)
+    {
+        std::set<int32_t>           tree3;
+
+        timer.reset ();
+        for (auto i = 0; i < pN; ++i) {
+            tree3.insert (tree3.end (), buffInsert[i]);
+        }
+        measured = timer.elapsed ();
+        results.add_row ({"Hinted ins.", "std::set", format_integer ((int32_t)tree3.size ()), format_integer (measured)});
+    }
+    {
+        tree_t                      tree3;
+
+        timer.reset ();
+        for (auto i = 0; i < pN; ++i) {
+            tree3.insert (tree3.end (), buffInsert[i]);
+        }
+        measured = timer.elapsed ();
+        results.add_row ({"Hinted ins.", treeName, format_integer ((int32_t)tree3.size ()), format_integer (measured)});
+    }
 
 
     cntr = 0;
@@ -355,7 +237,45 @@ run_benchmark (int pN)
         cntr                        += (int32_t)(it2 != tree2.end ());
     }
     measured = timer.elapsed ();
-    results.add_row ({"Find", "AgAVLTree", format_integer (cntr), format_integer (measured)});
+    results.add_row ({"Find", treeName, format_integer (cntr), format_integer (measured)});
+
+    // find the same records in batches, where the searches of each batch go down the tree side by side
+    {
+        std::vector<uint8_t>        found   (batchSize);
+
+        cntr = 0;
+        timer.reset ();
+        for (auto i = 0; i < pN; i += batchSize) {
+            auto last               = tree2.exists_batch (buffFind + i, buffFind + std::min (pN, i + batchSize), found.begin ());
+            for (auto it = found.begin (); it != last; ++it) {
+                cntr                += *it;
+            }
+        }
+        measured = timer.elapsed ();
+        results.add_row ({"Batch find", treeName, format_integer (cntr), format_integer (measured)});
+    }
+
+
+    // erase and immediately re-insert each record, so that the size of the tree stays the same while nodes are freed and allocated
+    cntr = 0;
+    timer.reset ();
+    for (auto i = 0; i < pN; ++i) {
+        flag                        = (int32_t)tree1.erase (buffErase[i]);
+        tree1.insert (buffErase[i]);
+        cntr                        += flag;
+    }
+    measured    = timer.elapsed ();
+    results.add_row ({"Churn", "std::set", format_integer (cntr), format_integer (measured)});
+
+    cntr = 0;
+    timer.reset ();
+    for (auto i = 0; i < pN; ++i) {
+        flag                        = tree2.erase (buffErase[i]);
+        tree2.insert (buffErase[i]);
+        cntr                        += flag;
+    }
+    measured = timer.elapsed ();
+    results.add_row ({"Churn", treeName, format_integer (cntr), format_integer (measured)});
 
 
     cntr = 0;
@@ -374,7 +294,7 @@ run_benchmark (int pN)
         cntr                        += flag;
     }
     measured = timer.elapsed ();
-    results.add_row ({"Erase", "AgAVLTree", format_integer (cntr), format_integer (measured)});;
+    results.add_row ({"Erase", treeName, format_integer (cntr), format_integer (measured)});
 
 
     std::cout << results << std::endl;
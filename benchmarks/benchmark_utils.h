@@ -0,0 +1,193 @@
+/**
+ * @file                benchmark_utils.h
+ * @author              Aditya Agarwal (aditya.agarwal@dumblebots.com)
+ * @brief               Timer, table printing and number formatting shared by the benchmark programs
+ */
+
+#ifndef BENCHMARK_UTILS_H
+#define BENCHMARK_UTILS_H
+
+// std IO
+#include <iostream>
+
+// measuring time
+#include <chrono>
+
+// table printing
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <initializer_list>
+#include <cstdlib>
+#include <cstdint>
+
+struct Timer {
+
+    private:
+
+    std::chrono::high_resolution_clock::time_point      mStart;
+    std::chrono::high_resolution_clock::time_point      mEnd;
+
+    public:
+
+    Timer ()
+    {
+        reset ();
+    }
+
+    int64_t
+    elapsed ()
+    {
+        mEnd        = std::chrono::high_resolution_clock::now ();
+        auto diff   = std::chrono::duration_cast<std::chrono::milliseconds> (mEnd - mStart).count ();
+
+        return diff;
+    }
+
+    void
+    reset ()
+    {
+        mStart      = std::chrono::high_resolution_clock::now ();
+    }
+};
+
+struct table {
+
+    private:
+
+    std::vector<std::string>                mHeaders;
+    std::vector<std::vector<std::string>>   mRows;
+
+    public:
+
+    table ()
+    {}
+
+    void
+    add_headers (std::initializer_list<std::string> pHeaders)
+    {
+        if (pHeaders.size () == 0)
+        {
+            std::cout << "ZERO COLOUMNS NOT ALLOWED IN TABLE\n";
+            std::exit (1);
+        }
+        mHeaders            = pHeaders;
+    }
+
+    void
+    add_row (std::initializer_list<std::string> pElems)
+    {
+        if (pElems.size () != mHeaders.size ())
+        {
+            std::cout << "NUMBER OF COLOUMNS IN ROW MUST MATCH NUMBER OF COLOUMNS IN HEADER\n";
+            std::exit (1);
+        }
+
+        mRows.push_back (pElems);
+    }
+
+    friend std::ostream
+    &operator<< (std::ostream &stream, const table &pOther)
+    {
+        int32_t                 cols    = (int32_t)pOther.mHeaders.size ();
+        int32_t                 width   = 0;
+
+        std::vector<int32_t>    sz (cols);
+
+        for(int32_t col = 0; col < cols; ++col) {
+            sz[col] = (int32_t)pOther.mHeaders[col].size ();
+        }
+
+        for (auto &e : pOther.mRows) {
+            for (int32_t col = 0; col < cols; ++col) {
+
+                sz[col] = std::max (sz[col], (int32_t)e[col].size ());
+            }
+        }
+
+        for (auto &e : sz) {
+            e       += 4;
+            width   += e;
+        }
+
+        // print the headers
+        for (int32_t i = 0; i < width; ++i) {
+            stream << '-';
+        }
+        stream << '-' << '\n';
+
+        for (int32_t i = 0; i < cols; ++i) {
+            stream << "| ";
+            stream << pOther.mHeaders[i];
+            for (int32_t pad = (int32_t)pOther.mHeaders[i].size () + 2; pad < sz[i]; ++pad) {
+                stream << ' ';
+            }
+        }
+        stream << '|' << '\n';
+
+        for (int32_t i = 0; i < width; ++i) {
+            stream << '-';
+        }
+        stream << '-' << '\n';
+
+        for (auto &row : pOther.mRows) {
+            for (int32_t i = 0; i < cols; ++i) {
+                stream << "| ";
+                stream << row[i];
+                for (int32_t pad = (int32_t)row[i].size () + 2; pad < sz[i]; ++pad) {
+                    stream << ' ';
+                }
+            }
+            stream << '|' << '\n';
+        }
+
+        if (pOther.mRows.size () == 0) {
+            return stream;
+        }
+
+        for (int32_t i = 0; i < width; ++i) {
+            stream << '-';
+        }
+        stream << '-' << '\n';
+
+        return stream;
+    }
+};
+
+template <typename T>
+std::string
+format_integer (T pNum)
+{
+
+    T           cpy {pNum};
+    int32_t     len {};
+
+    std::string res;
+
+    if(pNum == 0) {
+        return "0";
+    }
+
+    while (cpy) {
+        ++len, cpy /= 10;
+    }
+
+    for (int32_t i = 0, d; i < len; ++i) {
+
+        d = pNum % 10;
+        pNum /= 10;
+
+        res += (char) (d + '0');
+        if (i % 3 == 2 && i != len - 1) {
+            res += ',';
+        }
+    }
+
+    for (auto i = 0; i < (int32_t)(res.size () / 2); ++i) {
+        std::swap (res[i], res[res.size () - i - 1]);
+    }
+
+    return res;
+}
+
+#endif
@@ -0,0 +1,157 @@
+/**
+ * @file                intervals.cpp
+ * @author              Aditya Agarwal (aditya.agarwal@dumblebots.com)
+ * @brief               Program to benchmark finding overlapping intervals in an interval tree against scanning all intervals
+ *
+ * Usage: ./benchmark_intervals [num_intervals [num_queries]]
+ *
+ * num_intervals:  Number of random intervals (defaults to 1,000,000)
+ * num_queries:    Number of random query intervals and points (defaults to 1,000)
+ *
+ * Example: ./benchmark_intervals 1000000 1000
+ */
+
+// std IO
+#include <iostream>
+
+// generating intervals
+#include <random>
+
+// std::vector
+#include <vector>
+
+// std::atoll
+#include <cstdlib>
+
+// AgAVLTree
+#include "AgAVLTree.h"
+
+// Timer, table and format_integer
+#include "benchmark_utils.h"
+
+using       interval_t                      = AgAVLInterval<int64_t>;
+using       tree_t                          = AgAVLIntervalTree<int64_t>;
+
+// intervals start anywhere in [0, span), and most of them are short (a few are up to 1,000 times longer)
+constexpr   int64_t         span            = 1'000'000'000;
+constexpr   int64_t         shortLength     = 10'000;
+constexpr   int64_t         longLength      = 10'000'000;
+
+// length of the query intervals
+constexpr   int64_t         queryLength     = 100'000;
+
+/**
+ * @brief                   Draws a random interval
+ *
+ * @param pGen              Random number generator
+ *
+ * @return interval_t       The interval
+ */
+interval_t
+random_interval (std::mt19937_64 & pGen)
+{
+    int64_t     start       {(int64_t)(pGen () % span)};
+    int64_t     length      {(int64_t)((pGen () % 100 == 0) ? (pGen () % longLength) : (pGen () % shortLength))};
+
+    return {start, start + length};
+}
+
+int
+main (int argc, char *argv[])
+{
+    int64_t     n           {1'000'000};
+    int64_t     q           {1'000};
+
+    if (argc > 1) {
+        n                   = std::atoll (argv[1]);
+    }
+    if (argc > 2) {
+        q                   = std::atoll (argv[2]);
+    }
+
+    std::mt19937_64         gen (22);
+    std::vector<interval_t> intervals;
+    std::vector<int64_t>    queries;
+
+    for (int64_t i = 0; i < n; ++i) {
+        intervals.push_back (random_interval (gen));
+    }
+    for (int64_t i = 0; i < q; ++i) {
+        queries.push_back ((int64_t)(gen () % span));
+    }
+
+    std::cout << "Building a tree of " << format_integer (n) << " random intervals\n";
+
+    Timer       timer;
+    int64_t     measured;
+    int64_t     cntr;
+
+    table       results;
+
+    tree_t      tree;
+
+    timer.reset ();
+    for (auto & e : intervals) {
+        tree.insert (e);
+    }
+    measured = timer.elapsed ();
+
+    std::cout << "Took " << format_integer (measured) << " ms for " << format_integer (tree.size ()) << " intervals\n\n";
+
+    results.add_headers ({"Query", "Method", "Found", "Time (ms)"});
+
+    // intervals overlapping [x, x + queryLength]
+    cntr = 0;
+    timer.reset ();
+    for (auto x : queries) {
+        for (auto & e : intervals) {
+            cntr            += (e.mStart <= x + queryLength && x <= e.mEnd);
+        }
+    }
+    measured = timer.elapsed ();
+    results.add_row ({"Overlap", "Linear scan", format_integer (cntr), format_integer (measured)});
+
+    {
+        std::vector<tree_t::iterator>   found;
+
+        cntr = 0;
+        timer.reset ();
+        for (auto x : queries) {
+            found.clear ();
+            tree.overlapping (x, x + queryLength, std::back_inserter (found));
+            cntr            += (int64_t)found.size ();
+        }
+        measured = timer.elapsed ();
+        results.add_row ({"Overlap", "AgAVLIntervalTree", format_integer (cntr), format_integer (measured)});
+    }
+
+    // intervals containing x
+    cntr = 0;
+    timer.reset ();
+    for (auto x : queries) {
+        for (auto & e : intervals) {
+            cntr            += (e.mStart <= x && x <= e.mEnd);
+        }
+    }
+    measured = timer.elapsed ();
+    results.add_row ({"Stabbing", "Linear scan", format_integer (cntr), format_integer (measured)});
+
+    {
+        std::vector<tree_t::iterator>   found;
+
+        cntr = 0;
+        timer.reset ();
+        for (auto x : queries) {
+            found.clear ();
+            tree.stabbing (x, std::back_inserter (found));
+            cntr            += (int64_t)found.size ();
+        }
+        measured = timer.elapsed ();
+        results.add_row ({"Stabbing", "AgAVLIntervalTree", format_integer (cntr), format_integer (measured)});
+    }
+
+    std::cout << results << '\n';
+    std::cout << "Exiting\n";
+
+    return 0;
+}
@@ -0,0 +1,137 @@
+/**
+ * @file                set_ops.cpp
+ * @author              Aditya Agarwal (aditya.agarwal@dumblebots.com)
+ * @brief               Program to benchmark copying and the set operations of the tree on different numbers of threads
+ *
+ * Usage: ./benchmark_set_ops [num_keys [max_threads]]
+ *
+ * num_keys:       Number of random keys in each of the two trees (defaults to 10,000,000)
+ * max_threads:    Greatest number of threads to run on (defaults to the number of hardware threads)
+ *
+ * Example: ./benchmark_set_ops 10000000 8
+ */
+
+// std IO
+#include <iostream>
+
+// generating keys
+#include <random>
+#include <algorithm>
+
+// std::vector
+#include <vector>
+
+// std::thread::hardware_concurrency
+#include <thread>
+
+// std::atoll
+#include <cstdlib>
+
+// AgAVLTree
+#include "AgAVLTree.h"
+
+// Timer, table and format_integer
+#include "benchmark_utils.h"
+
+using       tree_t                          = AgAVLTree<int32_t>;
+
+/**
+ * @brief                   Builds a tree of distinct random keys (each key is drawn from twice as many values, so that two such trees share part of their keys)
+ *
+ * @param pCount            Number of keys to draw
+ * @param pSeed             Seed of the random number generator
+ *
+ * @return tree_t           Tree holding the keys
+ */
+tree_t
+make_tree (int64_t pCount, uint32_t pSeed)
+{
+    std::mt19937                            gen (pSeed);
+    std::uniform_int_distribution<int32_t>  dist (0, (int32_t)std::min<int64_t> (2 * pCount, INT32_MAX));
+    std::vector<int32_t>                    keys ((size_t)pCount);
+
+    for (auto &e : keys) {
+        e                           = dist (gen);
+    }
+    std::sort (keys.begin (), keys.end ());
+
+    // sorted keys are built into a balanced tree directly (repeated keys are dropped)
+    return tree_t (keys.begin (), keys.end ());
+}
+
+int
+main (int argc, char *argv[])
+{
+    int64_t     n           {10'000'000};
+    size_t      maxThreads  {std::max (1u, std::thread::hardware_concurrency ())};
+
+    if (argc > 1) {
+        n                   = std::atoll (argv[1]);
+    }
+    if (argc > 2) {
+        maxThreads          = (size_t)std::max (1ll, std::atoll (argv[2]));
+    }
+
+    std::cout << "Building trees of " << format_integer (n) << " random keys\n";
+
+    tree_t      treeA       {make_tree (n, 1)};
+    tree_t      treeB       {make_tree (n, 2)};
+
+    Timer       timer;
+    int64_t     measured;
+    size_t      cntr;
+
+    table       results;
+
+    std::cout << "Sizes " << format_integer (treeA.size ()) << " and " << format_integer (treeB.size ()) << "\n\n";
+
+    results.add_headers ({"Operation", "Threads", "Changed", "Time (ms)"});
+
+    // every operation runs on fresh copies of the trees, which are not included in the measured time
+    for (size_t threads = 1; ; threads = std::min (2 * threads, maxThreads)) {
+
+        {
+            timer.reset ();
+            tree_t  cpy     (treeA, threads);
+            measured        = timer.elapsed ();
+            results.add_row ({"Copy", format_integer (threads), format_integer (cpy.size ()), format_integer (measured)});
+        }
+
+        {
+            tree_t  res     {treeA};
+            tree_t  other   {treeB};
+
+            timer.reset ();
+            cntr            = res.set_union (std::move (other), threads);
+            measured        = timer.elapsed ();
+            results.add_row ({"Union", format_integer (threads), format_integer (cntr), format_integer (measured)});
+        }
+
+        {
+            tree_t  res     {treeA};
+
+            timer.reset ();
+            cntr            = res.set_intersection (treeB, threads);
+            measured        = timer.elapsed ();
+            results.add_row ({"Intersection", format_integer (threads), format_integer (cntr), format_integer (measured)});
+        }
+
+        {
+            tree_t  res     {treeA};
+
+            timer.reset ();
+            cntr            = res.set_difference (treeB, threads);
+            measured        = timer.elapsed ();
+            results.add_row ({"Difference", format_integer (threads), format_integer (cntr), format_integer (measured)});
+        }
+
+        if (threads == maxThreads) {
+            break;
+        }
+    }
+
+    std::cout << results << '\n';
+    std::cout << "Exiting\n";
+
+    return 0;
+}
@@ -6,8 +6,10 @@
  * has a minimum size requirement
  * For each request, report the smallest Log that meets the minimum size requirement of the request and
  * remove it from the set of available logs, repeating this for each all requests in order
+ * Along with each request, the total size of all the logs which meet its requirement is reported
 */
 
+#include <climits>
 #include <iostream>
 
 #include "AgAVLTree.h"
@@ -55,6 +57,18 @@ struct Log
     }
 };
 
+/**
+ * @brief               Returns the size of a Log (which is the quantity summed by the tree)
+ *
+ * @param pLog          Log whose size is to be returned
+ * @return int          Size of the Log
+ */
+int
+log_size (const Log &pLog)
+{
+    return pLog.mSize;
+}
+
 int
 main (void)
 {
@@ -90,7 +104,8 @@ main (void)
 
     int                 numRequests = sizeof (requests) / sizeof (requests[0]);
 
-    AgAVLTree<Log>      tree;
+    // each node of the tree keeps the total size of the logs in its subtree, so that sizes can be summed over a range of logs
+    AgAVLTreeAugmented<Log, AgAVLSum<Log, long long, log_size>> tree;
 
     // insert all Log objects into the tree and print the final size of the tree
     for (auto &e : ar) {
@@ -102,6 +117,7 @@ main (void)
 
         // for each request, print the result, try to find the smallest Log which meets the requirement
         std::cout << "For request #" << i << " (with size requirement " << requests[i] << "):\n\t";
+        std::cout << "Logs meeting the requirement have a total size of " << tree.aggregate ({-1, requests[i]}, {INT_MAX, INT_MAX}) << "\n\t";
         auto    it  = tree.first_greater_equals ({-1, requests[i]});
 
         // if no such Log, could be found, report it
@@ -255,25 +255,17 @@ main (void)
             int     start;
             int     end;
 
-            AgAVLTree<train>::iterator  lo;
-            AgAVLTree<train>::iterator  hi;
-
             std::cout << "Interval beginning:\t";
             std::cin >> start;
 
             std::cout << "Interval ending:\t";
             std::cin >> end;
 
-            // the first train in the segment will be the earliest train whose pickup time is greater than or equal to the interval start
-            lo  = trainTree.first_greater_equals ({-1, "", train_time::from_24_hours (start)});
-
-            // the train after the last one is the smallest train whose pickup time is strictly greater than the interval end
-            hi  = trainTree.first_greater_strict ({std::numeric_limits<int>::max (), "", train_time::from_24_hours (end)});
-
-            // if the lower bound of the interval is more than the latest train's pickup, do not move further
-            if (lo == trainTree.end ()) {
-                continue;
-            }
+            // the first train in the segment will be the earliest train whose pickup time is greater than or equal to the interval start,
+            // and the train after the last one is the smallest train whose pickup time is strictly greater than the interval end
+            // (both are found in one search, since the IDs -1 and INT_MAX place the keys before and after all trains at the same time)
+            auto [lo, hi]   = trainTree.bounds ({-1, "", train_time::from_24_hours (start)},
+                                                {std::numeric_limits<int>::max (), "", train_time::from_24_hours (end)});
 
             // iterate through the segment [lo, hi) and print all trains
             for (auto it = lo; it != hi; ++it) {
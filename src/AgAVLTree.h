@@ -15,7 +15,29 @@
 #define NO_DBG_MODE(...)                       __VA_ARGS__
 #endif
 
+// hint to the processor that a node is going to be read soon (does nothing on compilers without a prefetch builtin)
+#if defined (__GNUC__) || defined (__clang__)
+#define AG_AVL_PREFETCH(pAddr)                  __builtin_prefetch (pAddr)
+#else
+#define AG_AVL_PREFETCH(pAddr)
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <random>
+#include <system_error>
+#include <thread>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 /**
  * @brief                   Default comparator function for less than comparison if none given by user (requires < operator to be implemented)
@@ -50,38 +72,302 @@ ag_avl_default_equals (const val_t &pA, const val_t &pB)
     return pA == pB;
 }
 
+
+/**
+ * @brief                   Default projection of a value to the quantity summarised by the augmentation policies (the value itself)
+ *
+ * @param pVal              Value to be projected
+ *
+ * @return const val_t&     Reference to the value
+ */
+template <typename val_t>
+static const val_t &
+ag_avl_default_proj (const val_t &pVal)
+{
+    return pVal;
+}
+
+
+/**
+ * @brief                   Augmentation policy which keeps the sum of (a projection of) the values in each subtree
+ *
+ * @note                    An augmentation policy gives the type of the summary kept by each node, the summary of a single value, and an
+ *                          associative function which combines the summaries of two adjacent runs of values (the left one first), along
+ *                          with its identity (the summary of no values)
+ *
+ * @tparam val_t            Type of data held by the tree
+ * @tparam sum_t            Type of the sum (defaults to val_t)
+ * @tparam mProj            Function giving the quantity to be summed for a value (defaults to the value itself)
+ */
+template <typename val_t, typename sum_t = val_t, auto mProj = ag_avl_default_proj<val_t>>
+struct AgAVLSum {
+
+    using summary_t         = sum_t;
+
+    static summary_t identity ()                                                { return summary_t {}; }
+    static summary_t of       (const val_t & pVal)                              { return (summary_t)mProj (pVal); }
+    static summary_t combine  (const summary_t & pA, const summary_t & pB)      { return pA + pB; }
+};
+
+
+/**
+ * @brief                   Augmentation policy which keeps the smallest (projection of a) value in each subtree
+ *
+ * @note                    See AgAVLSum (the summary of no values is the largest value of sum_t)
+ *
+ * @tparam val_t            Type of data held by the tree
+ * @tparam sum_t            Type of the minimum (defaults to val_t)
+ * @tparam mProj            Function giving the quantity to be compared for a value (defaults to the value itself)
+ */
+template <typename val_t, typename sum_t = val_t, auto mProj = ag_avl_default_proj<val_t>>
+struct AgAVLMin {
+
+    using summary_t         = sum_t;
+
+    static summary_t identity ()                                                { return std::numeric_limits<summary_t>::max (); }
+    static summary_t of       (const val_t & pVal)                              { return (summary_t)mProj (pVal); }
+    static summary_t combine  (const summary_t & pA, const summary_t & pB)      { return (pB < pA) ? (pB) : (pA); }
+};
+
+
+/**
+ * @brief                   Augmentation policy which keeps the largest (projection of a) value in each subtree
+ *
+ * @note                    See AgAVLSum (the summary of no values is the lowest value of sum_t)
+ *
+ * @tparam val_t            Type of data held by the tree
+ * @tparam sum_t            Type of the maximum (defaults to val_t)
+ * @tparam mProj            Function giving the quantity to be compared for a value (defaults to the value itself)
+ */
+template <typename val_t, typename sum_t = val_t, auto mProj = ag_avl_default_proj<val_t>>
+struct AgAVLMax {
+
+    using summary_t         = sum_t;
+
+    static summary_t identity ()                                                { return std::numeric_limits<summary_t>::lowest (); }
+    static summary_t of       (const val_t & pVal)                              { return (summary_t)mProj (pVal); }
+    static summary_t combine  (const summary_t & pA, const summary_t & pB)      { return (pA < pB) ? (pB) : (pA); }
+};
+
+
+/**
+ * @brief                   Closed interval [mStart, mEnd], ordered by its start (and then by its end)
+ *
+ * @tparam point_t          Type of the ends of the interval (requires operator<)
+ */
+template <typename point_t>
+struct AgAVLInterval {
+
+    point_t     mStart;                             /* First point of the interval */
+    point_t     mEnd;                               /* Last point of the interval (not less than mStart) */
+
+    friend bool
+    operator< (const AgAVLInterval & pA, const AgAVLInterval & pB)
+    {
+        if (pA.mStart < pB.mStart || pB.mStart < pA.mStart) {
+            return pA.mStart < pB.mStart;
+        }
+        return pA.mEnd < pB.mEnd;
+    }
+
+    friend bool
+    operator== (const AgAVLInterval & pA, const AgAVLInterval & pB)
+    {
+        return !(pA < pB) && !(pB < pA);
+    }
+};
+
+
+/**
+ * @brief                   Default function giving the first point of an interval (its mStart member)
+ *
+ * @param pVal              Interval
+ *
+ * @return auto             First point of the interval
+ */
+template <typename val_t>
+static auto
+ag_avl_interval_start (const val_t &pVal)
+{
+    return pVal.mStart;
+}
+
+
+/**
+ * @brief                   Default function giving the last point of an interval (its mEnd member)
+ *
+ * @param pVal              Interval
+ *
+ * @return auto             Last point of the interval
+ */
+template <typename val_t>
+static auto
+ag_avl_interval_end (const val_t &pVal)
+{
+    return pVal.mEnd;
+}
+
+
+/**
+ * @brief                   Augmentation policy which keeps the largest end of the intervals in each subtree, for finding overlapping intervals
+ *
+ * @note                    See AgAVLMax (the tree must order the intervals by their starts first)
+ *
+ * @tparam val_t            Type of the intervals held by the tree
+ * @tparam point_t          Type of the ends of the intervals
+ * @tparam mStart           Function giving the first point of an interval (defaults to its mStart member)
+ * @tparam mEnd             Function giving the last point of an interval (defaults to its mEnd member)
+ */
+template <typename val_t, typename point_t, auto mStart = ag_avl_interval_start<val_t>, auto mEnd = ag_avl_interval_end<val_t>>
+struct AgAVLMaxEnd : AgAVLMax<val_t, point_t, mEnd> {
+
+    static point_t   start    (const val_t & pVal)                              { return mStart (pVal); }
+    static point_t   end      (const val_t & pVal)                              { return mEnd (pVal); }
+};
+
+
+/**
+ * @brief                   Default function giving the hash of a value (std::hash)
+ *
+ * @param pVal              Value to be hashed
+ *
+ * @return size_t           Hash of the value
+ */
+template <typename val_t>
+static size_t
+ag_avl_default_hash (const val_t &pVal)
+{
+    return std::hash<val_t> {} (pVal);
+}
+
+
+/**
+ * @brief                   Augmentation policy which keeps a hash of the set of values in each subtree, to fingerprint and compare trees
+ *
+ * @note                    The hash of a set is the sum (modulo 2^64) of the mixed hashes of its values, so it does not depend on the order in
+ *                          which the values are combined, and trees holding the same values have the same hashes over any range of values,
+ *                          whatever their shapes. Different sets have the same hash with a probability of about 2^-64 when the hashes of
+ *                          their values are unrelated, but the sum is not meant to withstand values chosen to collide. Values which are equal
+ *                          by the comparators of the tree must have the same hash
+ *
+ * @tparam val_t            Type of data held by the tree
+ * @tparam mHash            Function giving the hash of a value (defaults to std::hash)
+ */
+template <typename val_t, auto mHash = ag_avl_default_hash<val_t>>
+struct AgAVLHash {
+
+    using summary_t         = uint64_t;
+
+    static summary_t identity ()                                                { return 0; }
+    static summary_t of       (const val_t & pVal)                              { return mix ((uint64_t)mHash (pVal)); }
+    static summary_t combine  (const summary_t & pA, const summary_t & pB)      { return pA + pB; }
+
+    // spreads the bits of a hash (std::hash of an integer is often the integer itself, whose sums would collide trivially), offset first
+    // so that a hash of zero does not stay zero (and look like no value at all)
+    static uint64_t
+    mix (uint64_t pHash)
+    {
+        pHash   += 0x9E3779B97F4A7C15ull;
+        pHash   = (pHash ^ (pHash >> 30)) * 0xBF58476D1CE4E5B9ull;
+        pHash   = (pHash ^ (pHash >> 27)) * 0x94D049BB133111EBull;
+        return pHash ^ (pHash >> 31);
+    }
+};
+
 /**
  * @brief                   AgAVLTree is an implementation of the AVL tree data structure (a type of self balanced binary search tree)
  *
  * @tparam val_t            Type of data held by tree instance
- * @tparam mComp            Comparator to use while making less than comparisons (defaults to operator<)
+ * @tparam mComp            Comparator to use while making less than comparisons (defaults to operator<), or a three-way comparator which
+ *                          returns a negative, zero or positive value (like strcmp) instead of a bool, in which case mEquals is not used
  * @tparam mEquals          Comparator to use while making equals comparisons (defaults to operator==)
+ * @tparam alloc_t          Allocator used to get memory for the nodes of the tree (defaults to std::allocator)
+ * @tparam mCompact         Whether nodes are kept in a contiguous arena and linked by 32-bit indices instead of pointers (defaults to false)
+ * @tparam mCounted         Whether each node keeps the number of nodes in its subtree, which allows finding elements by their position and
+ *                          counting elements in O(log n) (defaults to false)
+ * @tparam aug_t            Augmentation policy (such as AgAVLSum) whose summary of the values in its subtree each node keeps, which allows
+ *                          aggregating the values in a range in O(log n) (defaults to void, for no summary)
+ * @tparam mShiftable       Whether each node keeps an offset still to be added to the values below it, which allows adding a constant to all
+ *                          values in a range in O(log n) (defaults to false, only for arithmetic values without a summary)
  */
-template <typename val_t, auto mComp = ag_avl_default_comp<val_t>, auto mEquals = ag_avl_default_equals<val_t>>
+template <typename val_t, auto mComp = ag_avl_default_comp<val_t>, auto mEquals = ag_avl_default_equals<val_t>, typename alloc_t = std::allocator<val_t>, bool mCompact = false, bool mCounted = false, typename aug_t = void, bool mShiftable = false>
 class AgAVLTree {
 
     static_assert (std::is_invocable<decltype (mComp), val_t, val_t>::value, "Lessthan comparator must be callable");
     static_assert (std::is_invocable<decltype (mEquals), val_t, val_t>::value, "Equals comparator must be callable");
+    static_assert (std::is_same<typename std::allocator_traits<alloc_t>::value_type, val_t>::value, "Allocator must allocate values of the type held by the tree");
+    static_assert (!mShiftable || std::is_arithmetic<val_t>::value, "Only trees of arithmetic values can be shifted");
+    static_assert (!mShiftable || std::is_void<aug_t>::value, "Summaries of shifted values can not be kept up to date lazily");
 
 
     protected:
 
 
-    struct tree_node_t {
-        tree_node_t * lptr      {nullptr};              /* Pointer to left child of the node */
-        tree_node_t * rptr      {nullptr};              /* Pointer to right child of the node */
-        uint8_t       height    {0};                    /* Height of subtree of node */
+    // number of nodes in a subtree (indices in compact mode are 30-bit, so a 32-bit count is enough there)
+    using count_t           = std::conditional_t<mCompact, uint32_t, size_t>;
+
+    struct node_count_t {
+
+        count_t       cnt       {1};                    /* Number of nodes in the subtree of the node (including itself) */
+    };
+
+    struct node_no_count_t {};
+
+    // summaries are only kept if an augmentation policy is given
+    static constexpr bool   SUMMARISED {!std::is_void<aug_t>::value};
+
+    template <typename policy_t>
+    struct node_summary_t {
+
+        typename policy_t::summary_t sum;               /* Summary of the values in the subtree of the node (combined in order) */
+    };
+
+    struct node_no_summary_t {};
+
+    struct node_shift_t {
+
+        val_t         shift     {};                     /* Offset which has been added to the value of the node, but not yet to those of its children */
+    };
+
+    struct node_no_shift_t {};
+
+    // the fields a node keeps about its subtree are held in a base, which is empty (and takes no space) if the tree keeps none
+    struct node_extra_t :
+        std::conditional_t<mCounted, node_count_t, node_no_count_t>,
+        std::conditional_t<SUMMARISED, node_summary_t<aug_t>, node_no_summary_t>,
+        std::conditional_t<mShiftable, node_shift_t, node_no_shift_t>
+    {};
+
+    struct tree_node_t : node_extra_t {
+
+        // nodes link to each other either by pointers, or by 32-bit indices into the arena of the tree (compact mode)
+        using link_t  = std::conditional_t<mCompact, uint32_t, tree_node_t *>;
+
+        link_t        lptr      {};                     /* Link to left child of the node */
+        link_t        rptr      {};                     /* Link to right child of the node */
+        link_t        pptr      {};                     /* Link to parent of the node (null for the root), tagged with the balance factor of the node */
         val_t         val;                              /* Value stored at this node */
+
+        // nodes are built by a constructor rather than as aggregates, which would have their whole storage zeroed first (as they have a base)
+        tree_node_t (link_t pLeft, link_t pRight, link_t pParent, const val_t & pVal) :
+            lptr {pLeft}, rptr {pRight}, pptr {pParent}, val (pVal)
+        {
+            // a new node is a leaf until it is updated, so its summary is that of its own value
+            if constexpr (SUMMARISED) {
+                this->sum = aug_t::of (val);
+            }
+        }
     };
 
 
 
     struct dbg_info_t {
 
-        int32_t ll_count        {0};                    /* Number of times left-left rotation has occoured */
-        int32_t lr_count        {0};                    /* Number of times left-right rotation has occoured */
-        int32_t rl_count        {0};                    /* Number of times right-left rotation has occoured */
-        int32_t rr_count        {0};                    /* Number of times right-right rotation has occoured */
+        // counted atomically, as the set operations may rotate different subtrees on several threads at once
+        std::atomic<int32_t> ll_count   {0};            /* Number of times left-left rotation has occoured */
+        std::atomic<int32_t> lr_count   {0};            /* Number of times left-right rotation has occoured */
+        std::atomic<int32_t> rl_count   {0};            /* Number of times right-left rotation has occoured */
+        std::atomic<int32_t> rr_count   {0};            /* Number of times right-right rotation has occoured */
 
         void
         init ()
@@ -98,30 +384,143 @@ class AgAVLTree {
     using node_t            = tree_node_t;              /* Type of node */
     using node_ptr_t        = node_t *;                 /* Pointer to node */
 
-    using link_t            = node_t *;                 /* Type of link from a node to its child */
+    using link_t            = typename node_t::link_t;  /* Type of link from a node to its child */
     using link_ptr_t        = link_t *;                 /* Pointer to link between nodes */
 
+    static constexpr link_t NIL {};                     /* Null link (nullptr, or index 0 in compact mode) */
+
+    struct subtree_t {
+
+        link_t        root      {};                     /* Link to the root of the subtree (its parent link is null) */
+        int32_t       height    {0};                    /* Number of levels of the subtree (0 if empty) */
+    };
+
+    // the balance factor (height of right subtree - height of left subtree) of a node is kept in 2 bits of the link to its parent,
+    // which are the (always zero) low bits of an aligned pointer, or the top bits of an index in compact mode
+    using tag_t             = std::conditional_t<mCompact, uint32_t, uintptr_t>;
+
+    static constexpr tag_t  TAG_SHIFT {(mCompact) ? (30) : (0)};                /* Position of the balance factor in a parent link */
+    static constexpr tag_t  TAG_MASK  {(tag_t)3 << TAG_SHIFT};                  /* Bits of a parent link holding the balance factor */
+
+    static_assert (mCompact || alignof (node_t) >= 4, "Nodes must be aligned to at least 4 bytes to tag their parent links");
+
+    // an AVL tree with n nodes is less than 1.45 * log2 (n + 2) levels tall, which bounds the length of any path from the root
+    static constexpr size_t MAX_DEPTH {(mCompact) ? (48) : (96)};             /* Maximum number of links on a path from the root */
+
+    static constexpr size_t LOOKUP_GROUP {16};                                  /* Number of lookups made side by side by the batched searches */
+
+    static constexpr int32_t PARALLEL_HEIGHT {16};                              /* Minimum height of a subtree for the set operations to fork on it */
+
+
+
+    struct node_pool_t {
+
+        protected:
+
+        static constexpr size_t CHUNK_BYTES     {1 << 16};                  /* Approximate size of a single chunk in bytes */
+
+        union node_slot_t {
+            link_t        nxt;                                              /* Next free slot (only while the slot is on the free list) */
+            alignas (node_t) unsigned char raw[sizeof (node_t)];            /* Storage for a node (while the slot is in use) */
+        };
+
+        static constexpr size_t CHUNK_NODES     {(CHUNK_BYTES / sizeof (node_slot_t) > 16) ? (CHUNK_BYTES / sizeof (node_slot_t)) : (16)};
+        static constexpr size_t MAX_NODES       {(mCompact) ? ((size_t)1 << TAG_SHIFT) : (SIZE_MAX)};  /* Maximum number of slots (indices are 30-bit in compact mode) */
+
+        struct chunk_t {
+            chunk_t *     nxt;                                              /* Next chunk owned by the pool (or in the same group) */
+            chunk_t *     below;                                            /* Older group kept alive by the group (head of a group only) */
+            std::atomic<size_t> refs;                                       /* Number of pools using the group (head of a group only) */
+            node_slot_t   slots[CHUNK_NODES];                               /* Fixed number of node slots carved out of the chunk */
+        };
+
+        using chunk_alloc_t     = typename std::allocator_traits<alloc_t>::template rebind_alloc<chunk_t>;
+        using slot_alloc_t      = typename std::allocator_traits<alloc_t>::template rebind_alloc<node_slot_t>;
+        using mask_alloc_t      = typename std::allocator_traits<alloc_t>::template rebind_alloc<uint64_t>;
+
+        alloc_t       mAlloc;                                               /* Allocator from which chunks (or single nodes) are obtained */
+        chunk_t *     mChunks   {nullptr};                                  /* Most recently allocated chunk (head of the list of chunks) */
+        node_slot_t * mArena    {nullptr};                                  /* Contiguous array holding all the slots (compact mode only) */
+        size_t        mCap      {0};                                        /* Number of slots in the arena (compact mode only) */
+        size_t        mUsed     {(mCompact) ? (0) : (CHUNK_NODES)};         /* Number of slots handed out from the most recent chunk (or the arena) */
+        link_t        mFree     {NIL};                                      /* Head of the intrusive list of freed slots */
+        chunk_t *     mShared   {nullptr};                                  /* Head of the newest group of chunks shared with other pools */
+
+        bool     grow_arena     (size_t pMinCap);
+        void     drop_shared    ();
+        static bool reaches     (chunk_t * pFrom, chunk_t * pTo);
+
+        public:
+
+        node_pool_t             (const alloc_t & pAlloc) noexcept;
+        node_pool_t             (const node_pool_t &) = delete;
+        node_pool_t             (node_pool_t && pOther) noexcept;
+        ~node_pool_t            ();
+
+        link_t     allocate     ();
+        void       deallocate   (link_t pLink);
+        bool       reserve      (size_t pCount);
+        void       release      ();
+        bool       absorb       (node_pool_t & pOther);
+        bool       share        (node_pool_t & pOther);
+
+        bool       releasable   ()                      const;
+
+        node_ptr_t get          (link_t pLink)          const;
+
+        alloc_t    get_allocator ()                     const;
+    };
+
+    using pool_alloc_t      = typename std::allocator_traits<alloc_t>::template rebind_alloc<node_pool_t>;
+
     using lessthan_comp_t   = decltype (mComp);         /* Data type of the less-than comparator */
     using equals_comp_t     = decltype (mEquals);       /* Data type of the equals comparator */
 
+    // a comparator which does not return a bool is three-way, and tells apart smaller, equal and greater values with a single call
+    static constexpr bool   THREE_WAY {!std::is_same<std::invoke_result_t<lessthan_comp_t, const val_t &, const val_t &>, bool>::value};
+
+    // nodes which keep fields about their subtrees must have them updated whenever their subtrees change
+    static constexpr bool   AUGMENTED {mCounted || SUMMARISED};
+
+    // iterators of a shiftable tree keep the value of their node (the offsets of its ancestors are never pushed down by readers), which
+    // only changes when the tree is shifted
+    struct iter_shifts_t {
+
+        mutable size_t  mShifts {SIZE_MAX};                                 /* Number of shifts of the tree when the value was found (none yet) */
+        mutable val_t   mVal    {};                                         /* Value of the node, including the offsets of its ancestors */
+    };
+
+    struct no_shifts_t {};
+
+    using iter_extra_t      = std::conditional_t<mShiftable, iter_shifts_t, no_shifts_t>;
+    using shifts_t          = std::conditional_t<mShiftable, size_t, no_shifts_t>;
+
+    // sum of the offsets kept by the ancestors of a node, added up on the way down by searches (empty unless shiftable)
+    using offset_t          = std::conditional_t<mShiftable, val_t, no_shifts_t>;
+
+    // the value of a node of a shiftable tree is worked out from its offsets, so it is handed out by value
+    using val_ref_t         = std::conditional_t<mShiftable, val_t, const val_t &>;
+
 
     public:
 
 
 
-    struct iterator {
+    struct iterator : iter_extra_t {
 
         protected:
 
-        using tree_ptr_t        = const AgAVLTree<val_t, mComp, mEquals> *;
-        using ref_t             = const val_t &;
+        using tree_ptr_t        = const AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable> *;
+        using ref_t             = val_ref_t;
 
-        node_ptr_t mPtr         {nullptr};                                  /* Ppointer to tree node (nullptr if points to end()) */
+        link_t     mPtr         {NIL};                                      /* Link to tree node (null if points to end()) */
         tree_ptr_t mTreePtr     {nullptr};                                  /* Ppointer to tree instance */
 
+        friend AgAVLTree;                                                   /* Hints given to the tree are followed by their links */
+
         public:
 
-        iterator                (node_ptr_t pPtr, tree_ptr_t pTreePtr) noexcept;
+        iterator                (link_t pPtr, tree_ptr_t pTreePtr) noexcept;
         iterator                () = default;
 
         iterator operator++     ();
@@ -137,19 +536,19 @@ class AgAVLTree {
 
 
 
-    struct reverse_iterator {
+    struct reverse_iterator : iter_extra_t {
 
         protected:
 
-        using tree_ptr_t        = const AgAVLTree<val_t, mComp, mEquals> *;
-        using ref_t             = const val_t &;
+        using tree_ptr_t        = const AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable> *;
+        using ref_t             = val_ref_t;
 
-        node_ptr_t mPtr         {nullptr};                                  /* Pointer to tree node (nullptr if points to rend()) */
+        link_t     mPtr         {NIL};                                      /* Link to tree node (null if points to rend()) */
         tree_ptr_t mTreePtr     {nullptr};                                  /* Pointer to tree instance */
 
         public:
 
-        reverse_iterator                (node_ptr_t pPtr, tree_ptr_t pTreePtr) noexcept;
+        reverse_iterator                (link_t pPtr, tree_ptr_t pTreePtr) noexcept;
         reverse_iterator                () = default;
 
         reverse_iterator operator++     ();
@@ -166,19 +565,29 @@ class AgAVLTree {
 
     DBG_MODE (
     dbg_info_t      dbg_info;                                               /* Structure holding information related to debugging (TEST ONLY) */
+    static inline std::atomic<int32_t> dbg_forks {0};                       /* Number of threads started by the forking operations (TEST ONLY) */
     )
 
 
     //      Constructors
 
     AgAVLTree                                       ()                                      noexcept;
+    explicit
+    AgAVLTree                                       (const alloc_t & pAlloc)                noexcept;
     AgAVLTree                                       (const AgAVLTree &)                     noexcept;
+    AgAVLTree                                       (const AgAVLTree & pOther, size_t pThreads) noexcept;
     AgAVLTree                                       (AgAVLTree &&)                          noexcept;
+    template <typename iter_t>
+    AgAVLTree                                       (iter_t pFirst, iter_t pLast, const alloc_t & pAlloc = alloc_t ());
 
     //      Destructor
 
     ~AgAVLTree                                      ();
 
+    //      Allocator
+
+    alloc_t          get_allocator                  ()                                      const;
+
     //      Iteration and Iterators
 
     size_t           size                           ()                                      const;
@@ -190,9 +599,26 @@ class AgAVLTree {
     //      Modifiers
 
     bool             insert                         (const val_t & pVal);
+    iterator         insert                         (iterator pHint, const val_t & pVal);
     bool             erase                          (const val_t & pVal);
+    size_t           erase_range                    (const val_t & pLo, const val_t & pHi);
+    iterator         erase                          (iterator pFirst, iterator pLast);
     void             clear                          ();
 
+    AgAVLTree        split                          (const val_t & pVal);
+    bool             join                           (AgAVLTree && pRight);
+
+    size_t           merge                          (AgAVLTree && pOther);
+
+    size_t           set_union                      (AgAVLTree && pOther, size_t pThreads = 1);
+    size_t           set_intersection               (const AgAVLTree & pOther, size_t pThreads = 1);
+    size_t           set_difference                 (const AgAVLTree & pOther, size_t pThreads = 1);
+
+    template <typename iter_t>
+    bool             assign                         (iter_t pFirst, iter_t pLast);
+    template <typename iter_t>
+    size_t           insert_batch                   (iter_t pFirst, iter_t pLast);
+
     //      Binary search
 
     bool             exists                         (const val_t & pVal)                    const;
@@ -202,10 +628,60 @@ class AgAVLTree {
     iterator         last_smaller_strict            (const val_t & pVal)                    const;
     iterator         last_smaller_equals            (const val_t & pVal)                    const;
 
+    std::pair<iterator, iterator>   equal_range     (const val_t & pVal)                    const;
+    std::pair<iterator, iterator>   bounds          (const val_t & pLo, const val_t & pHi)  const;
+
+    template <typename iter_t, typename out_iter_t>
+    out_iter_t       exists_batch                   (iter_t pFirst, iter_t pLast, out_iter_t pOut) const;
+    template <typename iter_t, typename out_iter_t>
+    out_iter_t       find_batch                     (iter_t pFirst, iter_t pLast, out_iter_t pOut) const;
+
+    //      Order statistics (O(log n) in counted trees)
+
+    iterator         select                         (size_t pIdx)                           const;
+    size_t           rank                           (const val_t & pVal)                    const;
+    size_t           count_range                    (const val_t & pLo, const val_t & pHi)  const;
+
+    //      Range aggregates (O(log n) for the augmentation policy of the tree)
+
+    template <typename policy_t = aug_t>
+    typename policy_t::summary_t aggregate          (const val_t & pLo, const val_t & pHi)  const;
+
+    //      Interval queries (trees of intervals keeping the largest end in each subtree)
+
+    template <typename point_t>
+    iterator         find_overlapping               (const point_t & pLo, const point_t & pHi) const;
+    template <typename point_t, typename out_iter_t>
+    out_iter_t       overlapping                    (const point_t & pLo, const point_t & pHi, out_iter_t pOut) const;
+    template <typename point_t, typename out_iter_t>
+    out_iter_t       stabbing                       (const point_t & pPoint, out_iter_t pOut) const;
+
+    //      Fingerprints and differences (trees keeping a hash of each subtree, such as AgAVLTreeHashed)
+
+    auto             fingerprint                    ()                                      const;
+    template <typename out_here_t, typename out_there_t>
+    std::pair<out_here_t, out_there_t> diff         (const AgAVLTree & pOther, out_here_t pOnlyHere, out_there_t pOnlyThere) const;
+
+    //      Shifting values (O(log n) in shiftable trees)
+
+    template <typename delta_t>
+    bool             shift_range                    (const val_t & pLo, const val_t & pHi, const delta_t & pDelta);
+
+    //      Random sampling (O(log n) in counted trees, and in trees keeping the sum of the weights of the values)
+
+    template <typename rng_t>
+    iterator         sample                         (rng_t & pRng)                          const;
+    template <typename rng_t, typename out_iter_t>
+    out_iter_t       sample                         (rng_t & pRng, size_t pCount, out_iter_t pOut) const;
+    template <typename rng_t>
+    iterator         sample_weighted                (rng_t & pRng)                          const;
+    template <typename rng_t, typename out_iter_t>
+    out_iter_t       sample_weighted                (rng_t & pRng, size_t pCount, out_iter_t pOut) const;
+
     //      Utilities for testing
 
     DBG_MODE (
-    bool             check_balance                  (node_ptr_t pCur);
+    bool             check_balance                  (link_t pCur, int32_t & pHeight);
     bool             check_balance                  ();
     val_t            get_root_val                   ();
     )
@@ -216,8 +692,11 @@ class AgAVLTree {
 
 
 
-    node_ptr_t      mRoot                       {nullptr};                  /* Pointer to the root node */
+    link_t          mRoot                       {NIL};                      /* Link to the root node */
     size_t          mSz                         {0};                        /* Size of tree (number of nodes) */
+    alloc_t         mAlloc;                                                 /* Allocator used to get memory for the nodes (and the pool) */
+    shifts_t        mShifts                     {};                         /* Number of times values of the tree have been shifted (empty unless shiftable) */
+    node_pool_t *   mPool                       {nullptr};                  /* Pool from which all nodes of the tree are allocated (created when first needed) */
 
 
     //      Aggregators
@@ -228,140 +707,590 @@ class AgAVLTree {
     template <typename arg_t>
     static arg_t    min                             (const arg_t & pA, const arg_t & pB);
 
+    //      Comparisons
+
+    static bool     less                            (const val_t & pA, const val_t & pB);
+    static int32_t  compare                         (const val_t & pA, const val_t & pB);
+
+    //      Node access
+
+    node_ptr_t      node                            (link_t pLink)                          const;
+    bool            reserve_nodes                   (size_t pCount);
+    void            drop_pool                       ();
+
     //      Balance Utilities
 
-    static void     calc_height                     (node_ptr_t pCur, uint8_t & pLdep, uint8_t & pRdep);
+    static link_t   get_parent                      (node_ptr_t pCur);
+    static int8_t   get_balance                     (node_ptr_t pCur);
+    static void     set_balance                     (node_ptr_t pCur, int8_t pBal);
+    void            set_parent                      (link_t pCur, link_t pPar)              const;
+    void            update                          (link_t pCur)                           const;
+    void            push                            (link_t pCur);
+    void            settle                          (link_t pCur);
     void            balance_ll                      (link_ptr_t pRoot);
     void            balance_lr                      (link_ptr_t pRoot);
     void            balance_rl                      (link_ptr_t pRoot);
     void            balance_rr                      (link_ptr_t pRoot);
+    bool            rebalance_grown                 (link_ptr_t pCur, bool pLeft);
+    bool            rebalance_shrunk                (link_ptr_t pCur, bool pLeft);
+
+    //      Offsets
+
+    static val_ref_t value                          (node_ptr_t pCur, const offset_t & pOffset);
+    static offset_t offset_below                    (node_ptr_t pCur, const offset_t & pOffset);
+    offset_t        offset                          (link_t pCur)                           const;
+    val_ref_t       value_of                        (link_t pCur)                           const;
+
+    val_ref_t       iter_value                      (link_t pCur, const iter_extra_t & pIter) const;
+    link_t          iter_next                       (link_t pCur, const iter_extra_t & pIter) const;
+    link_t          iter_prev                       (link_t pCur, const iter_extra_t & pIter) const;
 
     //      Subtree searches
 
-    node_ptr_t      find_min                        (node_ptr_t pRoot)                      const;
-    node_ptr_t      find_max                        (node_ptr_t pRoot)                      const;
-    node_ptr_t      find_min                        ()                                      const;
-    node_ptr_t      find_max                        ()                                      const;
+    link_t          find_min                        (link_t pRoot, offset_t & pOffset)      const;
+    link_t          find_max                        (link_t pRoot, offset_t & pOffset)      const;
+    link_t          find_min                        (link_t pRoot)                          const;
+    link_t          find_max                        (link_t pRoot)                          const;
+    link_t          find_min                        ()                                      const;
+    link_t          find_max                        ()                                      const;
+
+    //      Inorder neighbours
+
+    link_t          next_ptr                        (link_t pCur, offset_t & pOffset)       const;
+    link_t          prev_ptr                        (link_t pCur, offset_t & pOffset)       const;
+    link_t          next_ptr                        (link_t pCur)                           const;
+    link_t          prev_ptr                        (link_t pCur)                           const;
 
     //      Modifiers
 
-    bool            insert                          (link_ptr_t pCur, const val_t & pVal);
-    bool            erase                           (link_ptr_t pCur, const val_t & pVal);
-    void            clear                           (node_ptr_t pCur);
+    bool            insert                          (link_ptr_t pRoot, const val_t & pVal, link_t & pRes);
+    link_t          insert_at                       (link_t pPar, bool pLeft, const val_t & pVal);
+    link_ptr_t      link_to                         (link_t pCur);
+    bool            erase                           (link_ptr_t pRoot, const val_t & pVal);
+    size_t          clear                           (link_t pCur);
+    static size_t   clear_subtree                   (node_pool_t & pPool, link_t pRoot);
+    size_t          erase_range_ptr                 (const val_t & pLo, const val_t * pHi);
+
+    static link_t   copy_subtree                    (node_pool_t & pPool, const AgAVLTree & pOther, link_t pSrc, bool & pOk);
+    link_t          copy_forked                     (node_pool_t & pPool, const AgAVLTree & pOther, subtree_t pSrc, int32_t pForks, bool & pOk);
+
+    template <typename iter_t>
+    link_t          build_subtree                   (iter_t & pCur, iter_t pLast, size_t pCount, bool & pOk);
+    static int32_t  levels                          (size_t pCount);
 
-    bool            copy_subtree                    (node_ptr_t *pNodeThis, const node_ptr_t pNodeOther);
+    //      Split and join
 
-    //      Erase modifiers
+    int32_t         height                          (link_t pCur)                           const;
+    subtree_t       join                            (subtree_t pLeft, link_t pMid, subtree_t pRight);
+    link_t          split                           (subtree_t pCur, const val_t & pVal, subtree_t & pLeft, subtree_t & pRight);
+    subtree_t       concat                          (subtree_t pLeft, subtree_t pRight);
+    size_t          smaller_size                    (link_t pA, link_t pB, bool & pFirst)   const;
+    bool            adopt                           (AgAVLTree & pOther, subtree_t & pSub, size_t & pCount);
 
-    node_ptr_t      find_min_move_up                (link_ptr_t pCur);
-    node_ptr_t      find_min_move_up                ();
-    node_ptr_t      find_max_move_up                (link_ptr_t pCur);
-    node_ptr_t      find_max_move_up                ();
+    //      Set operations
+
+    subtree_t       unite                           (subtree_t pA, subtree_t pB, int32_t pForks, link_t & pGarbage);
+    subtree_t       intersect                       (subtree_t pA, const AgAVLTree & pOther, link_t pB, offset_t pOffset, int32_t pForks, link_t & pGarbage);
+    subtree_t       subtract                        (subtree_t pA, const AgAVLTree & pOther, link_t pB, offset_t pOffset, int32_t pForks, link_t & pGarbage);
+
+    template <typename left_t, typename right_t>
+    static void     fork                            (bool pParallel, left_t pLeft, right_t pRight);
+    static int32_t  forks                           (size_t pThreads);
+
+    void            discard                         (link_t pRoot, link_t & pGarbage)       const;
+    void            splice                          (link_t & pGarbage, link_t pOther)      const;
+    size_t          clear_list                      (link_t pGarbage);
 
     //      Binary search
 
-    node_ptr_t      find_ptr                        (const val_t & pVal)                    const;
-    node_ptr_t      first_greater_strict_ptr        (const val_t & pVal, node_ptr_t pVur)   const;
-    node_ptr_t      first_greater_strict_ptr        (const val_t & pVal)                    const;
-    node_ptr_t      first_greater_equals_ptr        (const val_t & pVal, node_ptr_t pCur)   const;
-    node_ptr_t      first_greater_equals_ptr        (const val_t & pVal)                    const;
-    node_ptr_t      last_smaller_strict_ptr         (const val_t & pVal, node_ptr_t pCur)   const;
-    node_ptr_t      last_smaller_strict_ptr         (const val_t & pVal)                    const;
-    node_ptr_t      last_smaller_equals_ptr         (const val_t & pVal, node_ptr_t pCur)   const;
-    node_ptr_t      last_smaller_equals_ptr         (const val_t & pVal)                    const;
+    link_t          find_ptr                        (const val_t & pVal)                    const;
+    link_t          first_greater_strict_ptr        (const val_t & pVal, link_t pCur, offset_t pOffset) const;
+    link_t          first_greater_strict_ptr        (const val_t & pVal)                    const;
+    link_t          first_greater_equals_ptr        (const val_t & pVal, link_t pCur, offset_t pOffset) const;
+    link_t          first_greater_equals_ptr        (const val_t & pVal)                    const;
+    link_t          last_smaller_strict_ptr         (const val_t & pVal, link_t pCur, offset_t pOffset) const;
+    link_t          last_smaller_strict_ptr         (const val_t & pVal)                    const;
+    link_t          last_smaller_equals_ptr         (const val_t & pVal, link_t pCur, offset_t pOffset) const;
+    link_t          last_smaller_equals_ptr         (const val_t & pVal)                    const;
+
+    std::pair<link_t, link_t>   equal_range_ptr     (const val_t & pVal)                    const;
+    std::pair<link_t, link_t>   bounds_ptr          (const val_t & pLo, const val_t & pHi)  const;
+
+    template <typename iter_t, typename func_t>
+    void            find_batch_ptr                  (iter_t pFirst, iter_t pLast, func_t pReport) const;
+
+    //      Order statistics
+
+    size_t          subtree_size                    (link_t pCur)                           const;
+    size_t          count_less_strict               (const val_t & pVal, link_t pCur, offset_t pOffset) const;
+    size_t          count_less_equals               (const val_t & pVal, link_t pCur, offset_t pOffset) const;
+    size_t          count_greater_equals            (const val_t & pVal, link_t pCur, offset_t pOffset) const;
+
+    //      Range aggregates
+
+    template <typename policy_t>
+    typename policy_t::summary_t summary_less_equals    (const val_t & pVal, link_t pCur)   const;
+    template <typename policy_t>
+    typename policy_t::summary_t summary_greater_equals (const val_t & pVal, link_t pCur)   const;
+
+    //      Differences
+
+    auto            summary_between                 (const val_t * pLo, const val_t * pHi)  const;
+    template <typename out_here_t, typename out_there_t>
+    void            diff_range                      (link_t pCur, const val_t * pLo, const val_t * pHi, const AgAVLTree & pOther, out_here_t & pOnlyHere, out_there_t & pOnlyThere) const;
+
+    //      Random sampling
+
+    template <typename rng_t>
+    auto            random_weight                   (rng_t & pRng)                          const;
+    template <bool mWeighted, typename key_t, typename out_iter_t>
+    out_iter_t      sample_sorted                   (const std::vector<key_t> & pKeys, out_iter_t pOut) const;
 };
 
 
 /**
- * @brief Construct a new AgAVLTree<val_t, mComp, mEquals>::AgAVLTree object
+ * @brief Construct a new AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::AgAVLTree object
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::AgAVLTree () noexcept :
+    mAlloc {alloc_t ()}
+{
+}
+
+/**
+ * @brief                   Construct a new AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::AgAVLTree object whose nodes are allocated using the given allocator
+ *
+ * @param pAlloc            Allocator to get memory for nodes from (e.g. a std::pmr::polymorphic_allocator backed by an arena)
  */
-template <typename val_t, auto mComp, auto mEquals>
-AgAVLTree<val_t, mComp, mEquals>::AgAVLTree () noexcept
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::AgAVLTree (const alloc_t &pAlloc) noexcept :
+    mAlloc {pAlloc}
 {
 }
 
 /**
- * @brief                   Copy construct a new AgAVLTree<val_t, mComp, mEquals>::AgAVLTree object
+ * @brief                   Copy construct a new AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::AgAVLTree object
  *
  * @param pOther            Tree to copy
  */
-template <typename val_t, auto mComp, auto mEquals>
-AgAVLTree<val_t, mComp, mEquals>::AgAVLTree (const AgAVLTree &pOther) noexcept
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::AgAVLTree (const AgAVLTree &pOther) noexcept :
+    AgAVLTree (pOther, 1)
 {
-    clear ();
+}
 
-    if (pOther.size () == 0) {
+/**
+ * @brief                   Copy construct a new AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::AgAVLTree object, copying large subtrees on several threads
+ *
+ * @note                    The other tree is walked without recursion, and all the nodes are set aside before copying. The two halves of a large
+ *                          subtree are copied on separate threads (as long as the number of threads allows, see copy_forked), so pThreads - 1
+ *                          threads are started at most. If memory runs out, all nodes copied so far are destroyed and the tree is left empty
+ *
+ * @param pOther            Tree to copy
+ * @param pThreads          Maximum number of threads to copy on (including the calling thread)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::AgAVLTree (const AgAVLTree &pOther, size_t pThreads) noexcept :
+    mAlloc {std::allocator_traits<alloc_t>::select_on_container_copy_construction (pOther.get_allocator ())}
+{
+    if (pOther.mRoot == NIL) {
         return;
     }
 
-    if (!copy_subtree (&mRoot, pOther.mRoot)) {
-        // set some flag to false
+    size_t      cnt     {pOther.size ()};
+
+    // get all the nodes up front (links into nodes are held while copying, so no node must move)
+    bool        ok      {reserve_nodes (cnt)};
+
+    if (ok) {
+        mRoot   = copy_forked (*mPool, pOther, {pOther.mRoot, pOther.height (pOther.mRoot)}, forks (pThreads), ok);
+    }
+
+    // nothing of a failed copy is kept
+    if (!ok) {
+        mRoot   = NIL;
+        drop_pool ();
         return;
     }
 
-    mSz = pOther.size ();
+    mSz = cnt;
 }
 
 /**
- * @brief                   Move construct a new AgAVLTree<val_t, mComp, mEquals>::AgAVLTree object
+ * @brief                   Move construct a new AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::AgAVLTree object
  *
  * @param pOther            Tree to move
  */
-template <typename val_t, auto mComp, auto mEquals>
-AgAVLTree<val_t, mComp, mEquals>::AgAVLTree (AgAVLTree &&pOther) noexcept
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::AgAVLTree (AgAVLTree &&pOther) noexcept :
+    mAlloc {pOther.mAlloc}, mPool {pOther.mPool}
 {
-    mSz             = pOther.size ();
+    mSz             = pOther.mSz;
     mRoot           = pOther.mRoot;
 
-    pOther.mRoot    = nullptr;
+    pOther.mRoot    = NIL;
+    pOther.mSz      = 0;
+    pOther.mPool    = nullptr;
 }
 
-template <typename val_t, auto mComp, auto mEquals>
-bool
-AgAVLTree<val_t, mComp, mEquals>::copy_subtree (node_ptr_t *pNodeThis, const node_ptr_t pNodeOther)
+/**
+ * @brief                   Copies the subtree of a node of another tree without recursing
+ *
+ * @note                    The nodes are copied in preorder, following left children first, while the right children still to be copied
+ *                          are kept on a small fixed-size stack along with the copies of their parents (so each node is read only once)
+ *
+ * @param pPool             Pool from which the copies are allocated (must not move any node while copying)
+ * @param pOther            Tree holding the subtree (only read)
+ * @param pSrc              Link to the root of the subtree
+ * @param pOk               Reference to variable which is set to false if a node could not be allocated (nothing is kept in that case)
+ *
+ * @return link_t           Link to the root of the copy (its parent link is left null)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::copy_subtree (node_pool_t & pPool, const AgAVLTree & pOther, link_t pSrc, bool & pOk)
 {
-    if (pNodeOther == nullptr) {
-        return true;
-    }
+    link_t      pending[MAX_DEPTH];                 // right children still to be copied
+    link_t      parents[MAX_DEPTH];                 // copies of their parents
+    size_t      top     {0};
 
-    // try to copy the current node, if could not allocate, return failed
-    *pNodeThis      = new (std::nothrow) node_t {nullptr, nullptr, pNodeOther->height, pNodeOther->val};
-    if (*pNodeThis == nullptr) {
-        return false;
-    }
+    link_t      root    {NIL};
+    link_t      par     {NIL};
+    bool        left    {false};                    // whether the next copy is the left child of the copy of its parent
+    link_t      ins;
+    node_ptr_t  src;
+    node_ptr_t  cpy;
 
-    // recursively repeat for both children
-    return copy_subtree (&((*pNodeThis)->lptr), pNodeOther->lptr) && copy_subtree (&((*pNodeThis)->rptr), pNodeOther->rptr);
-}
+    while (pSrc != NIL) {
 
-/**
- * @brief Destroy the AgAVLTree<val_t, mComp, mEquals>::AgAVLTree object
- */
-template <typename val_t, auto mComp, auto mEquals>
-AgAVLTree<val_t, mComp, mEquals>::~AgAVLTree ()
-{
-    clear();
+        ins = pPool.allocate ();
+
+        if (ins == NIL) {
+            DBG_MODE (std::cout << "Could not allocate new node\n";)
+            clear_subtree (pPool, root);
+            pOk = false;
+            return NIL;
+        }
+
+        src = pOther.node (pSrc);
+        cpy = new (pPool.get (ins)) node_t {NIL, NIL, par, src->val};
+        set_balance (cpy, get_balance (src));
+
+        // the copy of the subtree has the same shape, so the fields the node keeps about it stay the same
+        static_cast<node_extra_t &> (*cpy) = *src;
+
+        if (par == NIL) {
+            root = ins;
+        }
+        else if (left) {
+            pPool.get (par)->lptr = ins;
+        }
+        else {
+            pPool.get (par)->rptr = ins;
+        }
+
+        if (src->lptr != NIL) {
+            if (src->rptr != NIL) {
+                pending[top]    = src->rptr;
+                parents[top++]  = ins;
+            }
+            pSrc    = src->lptr;
+            par     = ins;
+            left    = true;
+        }
+        else if (src->rptr != NIL) {
+            pSrc    = src->rptr;
+            par     = ins;
+            left    = false;
+        }
+        else if (top != 0) {
+            pSrc    = pending[--top];
+            par     = parents[top];
+            left    = false;
+        }
+        else {
+            pSrc    = NIL;
+        }
+    }
+
+    return root;
 }
 
 /**
- * @brief                   Attempts to insert a value into the tree
+ * @brief                   Copies the subtree of a node of another tree, copying the two halves of large subtrees on separate threads
  *
- * @param pVal              The value to be inserted into the tree
+ * @note                    The left half is copied into a pool of its own (so that the two threads never allocate from the same pool), whose
+ *                          chunks are then taken over. The nodes of a compact tree all live in a single arena, which can only be handed out
+ *                          from one thread, so compact trees are always copied on the calling thread
  *
- * @return true             If insertion was successful
- * @return false            If insertion failed
+ * @param pPool             Pool from which the copies are allocated (must not move any node while copying)
+ * @param pOther            Tree holding the subtree (only read)
+ * @param pSrc              The subtree to copy
+ * @param pForks            Number of levels at which the two halves may still be copied on separate threads
+ * @param pOk               Reference to variable which is set to false if a node could not be allocated (nothing is kept in that case)
+ *
+ * @return link_t           Link to the root of the copy (its parent link is left null)
  */
-template <typename val_t, auto mComp, auto mEquals>
-bool
-AgAVLTree<val_t, mComp, mEquals>::insert (const val_t &pVal)
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::copy_forked (node_pool_t & pPool, const AgAVLTree & pOther, subtree_t pSrc, int32_t pForks, bool & pOk)
 {
-    if (insert (&mRoot, pVal)) {
+    if (mCompact || pForks <= 0 || pSrc.height < PARALLEL_HEIGHT) {
+        return copy_subtree (pPool, pOther, pSrc.root, pOk);
+    }
+
+    link_t      ins     {pPool.allocate ()};
+
+    if (ins == NIL) {
+        pOk = false;
+        return NIL;
+    }
+
+    node_ptr_t  src     {pOther.node (pSrc.root)};
+    node_ptr_t  cpy     {new (pPool.get (ins)) node_t {NIL, NIL, NIL, src->val}};
+    int8_t      bal     {get_balance (src)};
+
+    set_balance (cpy, bal);
+    static_cast<node_extra_t &> (*cpy) = *src;
+
+    subtree_t   sl      {src->lptr, pSrc.height - ((bal <= 0) ? (1) : (2))};
+    subtree_t   sr      {src->rptr, pSrc.height - ((bal >= 0) ? (1) : (2))};
+
+    node_pool_t lpool   (mAlloc);
+    bool        lok     {true};
+    link_t      lptr;
+    link_t      rptr;
+
+    fork (true, [&] { lptr = copy_forked (lpool, pOther, sl, pForks - 1, lok); },
+                [&] { rptr = copy_forked (pPool, pOther, sr, pForks - 1, pOk); });
+
+    // the nodes of the left half are handed over along with the chunks of its pool (if they can not be, the copy is undone)
+    if (lptr != NIL && !pPool.absorb (lpool)) {
+        clear_subtree (lpool, lptr);
+        lptr    = NIL;
+        lok     = false;
+    }
+
+    cpy->lptr   = lptr;
+    cpy->rptr   = rptr;
+    set_parent (lptr, ins);
+    set_parent (rptr, ins);
+
+    if (!lok || !pOk) {
+        clear_subtree (pPool, ins);
+        pOk = false;
+        return NIL;
+    }
+
+    return ins;
+}
+
+/**
+ * @brief                   Construct a new AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::AgAVLTree object holding all values of a range
+ *
+ * @note                    See assign (a sorted range is built into a perfectly balanced tree in linear time)
+ *
+ * @tparam iter_t           Type of forward iterator to the values
+ *
+ * @param pFirst            Iterator to the first value of the range
+ * @param pLast             Iterator past the last value of the range
+ * @param pAlloc            Allocator to get memory for nodes from
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+template <typename iter_t>
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::AgAVLTree (iter_t pFirst, iter_t pLast, const alloc_t &pAlloc) :
+    mAlloc {pAlloc}
+{
+    assign (pFirst, pLast);
+}
+
+/**
+ * @brief                   Builds a perfectly balanced subtree out of the next values of a sorted range (skipping repeated values)
+ *
+ * @note                    Nodes are created in order, each after its left subtree (which is then hung from it), so that values are read
+ *                          in a single pass. The left subtree gets the smaller half of the values, so it is never taller than the right one
+ *
+ * @tparam iter_t           Type of forward iterator to the values
+ *
+ * @param pCur              Reference to iterator to the next value to be taken (moved past all values taken)
+ * @param pLast             Iterator past the last value of the range
+ * @param pCount            Number of distinct values to take
+ * @param pOk               Reference to variable which is set to false if a node could not be allocated (nothing is kept in that case)
+ *
+ * @return link_t           Link to the root of the new subtree (its parent link is left null)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+template <typename iter_t>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::build_subtree (iter_t & pCur, iter_t pLast, size_t pCount, bool & pOk)
+{
+    if (pCount == 0) {
+        return NIL;
+    }
+
+    size_t      lcnt    {(pCount - 1) / 2};
+    size_t      rcnt    {pCount - 1 - lcnt};
+
+    link_t      lptr    {build_subtree (pCur, pLast, lcnt, pOk)};
+
+    if (!pOk) {
+        return NIL;
+    }
+
+    // the value of this node comes right after all values of its left subtree
+    link_t      ins     {mPool->allocate ()};
+
+    if (ins == NIL) {
+        DBG_MODE (std::cout << "Could not allocate new node\n";)
+        if (lptr != NIL) {
+            clear (lptr);
+        }
+        pOk = false;
+        return NIL;
+    }
+    new (node (ins)) node_t {lptr, NIL, NIL, *pCur};
+    set_parent (lptr, ins);
+
+    // skip over all copies of the value just taken
+    for (iter_t prv = pCur++; pCur != pLast && compare (*prv, *pCur) == 0; ++pCur) {}
+
+    link_t      rptr    {build_subtree (pCur, pLast, rcnt, pOk)};
+
+    if (!pOk) {
+        clear (ins);
+        return NIL;
+    }
+
+    node_ptr_t  cur     {node (ins)};
+
+    cur->rptr = rptr;
+    set_parent (rptr, ins);
+    set_balance (cur, (int8_t)(levels (rcnt) - levels (lcnt)));
+    update (ins);
+
+    return ins;
+}
+
+/**
+ * @brief                   Returns the height of a perfectly balanced subtree with a given number of nodes
+ *
+ * @param pCount            Number of nodes in the subtree
+ *
+ * @return int32_t          Number of levels of the subtree (0 if it is empty)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+int32_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::levels (size_t pCount)
+{
+    int32_t res {0};
+
+    for (; pCount != 0; pCount >>= 1) {
+        ++res;
+    }
+    return res;
+}
+
+/**
+ * @brief Destroy the AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::AgAVLTree object
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::~AgAVLTree ()
+{
+    clear();
+}
+
+/**
+ * @brief                   Attempts to insert a value into the tree
+ *
+ * @param pVal              The value to be inserted into the tree
+ *
+ * @return true             If insertion was successful
+ * @return false            If insertion failed
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+bool
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::insert (const val_t &pVal)
+{
+    // links into nodes are held while descending, so make sure the new node can be allocated without moving any node
+    if (!reserve_nodes (1)) {
+        return false;
+    }
+
+    link_t  res;
+
+    if (insert (&mRoot, pVal, res)) {
         ++mSz;
         return true;
     }
     return false;
 }
 
+/**
+ * @brief                   Attempts to insert a value into the tree right before the element an iterator points to
+ *
+ * @note                    If the value lies between the element of the hint and the one before it, the new node is put right next to them
+ *                          (as the left child of the former, or the right child of the latter), so that only two comparisons are made, and
+ *                          balance factors are updated upwards from there (in amortized O(1) time). This makes a hint of end () a fast
+ *                          path for appending values greater than all others, as they arrive from a sorted stream. If the hint is wrong, the
+ *                          value is inserted by descending from the root as usual
+ *
+ * @param pHint             Iterator to the element which the value should be inserted before (end () to append it after all others)
+ * @param pVal              The value to be inserted into the tree
+ *
+ * @return iterator         Iterator to the inserted element (or the element equal to the value, if it was already present), end () if
+ *                          the insertion failed
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::insert (iterator pHint, const val_t &pVal)
+{
+    // links into nodes are held while linking in the new node, so make sure it can be allocated without moving any node
+    if (!reserve_nodes (1)) {
+        return end ();
+    }
+
+    link_t  nxt     {pHint.mPtr};
+    link_t  prv     {(nxt != NIL) ? (prev_ptr (nxt)) : (find_max ())};
+    link_t  res;
+    int32_t cmp;
+
+    // the hint is right if the value is smaller than the element of the hint, and greater than the one before it
+    bool    hit     {true};
+
+    if (nxt != NIL) {
+        cmp = compare (pVal, value_of (nxt));
+        if (cmp == 0) {
+            return iterator (nxt, this);
+        }
+        hit = cmp < 0;
+    }
+    if (hit && prv != NIL) {
+        cmp = compare (pVal, value_of (prv));
+        if (cmp == 0) {
+            return iterator (prv, this);
+        }
+        hit = cmp > 0;
+    }
+
+    if (!hit) {
+        if (insert (&mRoot, pVal, res)) {
+            ++mSz;
+        }
+        return iterator (res, this);
+    }
+
+    // the element before the hint is the greatest in the left subtree of the hint if it has one (so it has no right child)
+    if (nxt != NIL && node (nxt)->lptr == NIL) {
+        res = insert_at (nxt, true, pVal);
+    }
+    else {
+        res = insert_at (prv, false, pVal);
+    }
+
+    mSz += (res != NIL);
+    return iterator (res, this);
+}
+
 /**
  * @brief                   Attempts to erase a value from the tree
  *
@@ -370,9 +1299,9 @@ AgAVLTree<val_t, mComp, mEquals>::insert (const val_t &pVal)
  * @return true             If value was successfuly erased
  * @return false            If value could not be successfuly erased (likely not found)
  */
-template <typename val_t, auto mComp, auto mEquals>
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
 bool
-AgAVLTree<val_t, mComp, mEquals>::erase (const val_t &pVal)
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::erase (const val_t &pVal)
 {
     if (erase (&mRoot, pVal)) {
         --mSz;
@@ -382,978 +1311,4582 @@ AgAVLTree<val_t, mComp, mEquals>::erase (const val_t &pVal)
 }
 
 /**
- * @brief                   Erases all elements from the tree (bringing size to 0)
+ * @brief                   Erases all elements lying in the half-open range [pLo, pHi)
+ *
+ * @note                    See erase_range_ptr (the range is cut out in O(log n + k) for k erased elements)
+ *
+ * @param pLo               The smallest value to be erased
+ * @param pHi               The value up to which (exclusive) elements are erased
+ *
+ * @return size_t           Number of elements which were erased (0 if pHi is not greater than pLo)
  */
-template <typename val_t, auto mComp, auto mEquals>
-void
-AgAVLTree<val_t, mComp, mEquals>::clear ()
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+size_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::erase_range (const val_t &pLo, const val_t &pHi)
 {
-    // if the root does not exist, return
-    if (mRoot == nullptr) {
-        return;
+    // an empty or inverted interval contains nothing
+    if (!less (pLo, pHi)) {
+        return 0;
     }
+    return erase_range_ptr (pLo, &pHi);
+}
 
-    // start clearing recursively starting from the root
-    clear (mRoot);
-    mRoot   = nullptr;
-    mSz     = 0;
+/**
+ * @brief                   Erases all elements from one iterator up to (but excluding) another
+ *
+ * @note                    See erase_range_ptr (the range is cut out in O(log n + k) for k erased elements)
+ *
+ * @param pFirst            Iterator to the first element to be erased
+ * @param pLast             Iterator to the element after the last one to be erased (may be end ())
+ *
+ * @return iterator         Iterator to the element after the last one erased (pLast stays valid)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::erase (iterator pFirst, iterator pLast)
+{
+    if (pFirst == pLast) {
+        return pLast;
+    }
+
+    if (pLast == end ()) {
+        erase_range_ptr (*pFirst, nullptr);
+        return pLast;
+    }
+
+    // the values of both ends are read from their nodes, which are only moved around (not destroyed) until the range has been cut out
+    // (iterators of shiftable trees give copies of the values, which are kept here until then)
+    const val_ref_t     hi  {*pLast};
+
+    erase_range_ptr (*pFirst, &hi);
+    return pLast;
 }
 
 /**
- * @brief                   Checks and returns whether a given value exists in the tree
+ * @brief                   Splits the tree at a value, moving all elements not less than it into a new tree
  *
- * @param pVal              The value to be found
+ * @note                    The tree is split along the path to the value in O(log n) time, without comparing any element off the path. The
+ *                          new tree gets a pool of its own and takes over the nodes of the moved elements, whose chunks it keeps alive along
+ *                          with this tree (see share), so the two trees can be changed and destroyed on different threads. To keep both
+ *                          sizes known, the smaller part is counted (see smaller_size), so the split takes O(log n + k) time for k elements
+ *                          in the smaller part (O(log n) in counted trees). Nodes can not be shared between arenas, so in compact mode the
+ *                          smaller part is copied into a new arena instead (and its old nodes destroyed), also in O(log n + k) time.
+ *                          Iterators to moved elements are invalidated
  *
- * @return true             If the value is present in the tree
- * @return false            If the value is not present in the tree
+ * @param pVal              Value at which to split (an element equal to it is moved)
+ *
+ * @return AgAVLTree        Tree holding all the elements not less than pVal (this tree keeps all the smaller ones), which is empty (and
+ *                          this tree unchanged) if memory for its pool (or the copies in compact mode) could not be allocated
  */
-template <typename val_t, auto mComp, auto mEquals>
-bool
-AgAVLTree<val_t, mComp, mEquals>::exists (const val_t &pVal) const
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::split (const val_t &pVal)
 {
-    node_ptr_t cur {mRoot};
+    AgAVLTree   res     (mAlloc);
 
-    // repeat while a valid node is being pointed to (not crossed a leaf)
-    while (cur != nullptr) {
+    if (mRoot == NIL) {
+        return res;
+    }
 
-        // if a matching node was found, return success
-        if (mEquals (pVal, cur->val)) {
-            return true;
+    subtree_t   left;
+    subtree_t   right;
+    link_t      key     {split ({mRoot, height (mRoot)}, pVal, left, right)};
+
+    // an element equal to the value goes to the new tree, as its smallest element
+    if (key != NIL) {
+        right = join ({NIL, 0}, key, right);
+    }
+
+    // if no element is kept, the new tree takes over the whole pool (if none is moved, it stays empty)
+    if (left.root == NIL) {
+        res.mPool   = mPool;
+        res.mSz     = mSz;
+        res.mRoot   = right.root;
+        mPool       = nullptr;
+        mSz         = 0;
+        mRoot       = NIL;
+        return res;
+    }
+    if (right.root == NIL) {
+        mRoot       = left.root;
+        return res;
+    }
+
+    bool        leftSmaller;
+    size_t      small   {smaller_size (left.root, right.root, leftSmaller)};
+    size_t      lcnt    {(leftSmaller) ? (small) : (mSz - small)};
+    bool        ok      {true};
+
+    if constexpr (mCompact) {
+
+        // the new tree takes over the arena if it gets the larger part, and the smaller part is copied into a new arena
+        link_t  cpy;
+
+        if (leftSmaller) {
+            res.mPool   = mPool;
+            mPool       = nullptr;
+            ok          = reserve_nodes (small);
+            cpy         = (ok) ? (copy_subtree (*mPool, res, left.root, ok)) : (NIL);
+
+            if (ok) {
+                clear_subtree (*res.mPool, left.root);
+                left.root   = cpy;
+            }
+            else {
+                drop_pool ();
+                mPool       = res.mPool;
+                res.mPool   = nullptr;
+            }
+        }
+        else {
+            ok          = res.reserve_nodes (small);
+            cpy         = (ok) ? (copy_subtree (*res.mPool, *this, right.root, ok)) : (NIL);
+
+            if (ok) {
+                clear_subtree (*mPool, right.root);
+                right.root  = cpy;
+            }
         }
+    }
+    else {
+        ok  = res.reserve_nodes (0) && mPool->share (*res.mPool);
+    }
 
-        // go left if current node is too big, else go right
-        cur = (mComp (pVal, cur->val)) ? (cur->lptr) : (cur->rptr);
+    // nothing is moved if memory ran out, and the two parts are put back together
+    if (!ok) {
+        res.drop_pool ();
+        mRoot       = concat (left, right).root;
+        return res;
     }
 
-    // if no match was found, return null
-    return false;
+    mRoot       = left.root;
+    res.mRoot   = right.root;
+    res.mSz     = mSz - lcnt;
+    mSz         = lcnt;
+
+    return res;
 }
 
 /**
- * @brief                   Finds and returns an iterator to a given value (end() if no match exists in the tree)
+ * @brief                   Moves all elements of another tree, which must all be greater than those of this tree, to the end of this tree
  *
- * @param pVal              The value to be found
+ * @note                    The two trees are joined in O(log n) time if their nodes can be handed over as they are, which is the case if both
+ *                          use equal allocators (in which case the chunks of the pool of the other tree are taken over, see absorb), unless
+ *                          in compact mode or if both trees share unrelated chunks with other trees (after being split off from different trees).
+ *                          Otherwise the elements are copied into new nodes in O(m) time for m elements (they are already sorted, so the
+ *                          copies are built into a balanced subtree without any comparisons or rotations), and the other tree is cleared
+ *
+ * @param pRight            Tree to be joined (left empty)
  *
- * @return AgAVLTree<val_t, mComp, mEquals>::iterator Iterator to matching value in the tree (end() if no match found)
+ * @return true             If the elements were moved
+ * @return false            If some element of pRight is not greater than all elements of this tree, or memory could not be allocated (in
+ *                          which case neither tree is changed)
  */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::iterator
-AgAVLTree<val_t, mComp, mEquals>::find (const val_t &pVal) const
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+bool
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::join (AgAVLTree &&pRight)
 {
-    // get a pointer to the node with the appropriate value and give its ownership to an iterator instance
-    // in case nullptr is recieved, the iterator points to end()
-    node_ptr_t res  {find_ptr (pVal)};
-    return iterator (res, this);
+    if (pRight.mRoot == NIL) {
+        return true;
+    }
+
+    // the greatest element of this tree must be smaller than the smallest element of the other
+    if (mRoot != NIL && !less (value_of (find_max (mRoot)), pRight.value_of (pRight.find_min (pRight.mRoot)))) {
+        return false;
+    }
+
+    subtree_t   sub;
+    size_t      cnt;
+
+    if (!adopt (pRight, sub, cnt)) {
+        return false;
+    }
+
+    mRoot   = concat ({mRoot, height (mRoot)}, sub).root;
+    mSz     += cnt;
+
+    return true;
 }
 
 /**
- * @brief                   Finds and returns an iterator to the first value strictly greater than the given value (end() if no match exists)
+ * @brief                   Moves all elements of another tree into this tree, dropping those which are already present
  *
- * @param pVal              The value to be compared with
+ * @note                    Same as set_union on a single thread. The nodes of the other tree are reused, so nothing is allocated unless the
+ *                          trees use different allocators or are compact (see adopt). If the ranges of the elements of the two trees do not
+ *                          overlap, the trees are concatenated in O(log n) time, and otherwise each node of the other tree is linked into place
+ *
+ * @param pOther            Tree whose elements are to be moved (left empty)
  *
- * @return AgAVLTree<val_t, mComp, mEquals>::iterator Iterator to first strictly greater value in the tree (end() if no match found)
+ * @return size_t           Number of elements which were added (0 if memory to copy the elements of pOther could not be allocated)
  */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::iterator
-AgAVLTree<val_t, mComp, mEquals>::first_greater_strict (const val_t &pVal) const
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+size_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::merge (AgAVLTree &&pOther)
 {
-    // get a pointer to the node with the appropriate value and give its ownership to an iterator instance
-    // in case nullptr is recieved, the iterator points to end()
-    node_ptr_t res  {first_greater_strict_ptr (pVal)};
-    return iterator (res, this);
+    return set_union (std::move (pOther), 1);
 }
 
 /**
- * @brief                   Finds and returns an iterator to the first value greater than or equal to the given value (end() if no match exists)
+ * @brief                   Adds all elements of another tree to this tree (elements already present are kept from this tree)
  *
- * @param pVal               The value to be compared with
+ * @note                    The nodes of the other tree are taken over as in join. If all elements of one tree are smaller than those of the
+ *                          other, the two are concatenated in O(log n) time. Otherwise they are merged by splitting this tree around the root
+ *                          of the other one, and merging the matching halves recursively, in O(m log (n / m + 1)) time for trees of m and n
+ *                          elements. The two halves of a large subtree are merged on separate threads (as long as the number of threads
+ *                          allows), so pThreads - 1 threads are started at most
+ *
+ * @param pOther            Tree whose elements are to be added (left empty)
+ * @param pThreads          Maximum number of threads to run on (including the calling thread)
  *
- * @return AgAVLTree<val_t, mComp, mEquals>::iterator Iterator to first greater or equal value in the tree (end() if no match found)
+ * @return size_t           Number of elements which were added (0 if memory to copy the elements of pOther could not be allocated)
  */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::iterator
-AgAVLTree<val_t, mComp, mEquals>::first_greater_equals (const val_t &pVal) const
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+size_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::set_union (AgAVLTree &&pOther, size_t pThreads)
 {
-    // get a pointer to the node with the appropriate value and give its ownership to an iterator instance
-    // in case nullptr is recieved, the iterator points to end()
-    node_ptr_t res  {first_greater_equals_ptr (pVal)};
-    return iterator (res, this);
+    if (pOther.mRoot == NIL || &pOther == this) {
+        return 0;
+    }
+
+    subtree_t   sub;
+    size_t      cnt     {pOther.size ()};
+
+    if (!adopt (pOther, sub, cnt)) {
+        return 0;
+    }
+
+    subtree_t   cur     {mRoot, height (mRoot)};
+    size_t      dups    {0};
+
+    // trees whose ranges of elements do not overlap are simply concatenated
+    if (mRoot == NIL || less (value_of (find_max (mRoot)), value_of (find_min (sub.root)))) {
+        mRoot   = concat (cur, sub).root;
+    }
+    else if (less (value_of (find_max (sub.root)), value_of (find_min (mRoot)))) {
+        mRoot   = concat (sub, cur).root;
+    }
+    else {
+        link_t  garbage {NIL};
+
+        mRoot   = unite (cur, sub, forks (pThreads), garbage).root;
+        dups    = clear_list (garbage);
+    }
+
+    mSz     += cnt - dups;
+
+    return cnt - dups;
 }
 
 /**
- * @brief                   Finds and returns an iterator to the last value strictly less than the given value (end() if no match exists)
+ * @brief                   Erases all elements of the tree which are not present in another tree
+ *
+ * @note                    This tree is split around the root of the other tree, and the matching halves are intersected with its subtrees
+ *                          recursively (on separate threads for large subtrees, see set_union) and joined back, in O(m log (n / m + 1))
+ *                          time. The other tree is only read, and the erased nodes are destroyed after all threads have finished
+ *
+ * @param pOther            Tree to intersect with (not modified)
+ * @param pThreads          Maximum number of threads to run on (including the calling thread)
+ *
+ * @return size_t           Number of elements which were erased
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+size_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::set_intersection (const AgAVLTree &pOther, size_t pThreads)
+{
+    if (mRoot == NIL || &pOther == this) {
+        return 0;
+    }
+
+    link_t      garbage {NIL};
+
+    mRoot   = intersect ({mRoot, height (mRoot)}, pOther, pOther.mRoot, {}, forks (pThreads), garbage).root;
+
+    size_t      res     {clear_list (garbage)};
+
+    mSz     -= res;
+    return res;
+}
+
+/**
+ * @brief                   Erases all elements of the tree which are present in another tree
+ *
+ * @note                    See set_intersection (this tree is split in the same way, but the matching halves are joined back without the
+ *                          elements present in both)
+ *
+ * @param pOther            Tree whose elements are to be erased (not modified)
+ * @param pThreads          Maximum number of threads to run on (including the calling thread)
+ *
+ * @return size_t           Number of elements which were erased
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+size_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::set_difference (const AgAVLTree &pOther, size_t pThreads)
+{
+    // every element is present in the tree itself
+    if (&pOther == this) {
+        size_t  res {size ()};
+        clear ();
+        return res;
+    }
+
+    if (mRoot == NIL || pOther.mRoot == NIL) {
+        return 0;
+    }
+
+    link_t      garbage {NIL};
+
+    mRoot   = subtract ({mRoot, height (mRoot)}, pOther, pOther.mRoot, {}, forks (pThreads), garbage).root;
+
+    size_t      res     {clear_list (garbage)};
+
+    mSz     -= res;
+    return res;
+}
+
+/**
+ * @brief                   Erases all elements from the tree (bringing size to 0)
+ *
+ * @note                    If the values need no destructor, the nodes are not visited at all, and go along with the chunks of the pool in
+ *                          O(chunks) time (a single arena in compact mode). Otherwise each node is destroyed
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+void
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::clear ()
+{
+    if (mRoot != NIL && !(std::is_trivially_destructible<node_t>::value && mPool->releasable ())) {
+        clear (mRoot);
+    }
+
+    // give back the memory of all the nodes at once (chunks shared with other trees go once the last of them lets go)
+    drop_pool ();
+    mRoot   = NIL;
+    mSz     = 0;
+}
+
+/**
+ * @brief                   Replaces the contents of the tree with all values of a range
+ *
+ * @note                    If the range is sorted in ascending order (equal values may repeat, only one of them is kept), the tree is built
+ *                          bottom-up in a single pass in O(n), with all nodes reserved up front and the balance factors known from the sizes
+ *                          of the subtrees, so no comparisons or rotations are made. Otherwise the values are inserted one by one.
+ *                          The range must not refer to values held by the tree itself
+ *
+ * @tparam iter_t           Type of forward iterator to the values
+ *
+ * @param pFirst            Iterator to the first value of the range
+ * @param pLast             Iterator past the last value of the range
+ *
+ * @return true             If all values were added to the tree
+ * @return false            If memory for the nodes could not be allocated (the tree is left empty if the range was sorted)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+template <typename iter_t>
+bool
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::assign (iter_t pFirst, iter_t pLast)
+{
+    static_assert (std::is_base_of<std::forward_iterator_tag, typename std::iterator_traits<iter_t>::iterator_category>::value,
+                   "Values must be given by forward iterators (the range is read twice)");
+
+    clear ();
+
+    if (pFirst == pLast) {
+        return true;
+    }
+
+    // count the distinct values, and make sure that they are in order
+    size_t  cnt     {1};
+    bool    sorted  {true};
+
+    for (iter_t prv = pFirst, cur = std::next (pFirst); cur != pLast; ++prv, ++cur) {
+
+        int32_t res {compare (*prv, *cur)};
+
+        if (res > 0) {
+            sorted = false;
+            break;
+        }
+        cnt += (res < 0);
+    }
+
+    // an unsorted range can only be inserted value by value
+    if (!sorted) {
+
+        bool    ok  {true};
+        link_t  res;
+
+        for (; pFirst != pLast; ++pFirst) {
+            if (!reserve_nodes (1)) {
+                ok = false;
+            }
+            else if (insert (&mRoot, *pFirst, res)) {
+                ++mSz;
+            }
+        }
+        return ok;
+    }
+
+    // get all the nodes up front, and build the tree from the bottom up
+    bool    ok      {reserve_nodes (cnt)};
+
+    if (ok) {
+        mRoot = build_subtree (pFirst, pLast, cnt, ok);
+    }
+
+    if (!ok) {
+        clear ();
+        return false;
+    }
+
+    mSz = cnt;
+    return true;
+}
+
+/**
+ * @brief                   Inserts all values of a range into the tree at once
+ *
+ * @note                    The values are sorted and built into a perfectly balanced tree, which is then merged into the tree by splitting and
+ *                          joining subtrees, in O(m log (n / m + 1)) for m values and n elements (instead of one descent per value).
+ *                          Values already present in the tree are skipped (the elements of the tree are kept), and of values repeated in the
+ *                          range only the first is inserted
+ *
+ * @tparam iter_t           Type of input iterator to the values
+ *
+ * @param pFirst            Iterator to the first value of the range
+ * @param pLast             Iterator past the last value of the range
+ *
+ * @return size_t           Number of values which were newly inserted (0 if memory for the new nodes could not be allocated)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+template <typename iter_t>
+size_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::insert_batch (iter_t pFirst, iter_t pLast)
+{
+    std::vector<val_t>  batch   (pFirst, pLast);
+
+    if (batch.empty ()) {
+        return 0;
+    }
+
+    // keep repeated values in their order, so that the first of them is inserted (as when inserting them one by one)
+    std::stable_sort (batch.begin (), batch.end (), [] (const val_t & pA, const val_t & pB) { return less (pA, pB); });
+
+    size_t  cnt     {1};
+
+    for (size_t i = 1; i < batch.size (); ++i) {
+        cnt += (size_t)(compare (batch[i - 1], batch[i]) != 0);
+    }
+
+    // get all the new nodes up front (no node is allocated while merging, so no node moves)
+    if (!reserve_nodes (cnt)) {
+        return 0;
+    }
+
+    bool    ok      {true};
+    auto    cur     {batch.cbegin ()};
+    link_t  root    {build_subtree (cur, batch.cend (), cnt, ok)};
+
+    if (!ok) {
+        return 0;
+    }
+
+    link_t      garbage {NIL};
+    subtree_t   res     {unite ({mRoot, height (mRoot)}, {root, levels (cnt)}, 0, garbage)};
+    size_t      dups    {clear_list (garbage)};
+
+    mRoot   = res.root;
+    mSz     += cnt - dups;
+
+    return cnt - dups;
+}
+
+/**
+ * @brief                   Checks and returns whether a given value exists in the tree
+ *
+ * @param pVal              The value to be found
+ *
+ * @return true             If the value is present in the tree
+ * @return false            If the value is not present in the tree
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+bool
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::exists (const val_t &pVal) const
+{
+    link_t      cur {mRoot};
+    node_ptr_t  ptr;
+    offset_t    off {};
+    int32_t     res;
+
+    // repeat while a valid node is being pointed to (not crossed a leaf)
+    while (cur != NIL) {
+
+        // if a matching node was found, return success
+        ptr = node (cur);
+        res = compare (pVal, value (ptr, off));
+
+        if (res == 0) {
+            return true;
+        }
+
+        // go left if current node is too big, else go right
+        off = offset_below (ptr, off);
+        cur = (res < 0) ? (ptr->lptr) : (ptr->rptr);
+    }
+
+    // if no match was found, return null
+    return false;
+}
+
+/**
+ * @brief                   Finds and returns an iterator to a given value (end() if no match exists in the tree)
+ *
+ * @param pVal              The value to be found
+ *
+ * @return AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator Iterator to matching value in the tree (end() if no match found)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::find (const val_t &pVal) const
+{
+    // get a pointer to the node with the appropriate value and give its ownership to an iterator instance
+    // in case a null link is recieved, the iterator points to end()
+    link_t res      {find_ptr (pVal)};
+    return iterator (res, this);
+}
+
+/**
+ * @brief                   Finds and returns an iterator to the first value strictly greater than the given value (end() if no match exists)
+ *
+ * @param pVal              The value to be compared with
+ *
+ * @return AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator Iterator to first strictly greater value in the tree (end() if no match found)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::first_greater_strict (const val_t &pVal) const
+{
+    // get a pointer to the node with the appropriate value and give its ownership to an iterator instance
+    // in case a null link is recieved, the iterator points to end()
+    link_t res      {first_greater_strict_ptr (pVal)};
+    return iterator (res, this);
+}
+
+/**
+ * @brief                   Finds and returns an iterator to the first value greater than or equal to the given value (end() if no match exists)
+ *
+ * @param pVal               The value to be compared with
+ *
+ * @return AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator Iterator to first greater or equal value in the tree (end() if no match found)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::first_greater_equals (const val_t &pVal) const
+{
+    // get a pointer to the node with the appropriate value and give its ownership to an iterator instance
+    // in case a null link is recieved, the iterator points to end()
+    link_t res      {first_greater_equals_ptr (pVal)};
+    return iterator (res, this);
+}
+
+/**
+ * @brief                   Finds and returns an iterator to the last value strictly less than the given value (end() if no match exists)
+ *
+ * @param pVal               The value to be compared with
+ *
+ * @return AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator Iterator to last strictly less value in the tree (end() if no match found)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::last_smaller_strict (const val_t &pVal) const
+{
+    // get a pointer to the node with the appropriate value and give its ownership to an iterator instance
+    // in case a null link is recieved, the iterator points to end()
+    link_t res      {last_smaller_strict_ptr (pVal)};
+    return iterator (res, this);
+}
+
+/**
+ * @brief                   Finds and returns an iterator to the last value less than or equal to the given value (end() if no match exists)
+ *
+ * @param pVal              The value to be compared with
+ *
+ * @return AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator Iterator to last less or equal value in the tree (end() if no match found)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::last_smaller_equals (const val_t &pVal) const
+{
+    // get a pointer to the node with the appropriate value and give its ownership to an iterator instance
+    // in case a null link is recieved, the iterator points to end()
+    link_t res      {last_smaller_equals_ptr (pVal)};
+    return iterator (res, this);
+}
+
+/**
+ * @brief                   Finds the range of values equal to the given value, as a pair of iterators [first, last)
+ *
+ * @note                    Both ends are found in a single descent, and the range is empty (first == last) if the value is not present
+ *
+ * @param pVal              The value to be compared with
+ *
+ * @return std::pair<iterator, iterator> Iterators to the first value not less than pVal and the first value strictly greater than pVal
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+std::pair<typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator, typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator>
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::equal_range (const val_t &pVal) const
+{
+    auto [lo, hi]   = equal_range_ptr (pVal);
+    return {iterator (lo, this), iterator (hi, this)};
+}
+
+/**
+ * @brief                   Finds the range of values lying between two given values (inclusive of both), as a pair of iterators [first, last)
+ *
+ * @note                    Both ends are found in a single descent until the paths to them diverge, and the range is empty (first == last) if
+ *                          no value lies in between (or if pHi is less than pLo)
+ *
+ * @param pLo               The smallest value to be included in the range
+ * @param pHi               The largest value to be included in the range
+ *
+ * @return std::pair<iterator, iterator> Iterators to the first value not less than pLo and the first value strictly greater than pHi
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+std::pair<typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator, typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator>
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::bounds (const val_t &pLo, const val_t &pHi) const
+{
+    auto [lo, hi]   = bounds_ptr (pLo, pHi);
+    return {iterator (lo, this), iterator (hi, this)};
+}
+
+/**
+ * @brief                   Checks whether each value of a range exists in the tree, searching for many values side by side
+ *
+ * @note                    See find_batch_ptr
+ *
+ * @tparam iter_t           Type of forward iterator to the values
+ * @tparam out_iter_t       Type of output iterator to which the results (convertible from bool) are written
+ *
+ * @param pFirst            Iterator to the first value to be searched for
+ * @param pLast             Iterator past the last value to be searched for
+ * @param pOut              Iterator where the result for the first value is written (followed by the results for the others, in order)
+ *
+ * @return out_iter_t       Iterator past the result for the last value
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+template <typename iter_t, typename out_iter_t>
+out_iter_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::exists_batch (iter_t pFirst, iter_t pLast, out_iter_t pOut) const
+{
+    find_batch_ptr (pFirst, pLast, [&pOut] (link_t pRes) { *pOut = (pRes != NIL); ++pOut; });
+    return pOut;
+}
+
+/**
+ * @brief                   Finds each value of a range in the tree, searching for many values side by side
+ *
+ * @note                    See find_batch_ptr
+ *
+ * @tparam iter_t           Type of forward iterator to the values
+ * @tparam out_iter_t       Type of output iterator to which the results (iterators of the tree, end() where there is no match) are written
+ *
+ * @param pFirst            Iterator to the first value to be searched for
+ * @param pLast             Iterator past the last value to be searched for
+ * @param pOut              Iterator where the result for the first value is written (followed by the results for the others, in order)
+ *
+ * @return out_iter_t       Iterator past the result for the last value
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+template <typename iter_t, typename out_iter_t>
+out_iter_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::find_batch (iter_t pFirst, iter_t pLast, out_iter_t pOut) const
+{
+    find_batch_ptr (pFirst, pLast, [this, &pOut] (link_t pRes) { *pOut = iterator (pRes, this); ++pOut; });
+    return pOut;
+}
+
+/**
+ * @brief                   Finds the element at a given position in the order of the elements (the element with a given number of smaller ones)
+ *
+ * @note                    Each node of a counted tree keeps the size of its subtree, so the position is found in a single descent in O(log n)
+ *                          time, by comparing it with the sizes of the left subtrees on the way (no values are compared). In other trees the
+ *                          left subtrees are counted by walking them, which takes O(n) time
+ *
+ * @param pIdx              Position of the element (0 for the smallest element)
+ *
+ * @return iterator         Iterator to the element (end () if pIdx is not less than the size of the tree)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::select (size_t pIdx) const
+{
+    link_t      cur {mRoot};
+    node_ptr_t  ptr;
+    size_t      lcnt;
+
+    while (cur != NIL) {
+
+        ptr     = node (cur);
+        lcnt    = subtree_size (ptr->lptr);
+
+        if (pIdx == lcnt) {
+            return iterator (cur, this);
+        }
+
+        // the element lies on the left if enough elements are smaller than the current one, otherwise skip them and the current one
+        if (pIdx < lcnt) {
+            cur     = ptr->lptr;
+        }
+        else {
+            pIdx    -= lcnt + 1;
+            cur     = ptr->rptr;
+        }
+    }
+
+    return end ();
+}
+
+/**
+ * @brief                   Returns the number of elements strictly less than a value (which is the position of the value, if it is present)
+ *
+ * @note                    See count_less_strict (a single descent in O(log n) time in counted trees, O(n) in others)
+ *
+ * @param pVal              The value whose position is to be found
+ *
+ * @return size_t           Number of elements strictly less than pVal
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+size_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::rank (const val_t &pVal) const
+{
+    return count_less_strict (pVal, mRoot, {});
+}
+
+/**
+ * @brief                   Returns the number of elements lying between two values (inclusive of both), which are the elements covered by bounds
+ *
+ * @note                    Both descents share the path from the root as long as the current node lies outside the range (as in bounds). At
+ *                          the first node inside it, the elements not less than pLo in its left subtree and those not greater than pHi in its
+ *                          right subtree are counted, in O(log n) time in total (O(n) in trees which are not counted)
+ *
+ * @param pLo               The smallest value to be included in the range
+ * @param pHi               The largest value to be included in the range
+ *
+ * @return size_t           Number of elements in the range (0 if pHi is less than pLo)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+size_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::count_range (const val_t &pLo, const val_t &pHi) const
+{
+    // an inverted interval contains nothing
+    if (less (pHi, pLo)) {
+        return 0;
+    }
+
+    link_t      cur {mRoot};
+    node_ptr_t  ptr;
+    offset_t    off {};
+
+    while (cur != NIL) {
+
+        ptr = node (cur);
+
+        if (less (value (ptr, off), pLo)) {
+            cur = ptr->rptr;
+        }
+        else if (less (pHi, value (ptr, off))) {
+            cur = ptr->lptr;
+        }
+        else {
+            off = offset_below (ptr, off);
+            return 1 + count_greater_equals (pLo, ptr->lptr, off) + count_less_equals (pHi, ptr->rptr, off);
+        }
+
+        off = offset_below (ptr, off);
+    }
+
+    // no node lies in the range
+    return 0;
+}
+
+/**
+ * @brief                   Combines the summaries of all elements lying between two values (inclusive of both), in order
+ *
+ * @note                    For the augmentation policy of the tree, the summaries kept by the nodes are used: the range is found as in
+ *                          count_range, and on each side of the first node inside it, the whole subtrees hanging inside the range are
+ *                          combined at once, in O(log n) time in total. Any other policy is applied to the elements one by one (in O(log n + k)
+ *                          time for k elements in the range)
+ *
+ * @tparam policy_t         Augmentation policy whose summaries are combined (defaults to that of the tree)
+ *
+ * @param pLo               The smallest value to be included in the range
+ * @param pHi               The largest value to be included in the range
+ *
+ * @return policy_t::summary_t Combined summary of the elements in the range (the identity of the policy if there are none)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+template <typename policy_t>
+typename policy_t::summary_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::aggregate (const val_t &pLo, const val_t &pHi) const
+{
+    // an inverted interval contains nothing
+    if (less (pHi, pLo)) {
+        return policy_t::identity ();
+    }
+
+    if constexpr (!std::is_same<policy_t, aug_t>::value) {
+        typename policy_t::summary_t    res {policy_t::identity ()};
+
+        // the elements are read through an iterator, which keeps track of the offsets of shiftable trees
+        for (iterator it (first_greater_equals_ptr (pLo), this); it != end () && !less (pHi, *it); ++it) {
+            res = policy_t::combine (res, policy_t::of (*it));
+        }
+        return res;
+    }
+    else {
+        link_t      cur {mRoot};
+        node_ptr_t  ptr;
+
+        while (cur != NIL) {
+
+            ptr = node (cur);
+
+            if (less (ptr->val, pLo)) {
+                cur = ptr->rptr;
+            }
+            else if (less (pHi, ptr->val)) {
+                cur = ptr->lptr;
+            }
+            else {
+                return policy_t::combine (policy_t::combine (summary_greater_equals<policy_t> (pLo, ptr->lptr), policy_t::of (ptr->val)),
+                                          summary_less_equals<policy_t> (pHi, ptr->rptr));
+            }
+        }
+
+        // no node lies in the range
+        return policy_t::identity ();
+    }
+}
+
+/**
+ * @brief                   Returns the summary of all elements of the tree kept by its root, which for a tree keeping the hash of each subtree
+ *                          (such as AgAVLTreeHashed) is a fingerprint of its set of values
+ *
+ * @note                    Takes O(1) time. Trees holding the same values have the same fingerprint whatever their shapes, so two trees (also
+ *                          in separate processes) can be checked for holding the same values by comparing their fingerprints (see AgAVLHash
+ *                          for the chance of different sets having the same one)
+ *
+ * @return auto             Summary of all elements (the identity of the augmentation policy if the tree is empty)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+auto
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::fingerprint () const
+{
+    static_assert (SUMMARISED, "Only trees which keep a summary of each subtree (such as AgAVLTreeHashed) have a fingerprint");
+
+    return (mRoot == NIL) ? (aug_t::identity ()) : (node (mRoot)->sum);
+}
+
+/**
+ * @brief                   Finds the values present in only one of two trees keeping the hash of each subtree (such as AgAVLTreeHashed)
+ *
+ * @note                    The two trees may have different shapes, so their subtrees are not compared with each other. Instead, each subtree
+ *                          of this tree is compared with the range of values of the other tree lying strictly between the same bounds (those
+ *                          of the ancestors of the subtree), whose hash is combined from whole subtrees of the other tree in O(log n) time.
+ *                          Where the hashes agree, the subtree is skipped, so only the paths leading to differing values are gone down: d
+ *                          differences take O(d log^2 n) time, and equal trees O(log n) time. Values on either side are written in order
+ *
+ * @tparam out_here_t       Type of output iterator to which values present only in this tree are written
+ * @tparam out_there_t      Type of output iterator to which values present only in the other tree are written
+ *
+ * @param pOther            Tree to compare with
+ * @param pOnlyHere         Iterator where the first value present only in this tree is written
+ * @param pOnlyThere        Iterator where the first value present only in the other tree is written
+ *
+ * @return std::pair<out_here_t, out_there_t> Iterators past the last values written to each output
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+template <typename out_here_t, typename out_there_t>
+std::pair<out_here_t, out_there_t>
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::diff (const AgAVLTree & pOther, out_here_t pOnlyHere, out_there_t pOnlyThere) const
+{
+    static_assert (SUMMARISED, "Differences can only be found between trees which keep a hash of each subtree (such as AgAVLTreeHashed)");
+
+    diff_range (mRoot, nullptr, nullptr, pOther, pOnlyHere, pOnlyThere);
+    return {pOnlyHere, pOnlyThere};
+}
+
+/**
+ * @brief                   Finds the first interval (in the order of the tree) which overlaps a given interval
+ *
+ * @note                    The tree must hold intervals ordered by their starts, and keep the largest end of each subtree (see AgAVLMaxEnd).
+ *                          If the left subtree of a node holds an interval ending at or after pLo, the search goes left: either some interval
+ *                          there overlaps, or that interval starts after pHi, and then so do all the following ones. So the search never has
+ *                          to come back up, and takes O(log n) time
+ *
+ * @tparam point_t          Type of the ends of the intervals
+ *
+ * @param pLo               First point of the interval
+ * @param pHi               Last point of the interval
+ *
+ * @return iterator         Iterator to the first overlapping interval (end () if none overlaps, or if pHi is less than pLo)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+template <typename point_t>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::find_overlapping (const point_t &pLo, const point_t &pHi) const
+{
+    static_assert (SUMMARISED, "Overlaps can only be found in trees which keep the largest end in each subtree (such as AgAVLIntervalTree)");
+
+    link_t      cur {mRoot};
+    node_ptr_t  ptr;
+
+    if (pHi < pLo) {
+        return end ();
+    }
+
+    while (cur != NIL) {
+
+        ptr = node (cur);
+
+        if (ptr->lptr != NIL && !(node (ptr->lptr)->sum < pLo)) {
+            cur = ptr->lptr;
+            continue;
+        }
+
+        // the node and all intervals after it start too late
+        if (pHi < aug_t::start (ptr->val)) {
+            break;
+        }
+
+        if (!(aug_t::end (ptr->val) < pLo)) {
+            return iterator (cur, this);
+        }
+        cur = ptr->rptr;
+    }
+
+    return end ();
+}
+
+/**
+ * @brief                   Finds all intervals which overlap a given interval, in the order of the tree
+ *
+ * @note                    The tree is walked in order with a fixed-size stack instead of recursion, skipping every subtree whose largest end
+ *                          is less than pLo, and stopping at the first interval which starts after pHi. A node is only visited if it overlaps,
+ *                          or lies on the path to one which does (or to the interval where the walk stops), so the walk takes O(log n) time for
+ *                          the first interval, and at most O(log n) time for each other one (much less when the overlapping intervals lie
+ *                          close together in the tree, as then their paths are shared)
+ *
+ * @tparam point_t          Type of the ends of the intervals
+ * @tparam out_iter_t       Type of output iterator to which iterators of the tree are written
+ *
+ * @param pLo               First point of the interval
+ * @param pHi               Last point of the interval
+ * @param pOut              Iterator where the first overlapping interval is written (followed by the others, in order)
+ *
+ * @return out_iter_t       Iterator past the last overlapping interval
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+template <typename point_t, typename out_iter_t>
+out_iter_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::overlapping (const point_t &pLo, const point_t &pHi, out_iter_t pOut) const
+{
+    static_assert (SUMMARISED, "Overlaps can only be found in trees which keep the largest end in each subtree (such as AgAVLIntervalTree)");
+
+    link_t      pending[MAX_DEPTH];                 // nodes whose left subtrees are being walked
+    size_t      top     {0};
+
+    link_t      cur     {mRoot};
+    node_ptr_t  ptr;
+
+    if (pHi < pLo) {
+        return pOut;
+    }
+
+    while (true) {
+
+        // go down to the left, as long as the subtree holds some interval ending at or after pLo
+        while (cur != NIL && !(node (cur)->sum < pLo)) {
+            pending[top++]  = cur;
+            cur             = node (cur)->lptr;
+        }
+
+        if (top == 0) {
+            break;
+        }
+
+        cur = pending[--top];
+        ptr = node (cur);
+
+        // the node and all intervals after it start too late
+        if (pHi < aug_t::start (ptr->val)) {
+            break;
+        }
+
+        if (!(aug_t::end (ptr->val) < pLo)) {
+            *pOut = iterator (cur, this);
+            ++pOut;
+        }
+        cur = ptr->rptr;
+    }
+
+    return pOut;
+}
+
+/**
+ * @brief                   Finds all intervals which contain a given point, in the order of the tree
+ *
+ * @note                    See overlapping
+ *
+ * @tparam point_t          Type of the ends of the intervals
+ * @tparam out_iter_t       Type of output iterator to which iterators of the tree are written
+ *
+ * @param pPoint            The point
+ * @param pOut              Iterator where the first interval containing the point is written (followed by the others, in order)
+ *
+ * @return out_iter_t       Iterator past the last interval containing the point
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+template <typename point_t, typename out_iter_t>
+out_iter_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::stabbing (const point_t &pPoint, out_iter_t pOut) const
+{
+    return overlapping (pPoint, pPoint, pOut);
+}
+
+/**
+ * @brief                   Adds a constant to all elements lying between two values (inclusive of both), as long as their order with respect to
+ *                          the other elements is kept
+ *
+ * @note                    In shiftable trees, the node on the path from the root where the paths to both ends of the range split up is found
+ *                          (as in count_range), and on each side the nodes inside the range on the way down get the constant added to their
+ *                          values, and the whole subtrees hanging inside the range get it added to the offsets of their roots. The offsets are
+ *                          pushed down lazily by later modifications and rotations, so the whole range is shifted in O(log n) time. Searches
+ *                          and iterators add the offsets up on the way down instead of pushing them, so const methods never write to the
+ *                          nodes. In other trees the elements are rewritten one by one, in O(log n + k) time for k elements
+ *                          (O(k log n) if the tree keeps summaries). Iterators stay valid, and refer to the shifted elements. For floating
+ *                          point values, adding the constant must not round any two elements of the range to the same value
+ *
+ * @tparam delta_t          Type of the constant (converted to the type of the values first in shiftable trees)
+ *
+ * @param pLo               The smallest value to be shifted
+ * @param pHi               The largest value to be shifted
+ * @param pDelta            Constant added to the values
+ *
+ * @return true             If the elements were shifted (or there are none in the range)
+ * @return false            If a shifted element would not lie between the elements next to the range, the first and last elements of the
+ *                          range would not stay in order, or an integral element would overflow (in which case the tree is not changed)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+template <typename delta_t>
+bool
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::shift_range (const val_t &pLo, const val_t &pHi, const delta_t &pDelta)
+{
+    auto        shifted     {[&pDelta] (const val_t & pVal) -> val_t {
+        if constexpr (mShiftable) {
+            return (val_t)(pVal + (val_t)pDelta);
+        }
+        else {
+            return (val_t)(pVal + pDelta);
+        }
+    }};
+
+    auto        [first, after]  {bounds_ptr (pLo, pHi)};
+
+    if (first == after) {
+        return true;
+    }
+
+    link_t      before  {prev_ptr (first)};
+    link_t      last    {(after != NIL) ? (prev_ptr (after)) : (find_max ())};
+
+    // integral values must not overflow, which is enough to check at both ends of the range
+    if constexpr (std::is_integral<val_t>::value && std::is_integral<delta_t>::value) {
+        auto    fits    {[&pDelta] (const val_t & pVal) -> bool {
+            using limits    = std::numeric_limits<val_t>;
+
+            if constexpr (std::is_signed<delta_t>::value) {
+                if (pDelta < 0) {
+                    return (uintmax_t)pVal - (uintmax_t)limits::min () >= (uintmax_t)0 - (uintmax_t)pDelta;
+                }
+            }
+            return (uintmax_t)limits::max () - (uintmax_t)pVal >= (uintmax_t)pDelta;
+        }};
+
+        if (!fits (value_of (first)) || !fits (value_of (last))) {
+            return false;
+        }
+
+        // offsets are kept in the type of the values, so a signed constant must be one of them
+        if constexpr (mShiftable && std::is_signed<val_t>::value) {
+            if ((delta_t)(val_t)pDelta != pDelta) {
+                return false;
+            }
+        }
+    }
+
+    // the shifted range must stay in order (floating point values may be rounded together), and still fit between its neighbours
+    if (first != last && !less (shifted (value_of (first)), shifted (value_of (last)))) {
+        return false;
+    }
+    if (before != NIL && !less (value_of (before), shifted (value_of (first)))) {
+        return false;
+    }
+    if (after != NIL && !less (shifted (value_of (last)), value_of (after))) {
+        return false;
+    }
+
+    if constexpr (mShiftable) {
+        const val_t delta   {(val_t)pDelta};
+        link_t      cur     {mRoot};
+        node_ptr_t  ptr;
+
+        // the root of a subtree lying inside the range is shifted, and keeps the constant for its children
+        auto        shift_subtree   {[this, &delta] (link_t pRoot) {
+            if (pRoot != NIL) {
+                node (pRoot)->val   += delta;
+                node (pRoot)->shift += delta;
+            }
+        }};
+
+        // go down to the first node inside the range (there is one, as the range is not empty)
+        while (true) {
+            ptr = node (cur);
+            push (cur);
+
+            if (less (ptr->val, pLo)) {
+                cur = ptr->rptr;
+            }
+            else if (less (pHi, ptr->val)) {
+                cur = ptr->lptr;
+            }
+            else {
+                break;
+            }
+        }
+
+        ptr->val    += delta;
+
+        // on the left, every node not less than the lower end lies in the range, along with its whole right subtree
+        for (cur = ptr->lptr; cur != NIL; ) {
+            node_ptr_t  lnode   {node (cur)};
+
+            push (cur);
+            if (!less (lnode->val, pLo)) {
+                lnode->val  += delta;
+                shift_subtree (lnode->rptr);
+                cur         = lnode->lptr;
+            }
+            else {
+                cur         = lnode->rptr;
+            }
+        }
+
+        // on the right, every node not greater than the upper end lies in the range, along with its whole left subtree
+        for (cur = ptr->rptr; cur != NIL; ) {
+            node_ptr_t  rnode   {node (cur)};
+
+            push (cur);
+            if (!less (pHi, rnode->val)) {
+                rnode->val  += delta;
+                shift_subtree (rnode->lptr);
+                cur         = rnode->rptr;
+            }
+            else {
+                cur         = rnode->lptr;
+            }
+        }
+
+        // iterators find the values of their nodes again before they are next used
+        ++mShifts;
+    }
+    else {
+        for (link_t cur = first; cur != after; cur = next_ptr (cur)) {
+            node (cur)->val = shifted (node (cur)->val);
+
+            // the summaries of all ancestors include the value
+            if constexpr (SUMMARISED) {
+                for (link_t up = cur; up != NIL; up = get_parent (node (up))) {
+                    update (up);
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief                   Picks an element of the tree at random, with every element equally likely
+ *
+ * @note                    A random position is drawn and found with select, in O(log n) time in counted trees (O(n) in others)
+ *
+ * @tparam rng_t            Type of the random number generator (such as std::mt19937)
+ *
+ * @param pRng              Random number generator
+ *
+ * @return iterator         Iterator to the element (end () if the tree is empty)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+template <typename rng_t>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::sample (rng_t &pRng) const
+{
+    size_t      sz  {size ()};
+
+    if (sz == 0) {
+        return end ();
+    }
+    return select (std::uniform_int_distribution<size_t> {0, sz - 1} (pRng));
+}
+
+/**
+ * @brief                   Picks a number of elements of the tree at random (with replacement), with every element equally likely each time
+ *
+ * @note                    See sample_sorted (the positions are drawn up front and sorted, and all of them are found in a single walk)
+ *
+ * @tparam rng_t            Type of the random number generator (such as std::mt19937)
+ * @tparam out_iter_t       Type of output iterator to which iterators of the tree are written
+ *
+ * @param pRng              Random number generator
+ * @param pCount            Number of elements to pick
+ * @param pOut              Iterator where the first picked element is written (followed by the others, in the order of the tree)
+ *
+ * @return out_iter_t       Iterator past the last picked element (nothing is written if the tree is empty)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+template <typename rng_t, typename out_iter_t>
+out_iter_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::sample (rng_t &pRng, size_t pCount, out_iter_t pOut) const
+{
+    size_t      sz  {size ()};
+
+    if (sz == 0 || pCount == 0) {
+        return pOut;
+    }
+
+    std::uniform_int_distribution<size_t>   dist    {0, sz - 1};
+    std::vector<size_t>                     keys    (pCount);
+
+    for (auto & e : keys) {
+        e   = dist (pRng);
+    }
+    std::sort (keys.begin (), keys.end ());
+
+    return sample_sorted<false> (keys, pOut);
+}
+
+/**
+ * @brief                   Picks an element of the tree at random, with each element as likely as its weight
+ *
+ * @note                    The augmentation policy of the tree must keep the sum of the (non-negative) weights of the values in each subtree,
+ *                          as AgAVLSum does (with a function giving the weight of a value). A random offset into the total weight is drawn,
+ *                          and found in a single descent in O(log n) time, by comparing it with the weights of the left subtrees on the way
+ *
+ * @tparam rng_t            Type of the random number generator (such as std::mt19937)
+ *
+ * @param pRng              Random number generator
+ *
+ * @return iterator         Iterator to the element (end () if the total weight is not positive)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+template <typename rng_t>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::sample_weighted (rng_t &pRng) const
+{
+    static_assert (SUMMARISED, "Weighted samples can only be drawn from trees which keep the sum of the weights in each subtree (such as AgAVLTreeWeighted)");
+
+    if (mRoot == NIL || !(0 < node (mRoot)->sum)) {
+        return end ();
+    }
+
+    auto        rem {random_weight (pRng)};         // offset of the picked weight from the start of the current subtree
+    link_t      cur {mRoot};
+    node_ptr_t  ptr;
+
+    while (true) {
+
+        ptr = node (cur);
+
+        if (ptr->lptr != NIL) {
+            if (rem < node (ptr->lptr)->sum) {
+                cur = ptr->lptr;
+                continue;
+            }
+            rem -= node (ptr->lptr)->sum;
+        }
+
+        // a floating point offset may be left over past the last weight after rounding, which then falls on the last element
+        if (rem < aug_t::of (ptr->val) || ptr->rptr == NIL) {
+            return iterator (cur, this);
+        }
+        rem -= aug_t::of (ptr->val);
+        cur = ptr->rptr;
+    }
+}
+
+/**
+ * @brief                   Picks a number of elements of the tree at random (with replacement), with each element as likely as its weight each time
+ *
+ * @note                    See sample_weighted and sample_sorted
+ *
+ * @tparam rng_t            Type of the random number generator (such as std::mt19937)
+ * @tparam out_iter_t       Type of output iterator to which iterators of the tree are written
+ *
+ * @param pRng              Random number generator
+ * @param pCount            Number of elements to pick
+ * @param pOut              Iterator where the first picked element is written (followed by the others, in the order of the tree)
+ *
+ * @return out_iter_t       Iterator past the last picked element (nothing is written if the total weight is not positive)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+template <typename rng_t, typename out_iter_t>
+out_iter_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::sample_weighted (rng_t &pRng, size_t pCount, out_iter_t pOut) const
+{
+    static_assert (SUMMARISED, "Weighted samples can only be drawn from trees which keep the sum of the weights in each subtree (such as AgAVLTreeWeighted)");
+
+    if (mRoot == NIL || !(0 < node (mRoot)->sum) || pCount == 0) {
+        return pOut;
+    }
+
+    std::vector<typename aug_t::summary_t>  keys    (pCount);
+
+    for (auto & e : keys) {
+        e   = random_weight (pRng);
+    }
+    std::sort (keys.begin (), keys.end ());
+
+    return sample_sorted<true> (keys, pOut);
+}
+
+/**
+ * @brief                   Returns a copy of the allocator used by the tree
+ *
+ * @return alloc_t          Allocator used to get memory for the nodes of the tree
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+alloc_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::get_allocator () const
+{
+    return mAlloc;
+}
+
+/**
+ * @brief                   Returns the size of the tree (number of elements)
+ *
+ * @return size_t           Size of tree
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+size_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::size () const
+{
+    return mSz;
+}
+
+/**
+ * @brief                   Returns an iterator to the beginning
+ *
+ * @return AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator Iterator to the first element
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::begin () const
+{
+    // get the pointer to the smallest (first) element of the tree and give its ownership to an iterator instance
+    return iterator (find_min (mRoot), this);
+}
+
+/**
+ * @brief                   Returns an iterator to the element one after the last element
+ *
+ * @return AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator Iterator to the element following the last element
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::end () const
+{
+    // return an iterator instance pointing to null
+    return iterator (NIL, this);
+}
+
+/**
+ * @brief                   Returns a reverse iterator to the beginning
+ *
+ * @return AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::reverse_iterator Reverse Iterator to the beginning
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::reverse_iterator
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::rbegin () const
+{
+    // get the pointer to the greatest (last) element of the tree and give its ownership to an iterator instance
+    return reverse_iterator (find_max (mRoot), this);
+}
+
+/**
+ * @brief                   Returns a reverse iterator to the element one after the last element
+ *
+ * @return AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::reverse_iterato Iterator to the element following the last element
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::reverse_iterator
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::rend () const
+{
+    // return an iterator instance and which points to null
+    return reverse_iterator (NIL, this);
+}
+
+// PRIVATE
+
+/**
+ * @brief                   Returns the maximum of two elements (first if both compare equal)
+ * @tparam arg_t            Type of values to be compared
+ *
+ * @param pA                First element to be compared
+ * @param pB                Second element to be compared
+ *
+ * @return arg_t            The maximum of the two supplied arguments
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+template <class arg_t>
+arg_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::max (const arg_t & pA, const arg_t & pB)
+{
+    return (pA > pB) ? (pA) : (pB);
+}
+
+/**
+ * @brief                   Returns the minimum of two elements (first if both compare mEquals)
+ * @tparam arg_t            Type of values to be compared
+ *
+ * @param pA                First element to be compared
+ * @param pB                Second element to be compared
+ *
+ * @return arg_t            The maximum of the two supplied arguments
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+template <class arg_t>
+arg_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::min (const arg_t & pA, const arg_t & pB)
+{
+    return (pA < pB) ? (pA) : (pB);
+}
+
+/**
+ * @brief                   Checks whether a value is strictly less than another (with a single call to the comparator)
+ *
+ * @param pA                First element (element to be compared to)
+ * @param pB                Second element (element to be compared)
+ *
+ * @return true             If pA is strictly less than pB
+ * @return false            If pA is not strictly less than pB
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+bool
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::less (const val_t & pA, const val_t & pB)
+{
+    if constexpr (THREE_WAY) {
+        return mComp (pA, pB) < 0;
+    }
+    else {
+        return mComp (pA, pB);
+    }
+}
+
+/**
+ * @brief                   Compares two values (with a single call to a three-way comparator, or up to two calls otherwise)
+ *
+ * @param pA                First element (element to be compared to)
+ * @param pB                Second element (element to be compared)
+ *
+ * @return int32_t          Negative if pA is less than pB, zero if both are equal and positive if pA is greater than pB
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+int32_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::compare (const val_t & pA, const val_t & pB)
+{
+    if constexpr (THREE_WAY) {
+        auto    res {mComp (pA, pB)};
+        return (res < 0) ? (-1) : ((res > 0) ? (1) : (0));
+    }
+    else {
+        return (mEquals (pA, pB)) ? (0) : ((mComp (pA, pB)) ? (-1) : (1));
+    }
+}
+
+/**
+ * @brief                   Returns the node a link refers to
+ *
+ * @note                    In the default mode links are pointers to nodes, in compact mode they are positions in the arena of the pool
+ *
+ * @param pLink             Link to the node (must not be null)
+ *
+ * @return node_ptr_t       Pointer to the node
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::node_ptr_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::node (link_t pLink) const
+{
+    return mPool->get (pLink);
+}
+
+/**
+ * @brief                   Makes sure that a number of nodes can be allocated without moving any of the existing nodes (creating the pool if
+ *                          the tree does not have one yet)
+ *
+ * @param pCount            Number of nodes which are going to be allocated
+ *
+ * @return true             If the nodes can be allocated without moving any node
+ * @return false            If memory for the pool or the nodes could not be allocated
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+bool
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::reserve_nodes (size_t pCount)
+{
+    if (mPool == nullptr) {
+
+        pool_alloc_t    poolAlloc   (mAlloc);
+
+        // failure to allocate is reported by returning false (irrespective of whether the allocator throws)
+        try {
+            mPool = std::allocator_traits<pool_alloc_t>::allocate (poolAlloc, 1);
+        }
+        catch (...) {
+            return false;
+        }
+        new (mPool) node_pool_t (mAlloc);
+    }
+
+    return mPool->reserve (pCount);
+}
+
+/**
+ * @brief                   Stops using the pool of the tree, destroying it
+ *
+ * @note                    All nodes of the tree must have been destroyed (or handed over to another tree) before calling this, unless their
+ *                          values need no destructor and the pool is releasable
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+void
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::drop_pool ()
+{
+    if (mPool != nullptr) {
+
+        pool_alloc_t    poolAlloc   (mPool->get_allocator ());
+
+        mPool->~node_pool_t ();
+        std::allocator_traits<pool_alloc_t>::deallocate (poolAlloc, mPool, 1);
+    }
+    mPool = nullptr;
+}
+
+/**
+ * @brief                   Returns the parent of a node (without the balance factor it is tagged with)
+ *
+ * @param pCur              Node whose parent is to be found
+ *
+ * @return link_t           Link to the parent of the node (null if the node is the root)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::get_parent (node_ptr_t pCur)
+{
+    if constexpr (mCompact) {
+        return pCur->pptr & ~TAG_MASK;
+    }
+    else {
+        return reinterpret_cast<link_t> (reinterpret_cast<uintptr_t> (pCur->pptr) & ~TAG_MASK);
+    }
+}
+
+/**
+ * @brief                   Returns the balance factor of a node (height of right subtree - height of left subtree)
+ *
+ * @param pCur              Node whose balance factor is to be found
+ *
+ * @return int8_t           Balance factor of the node (-1, 0 or 1)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+int8_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::get_balance (node_ptr_t pCur)
+{
+    tag_t   tag;
+
+    if constexpr (mCompact) {
+        tag = pCur->pptr >> TAG_SHIFT;
+    }
+    else {
+        tag = reinterpret_cast<uintptr_t> (pCur->pptr) & TAG_MASK;
+    }
+
+    // the balance factor is stored as its lowest 2 bits (so -1 is stored as 3), sign extend it back
+    return (int8_t)((int32_t)(tag ^ 2) - 2);
+}
+
+/**
+ * @brief                   Changes the balance factor of a node (without changing its parent)
+ *
+ * @param pCur              Node whose balance factor has changed
+ * @param pBal              New balance factor of the node (-1, 0 or 1)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+void
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::set_balance (node_ptr_t pCur, int8_t pBal)
+{
+    tag_t   tag {((tag_t)pBal & 3) << TAG_SHIFT};
+
+    if constexpr (mCompact) {
+        pCur->pptr = (pCur->pptr & ~TAG_MASK) | tag;
+    }
+    else {
+        pCur->pptr = reinterpret_cast<link_t> ((reinterpret_cast<uintptr_t> (pCur->pptr) & ~TAG_MASK) | tag);
+    }
+}
+
+/**
+ * @brief                   Makes a node point to its new parent (does nothing if the node does not exist)
+ *
+ * @note                    The balance factor of the node is not changed
+ *
+ * @param pCur              Node whose parent has changed (might be null)
+ * @param pPar              New parent of the node
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+void
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::set_parent (link_t pCur, link_t pPar) const
+{
+    if (pCur != NIL) {
+        node_ptr_t  cur {node (pCur)};
+        int8_t      bal {get_balance (cur)};
+
+        cur->pptr   = pPar;
+        set_balance (cur, bal);
+    }
+}
+
+/**
+ * @brief                   Recomputes the fields a node keeps about its subtree from those of its children (does nothing if it keeps none)
+ *
+ * @note                    Must be called whenever the subtree of a node changes, after its children have been updated (so after a change,
+ *                          the nodes from there up to the root are updated bottom-up)
+ *
+ * @param pCur              Link to the node (must not be null)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+void
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::update (link_t pCur) const
+{
+    node_ptr_t  cur {node (pCur)};
+
+    if constexpr (mCounted) {
+        cur->cnt    = (count_t)(1 + subtree_size (cur->lptr) + subtree_size (cur->rptr));
+    }
+
+    // the summary of the left subtree comes before that of the value, and that of the right subtree after it
+    if constexpr (SUMMARISED) {
+        typename aug_t::summary_t   sum {aug_t::of (cur->val)};
+
+        if (cur->lptr != NIL) {
+            sum = aug_t::combine (node (cur->lptr)->sum, sum);
+        }
+        if (cur->rptr != NIL) {
+            sum = aug_t::combine (sum, node (cur->rptr)->sum);
+        }
+        cur->sum    = sum;
+    }
+}
+
+/**
+ * @brief                   Adds the offset a node keeps for its children to their values (and to the offsets they keep), and clears it
+ *
+ * @note                    The value of a node is only up to date once the offsets of all its ancestors have been pushed down, so this is
+ *                          done by the modifiers to each node before going down to its children, and before its children are changed. Readers
+ *                          never push offsets down, and add them up on the way down instead (see value). Does nothing unless the tree is
+ *                          shiftable
+ *
+ * @param pCur              Link to the node (whose own value must be up to date)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+void
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::push (link_t pCur)
+{
+    if constexpr (mShiftable) {
+        node_ptr_t  cur     {node (pCur)};
+
+        if (cur->shift == 0) {
+            return;
+        }
+
+        if (cur->lptr != NIL) {
+            node (cur->lptr)->val       += cur->shift;
+            node (cur->lptr)->shift     += cur->shift;
+        }
+        if (cur->rptr != NIL) {
+            node (cur->rptr)->val       += cur->shift;
+            node (cur->rptr)->shift     += cur->shift;
+        }
+        cur->shift  = 0;
+    }
+}
+
+/**
+ * @brief                   Pushes down the offsets kept by all ancestors of a node, so that the values on the path from the root to it are up to date
+ *
+ * @note                    Used before linking a new node below a node which was not reached from the root by the modifier (such as the hint
+ *                          of an insertion). The path is found by following parent links upwards, and pushed down from the root. Does nothing
+ *                          unless the tree is shiftable
+ *
+ * @param pCur              Link to the node
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+void
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::settle (link_t pCur)
+{
+    if constexpr (mShiftable) {
+        link_t  path[MAX_DEPTH];                    // ancestors of the node, from its parent up to the root
+        size_t  depth   {0};
+
+        for (link_t par = get_parent (node (pCur)); par != NIL; par = get_parent (node (par))) {
+            path[depth++]   = par;
+        }
+        while (depth != 0) {
+            push (path[--depth]);
+        }
+    }
+}
+
+/**
+ * @brief                   Returns the value of a node, given the sum of the offsets kept by its ancestors
+ *
+ * @note                    Readers of a shiftable tree add up the offsets on the way down from the root (see offset_below), and never write
+ *                          them into the nodes, so any number of them can run at the same time. Other trees just return the value
+ *
+ * @param pCur              Pointer to the node
+ * @param pOffset           Sum of the offsets kept by the ancestors of the node
+ *
+ * @return val_ref_t        Value of the node (a copy in shiftable trees, and a reference to it in others)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::val_ref_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::value (node_ptr_t pCur, const offset_t & pOffset)
+{
+    if constexpr (mShiftable) {
+        return (val_t)(pCur->val + pOffset);
+    }
+    else {
+        (void)pOffset;
+        return pCur->val;
+    }
+}
+
+/**
+ * @brief                   Returns the sum of the offsets kept by the ancestors of a child of a node
+ *
+ * @param pCur              Pointer to the node
+ * @param pOffset           Sum of the offsets kept by the ancestors of the node
+ *
+ * @return offset_t         Sum of the offsets kept by the node and its ancestors (empty unless the tree is shiftable)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::offset_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::offset_below (node_ptr_t pCur, const offset_t & pOffset)
+{
+    if constexpr (mShiftable) {
+        return (val_t)(pOffset + pCur->shift);
+    }
+    else {
+        (void)pCur;
+        return pOffset;
+    }
+}
+
+/**
+ * @brief                   Returns the sum of the offsets kept by the ancestors of a node
+ *
+ * @note                    The ancestors are found by following parent links upwards, and their offsets are added up from the root down (in
+ *                          the same order as by a search), in O(log n) time
+ *
+ * @param pCur              Link to the node
+ *
+ * @return offset_t         Sum of the offsets kept by the ancestors of the node (empty unless the tree is shiftable)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::offset_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::offset (link_t pCur) const
+{
+    offset_t    res     {};
+
+    if constexpr (mShiftable) {
+        link_t  path[MAX_DEPTH];                    // ancestors of the node, from its parent up to the root
+        size_t  depth   {0};
+
+        for (link_t par = get_parent (node (pCur)); par != NIL; par = get_parent (node (par))) {
+            path[depth++]   = par;
+        }
+        while (depth != 0) {
+            res = offset_below (node (path[--depth]), res);
+        }
+    }
+    else {
+        (void)pCur;
+    }
+
+    return res;
+}
+
+/**
+ * @brief                   Returns the value of a node which was not reached from the root (see offset)
+ *
+ * @param pCur              Link to the node
+ *
+ * @return val_ref_t        Value of the node (a copy in shiftable trees, and a reference to it in others)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::val_ref_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::value_of (link_t pCur) const
+{
+    return value (node (pCur), offset (pCur));
+}
+
+/**
+ * @brief                   Returns the value of the node of an iterator
+ *
+ * @note                    An iterator of a shiftable tree keeps the value of its node, which is only found again (in O(log n) time, see offset)
+ *                          after the tree has been shifted
+ *
+ * @param pCur              Link to the node of the iterator
+ * @param pIter             Fields kept by the iterator (updated if the value is found again)
+ *
+ * @return val_ref_t        Value of the node (a copy in shiftable trees, and a reference to it in others)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::val_ref_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iter_value (link_t pCur, const iter_extra_t & pIter) const
+{
+    if constexpr (mShiftable) {
+        if (pIter.mShifts != mShifts) {
+            pIter.mVal      = value_of (pCur);
+            pIter.mShifts   = mShifts;
+        }
+        return pIter.mVal;
+    }
+    else {
+        (void)pIter;
+        return node (pCur)->val;
+    }
+}
+
+/**
+ * @brief                   Finds the inorder successor of the node of an iterator, along with its value
+ *
+ * @note                    For integral values, the sum of the offsets of the ancestors of the node is what the value of the node lacks, and
+ *                          is carried over to the successor (see next_ptr), in amortized constant time. Other values of shiftable trees are
+ *                          found again when they are next needed (in O(log n) time, see offset)
+ *
+ * @param pCur              Link to the node of the iterator
+ * @param pIter             Fields kept by the iterator (updated for the successor)
+ *
+ * @return link_t           Link to the inorder successor (null if the node holds the greatest value)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iter_next (link_t pCur, const iter_extra_t & pIter) const
+{
+    if constexpr (mShiftable && std::is_integral<val_t>::value) {
+        offset_t    off     {(val_t)(iter_value (pCur, pIter) - node (pCur)->val)};
+
+        pCur    = next_ptr (pCur, off);
+        if (pCur != NIL) {
+            pIter.mVal      = value (node (pCur), off);
+        }
+        return pCur;
+    }
+    else {
+        if constexpr (mShiftable) {
+            pIter.mShifts   = SIZE_MAX;
+        }
+        return next_ptr (pCur);
+    }
+}
+
+/**
+ * @brief                   Finds the inorder predecessor of the node of an iterator, along with its value (see iter_next)
+ *
+ * @param pCur              Link to the node of the iterator
+ * @param pIter             Fields kept by the iterator (updated for the predecessor)
+ *
+ * @return link_t           Link to the inorder predecessor (null if the node holds the smallest value)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iter_prev (link_t pCur, const iter_extra_t & pIter) const
+{
+    if constexpr (mShiftable && std::is_integral<val_t>::value) {
+        offset_t    off     {(val_t)(iter_value (pCur, pIter) - node (pCur)->val)};
+
+        pCur    = prev_ptr (pCur, off);
+        if (pCur != NIL) {
+            pIter.mVal      = value (node (pCur), off);
+        }
+        return pCur;
+    }
+    else {
+        if constexpr (mShiftable) {
+            pIter.mShifts   = SIZE_MAX;
+        }
+        return prev_ptr (pCur);
+    }
+}
+
+/**
+ * @brief                   Function to balance a node which is left-left heavy
+ *
+ * @note                    The left child of the pivot must be left heavy (after an insertion or erasure) or balanced (after an erasure),
+ *                          in the latter case the height of the subtree does not change
+ *
+ * @param pRoot             Pointer to the edge between the pivot and it's parent
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+void
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::balance_ll (link_ptr_t pRoot)
+{
+    int8_t     bal;                                 // balance factor of bot before rotating
+
+    link_t     top;                                 // links to the pivot (top) node and
+    link_t     bot;                                 // the heavier child (left) of the pivot
+
+    node_ptr_t topNode;                             // the nodes the above links refer to
+    node_ptr_t botNode;
+
+    top             = *pRoot;
+    topNode         = node (top);
+    bot             = topNode->lptr;
+    botNode         = node (bot);
+    bal             = get_balance (botNode);
+
+    // offsets must not move along with the subtrees which change parents
+    push (top);
+    push (bot);
+
+    topNode->lptr   = botNode->rptr;                // right child of bot becomes left child of top
+    botNode->rptr   = top;                          // top becomes the right child of bot
+    *pRoot          = bot;                          // pointer to top now points to bot
+
+    // fix the parents of shifted nodes (bot takes the place of top under top's old parent)
+    set_parent (topNode->lptr, top);
+    botNode->pptr   = topNode->pptr;
+    topNode->pptr   = bot;
+
+    // recalculate balance factors of shifted nodes (if bot was balanced, the pivot stays heavy on the same side)
+    if (bal == 0) {
+        set_balance (topNode, -1);
+        set_balance (botNode, 1);
+    }
+    else {
+        set_balance (topNode, 0);
+        set_balance (botNode, 0);
+    }
+
+    // top is now below bot, so its fields are updated first
+    update (top);
+    update (bot);
+
+    DBG_MODE (dbg_info.ll_count += 1;)
+}
+
+/**
+ * @brief                   Function to balance a node which is left-right heavy
+ *
+ * @param pRoot             Pointer to the edge between the pivot and it's parent
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+void
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::balance_lr (link_ptr_t pRoot)
+{
+    int8_t     bal;                                 // balance factor of bot before rotating
+
+    link_t     top;                                 // links to the pivot (top) node,
+    link_t     mid;                                 // the heavier child (left) of the pivot,
+    link_t     bot;                                 // heavier child (right) of the middle
+
+    node_ptr_t topNode;                             // the nodes the above links refer to
+    node_ptr_t midNode;
+    node_ptr_t botNode;
+
+    top             = *pRoot;
+    topNode         = node (top);
+    mid             = topNode->lptr;
+    midNode         = node (mid);
+    bot             = midNode->rptr;
+    botNode         = node (bot);
+    bal             = get_balance (botNode);
+
+    // offsets must not move along with the subtrees which change parents
+    push (top);
+    push (mid);
+    push (bot);
+
+    midNode->rptr   = botNode->lptr;                // left child of bot becomes right child of mid
+    botNode->lptr   = mid;                          // mid becomes left child of bot
+    topNode->lptr   = botNode->rptr;                // right child of bot becomes left child of top
+    botNode->rptr   = top;                          // top becomes right child of bot
+    *pRoot          = bot;                          // pointer to top now points to bot
+
+    // fix the parents of shifted nodes (bot takes the place of top under top's old parent)
+    set_parent (midNode->rptr, mid);
+    set_parent (topNode->lptr, top);
+    botNode->pptr   = topNode->pptr;
+    midNode->pptr   = bot;
+    topNode->pptr   = bot;
+
+    // recalculate balance factors of shifted nodes (mid and top each get one of the subtrees of bot)
+    set_balance (midNode, (bal > 0) ? (-1) : (0));
+    set_balance (topNode, (bal < 0) ? (1) : (0));
+    set_balance (botNode, 0);
+
+    // mid and top are now below bot, so their fields are updated first
+    update (mid);
+    update (top);
+    update (bot);
+
+    DBG_MODE (dbg_info.lr_count += 1;)
+}
+
+/**
+ * @brief                   Function to balance a node which is right-left heavy
+ *
+ * @param pRoot             Pointer to the edge between the pivot and it's parent
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+void
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::balance_rl (link_ptr_t pRoot)
+{
+    int8_t     bal;                                 // balance factor of bot before rotating
+
+    link_t     top;                                 // links to the pivot (top) node,
+    link_t     mid;                                 // the heavier child (right) of the pivot,
+    link_t     bot;                                 // heavier child (left) of the middle
+
+    node_ptr_t topNode;                             // the nodes the above links refer to
+    node_ptr_t midNode;
+    node_ptr_t botNode;
+
+    top             = *pRoot;
+    topNode         = node (top);
+    mid             = topNode->rptr;
+    midNode         = node (mid);
+    bot             = midNode->lptr;
+    botNode         = node (bot);
+    bal             = get_balance (botNode);
+
+    // offsets must not move along with the subtrees which change parents
+    push (top);
+    push (mid);
+    push (bot);
+
+    topNode->rptr   = botNode->lptr;                // left child of bot becomes right child of top
+    botNode->lptr   = top;                          // top becomes left child of bot
+    midNode->lptr   = botNode->rptr;                // right child of bot becomes left child of mid
+    botNode->rptr   = mid;                          // mid becomes right child of bot
+    *pRoot          = bot;                          // pointer to top now points to bot
+
+    // fix the parents of shifted nodes (bot takes the place of top under top's old parent)
+    set_parent (topNode->rptr, top);
+    set_parent (midNode->lptr, mid);
+    botNode->pptr   = topNode->pptr;
+    topNode->pptr   = bot;
+    midNode->pptr   = bot;
+
+    // recalculate balance factors of shifted nodes (top and mid each get one of the subtrees of bot)
+    set_balance (topNode, (bal > 0) ? (-1) : (0));
+    set_balance (midNode, (bal < 0) ? (1) : (0));
+    set_balance (botNode, 0);
+
+    // top and mid are now below bot, so their fields are updated first
+    update (top);
+    update (mid);
+    update (bot);
+
+    DBG_MODE (dbg_info.rl_count += 1;)
+}
+
+/**
+ * @brief                   Function to balance a node which is right-right heavy
+ *
+ * @note                    The right child of the pivot must be right heavy (after an insertion or erasure) or balanced (after an erasure),
+ *                          in the latter case the height of the subtree does not change
+ *
+ * @param pRoot             Pointer to the edge between the pivot and it's parent
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+void
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::balance_rr (link_ptr_t pRoot)
+{
+    int8_t     bal;                                 // balance factor of bot before rotating
+
+    link_t     top;                                 // links to the pivot (top) node and
+    link_t     bot;                                 // the heavier child (right) of the pivot
+
+    node_ptr_t topNode;                             // the nodes the above links refer to
+    node_ptr_t botNode;
+
+    top             = *pRoot;
+    topNode         = node (top);
+    bot             = topNode->rptr;
+    botNode         = node (bot);
+    bal             = get_balance (botNode);
+
+    // offsets must not move along with the subtrees which change parents
+    push (top);
+    push (bot);
+
+    topNode->rptr   = botNode->lptr;                // left child of bot becomes right child of top
+    botNode->lptr   = top;                          // top becomes the left child of bot
+    *pRoot          = bot;                          // pointer to top now points to bot
+
+    // fix the parents of shifted nodes (bot takes the place of top under top's old parent)
+    set_parent (topNode->rptr, top);
+    botNode->pptr   = topNode->pptr;
+    topNode->pptr   = bot;
+
+    // recalculate balance factors of shifted nodes (if bot was balanced, the pivot stays heavy on the same side)
+    if (bal == 0) {
+        set_balance (topNode, 1);
+        set_balance (botNode, -1);
+    }
+    else {
+        set_balance (topNode, 0);
+        set_balance (botNode, 0);
+    }
+
+    // top is now below bot, so its fields are updated first
+    update (top);
+    update (bot);
+
+    DBG_MODE (dbg_info.rr_count += 1;)
+}
+
+/**
+ * @brief                   Updates the balance factor of a node after one of its subtrees has grown taller, rotating if required
+ *
+ * @note                    The fields the node keeps about its subtree are updated as well (see update)
+ *
+ * @param pCur              Pointer to the node's link
+ * @param pLeft             Whether the left subtree (instead of the right one) has grown
+ *
+ * @return true             If the subtree of the node has grown taller as well
+ * @return false            If the height of the subtree of the node has not changed
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+bool
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::rebalance_grown (link_ptr_t pCur, bool pLeft)
+{
+    // the subtree below the node has changed (a rotation updates the nodes it moves again)
+    update (*pCur);
+
+    node_ptr_t  cur {node (*pCur)};
+    int8_t      bal {(int8_t)(get_balance (cur) + ((pLeft) ? (-1) : (1)))};
+
+    // if the shorter side has grown, the node is now balanced (and its height is the same)
+    // if the node was balanced, it is now heavy on the side which has grown (and its height has grown)
+    if (bal >= -1 && bal <= 1) {
+        set_balance (cur, bal);
+        return bal != 0;
+    }
+
+    int8_t      childBal;
+
+    // left side too heavy, balance towards the heavier grandchild (or rotate once if the child is balanced)
+    // after an insertion the child is never balanced, but it can be after joining a tree below the node
+    if (bal < -1) {
+        childBal = get_balance (node (cur->lptr));
+        (childBal <= 0) ? (balance_ll (pCur)) : (balance_lr (pCur));
+    }
+
+    // right side too heavy
+    else {
+        childBal = get_balance (node (cur->rptr));
+        (childBal >= 0) ? (balance_rr (pCur)) : (balance_rl (pCur));
+    }
+
+    // after rotating, the height of the subtree is the same as before it grew (unless the child was balanced)
+    return childBal == 0;
+}
+
+/**
+ * @brief                   Updates the balance factor of a node after one of its subtrees has become shorter, rotating if required
+ *
+ * @note                    The fields the node keeps about its subtree are updated as well (see update)
+ *
+ * @param pCur              Pointer to the node's link
+ * @param pLeft             Whether the left subtree (instead of the right one) has become shorter
+ *
+ * @return true             If the subtree of the node has become shorter as well
+ * @return false            If the height of the subtree of the node has not changed
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+bool
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::rebalance_shrunk (link_ptr_t pCur, bool pLeft)
+{
+    // the subtree below the node has changed (a rotation updates the nodes it moves again)
+    update (*pCur);
+
+    node_ptr_t  cur {node (*pCur)};
+    int8_t      bal {(int8_t)(get_balance (cur) + ((pLeft) ? (1) : (-1)))};
+    int8_t      childBal;
+
+    // if the taller side has become shorter, the node is now balanced (and its height has reduced)
+    // if the node was balanced, it is now heavy on the other side (and its height is the same)
+    if (bal >= -1 && bal <= 1) {
+        set_balance (cur, bal);
+        return bal == 0;
+    }
+
+    // left side too heavy, balance towards the heavier grandchild (or rotate once if the child is balanced)
+    if (bal < -1) {
+        childBal = get_balance (node (cur->lptr));
+        (childBal <= 0) ? (balance_ll (pCur)) : (balance_lr (pCur));
+    }
+
+    // right side too heavy
+    else {
+        childBal = get_balance (node (cur->rptr));
+        (childBal >= 0) ? (balance_rr (pCur)) : (balance_rl (pCur));
+    }
+
+    // the height only stays the same if a single rotation was made around a balanced child
+    return childBal != 0;
+}
+
+/**
+ * @brief                   Finds the minimum value node in a subtree without modifying it, along with the offsets kept by its ancestors
+ *
+ * @param pRoot             Root of the subtree to be processed
+ * @param pOffset           Sum of the offsets kept by the ancestors of the root (updated to that of the minimum value node)
+ *
+ * @return link_t           Link to minimum value node in the subtree of pRoot
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::find_min (link_t pRoot, offset_t & pOffset) const
+{
+    link_t res {pRoot};
+
+    // if the root does not exist (no nodes in tree), return null
+    if (res == NIL) {
+        return NIL;
+    }
+
+    // keep going left for as long as possible and return the leftmost (smallest) node
+    while (node (res)->lptr != NIL) {
+        pOffset = offset_below (node (res), pOffset);
+        res     = node (res)->lptr;
+    }
+
+    return res;
+}
+
+/**
+ * @brief                   Finds the minimum value node in a subtree without modifying it
+ *
+ * @param pRoot             Root of the subtree to be processed
+ *
+ * @return link_t           Link to minimum value node in the subtree of pRoot
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::find_min (link_t pRoot) const
+{
+    offset_t    off {};
+
+    return find_min (pRoot, off);
+}
+
+/**
+ * @brief                   Finds the minimum value node in the entire tree without modifying it
+ *
+ * @return link_t           Link to the minimum value node in the entire tree
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::find_min () const
+{
+    // return a link to the minimum value node in the root's subtree (entire tree)
+    return find_min (mRoot);
+}
+
+/**
+ * @brief                   Finds the maximum value node in a subtree without modifying it, along with the offsets kept by its ancestors
+ *
+ * @param pRoot             Root of the subtree to be processed
+ * @param pOffset           Sum of the offsets kept by the ancestors of the root (updated to that of the maximum value node)
+ *
+ * @return link_t           Link to maximum value node in the subtree of pRoot
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::find_max (link_t pRoot, offset_t & pOffset) const
+{
+    link_t res {pRoot};
+
+    // if the root does not exist (no nodesi n tree), return null
+    if (res == NIL) {
+        return NIL;
+    }
+
+    // keep going right for as long as possible and return the rightmost (greatest) node
+    while (node (res)->rptr != NIL) {
+        pOffset = offset_below (node (res), pOffset);
+        res     = node (res)->rptr;
+    }
+
+    return res;
+}
+
+/**
+ * @brief                   Finds the maximum value node in a subtree without modifying it
+ *
+ * @param pRoot             Root of the subtree to be processed
+ *
+ * @return link_t           Link to maximum value node in the subtree of pRoot
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::find_max (link_t pRoot) const
+{
+    offset_t    off {};
+
+    return find_max (pRoot, off);
+}
+
+/**
+ * @brief                   Finds the maximum value node in the entire tree without modifying it
+ *
+ * @return link_t           Link to the maximum value node in the entire tree
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::find_max () const
+{
+    // return a link to the maximum value node in the root's subtree (entire tree)
+    return find_max (mRoot);
+}
+
+/**
+ * @brief                   Finds the inorder successor of a node by following child and parent links (no comparisons are made), along with
+ *                          the offsets kept by its ancestors
+ *
+ * @note                    Stepping through all the nodes of the tree this way takes amortized constant time per step. Going down adds the
+ *                          offsets of the nodes passed, and going up takes them away again (for values which are not integral, where taking
+ *                          away could round, the offsets of the successor are added up again from the root instead, see offset)
+ *
+ * @param pCur              Node whose successor is to be found
+ * @param pOffset           Sum of the offsets kept by the ancestors of the node (updated to that of the successor)
+ *
+ * @return link_t           Link to the inorder successor (null if the node holds the greatest value)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::next_ptr (link_t pCur, offset_t & pOffset) const
+{
+    link_t par;
+
+    // if a right subtree exists, the successor is its leftmost node
+    if (node (pCur)->rptr != NIL) {
+        pOffset = offset_below (node (pCur), pOffset);
+        return find_min (node (pCur)->rptr, pOffset);
+    }
+
+    // otherwise, climb up until the current node is reached from the left (that ancestor is the successor)
+    par = get_parent (node (pCur));
+    while (par != NIL && pCur == node (par)->rptr) {
+        pCur    = par;
+        par     = get_parent (node (par));
+
+        if constexpr (mShiftable && std::is_integral<val_t>::value) {
+            pOffset = (val_t)(pOffset - node (pCur)->shift);
+        }
+    }
+
+    if constexpr (mShiftable) {
+        if (par != NIL) {
+            if constexpr (std::is_integral<val_t>::value) {
+                pOffset = (val_t)(pOffset - node (par)->shift);
+            }
+            else {
+                pOffset = offset (par);
+            }
+        }
+    }
+    return par;
+}
+
+/**
+ * @brief                   Finds the inorder successor of a node by following child and parent links (no comparisons are made)
+ *
+ * @note                    Stepping through all the nodes of the tree this way takes amortized constant time per step
+ *
+ * @param pCur              Node whose successor is to be found
+ *
+ * @return link_t           Link to the inorder successor (null if the node holds the greatest value)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::next_ptr (link_t pCur) const
+{
+    link_t par;
+
+    // if a right subtree exists, the successor is its leftmost node
+    if (node (pCur)->rptr != NIL) {
+        return find_min (node (pCur)->rptr);
+    }
+
+    // otherwise, climb up until the current node is reached from the left (that ancestor is the successor)
+    par = get_parent (node (pCur));
+    while (par != NIL && pCur == node (par)->rptr) {
+        pCur    = par;
+        par     = get_parent (node (par));
+    }
+    return par;
+}
+
+/**
+ * @brief                   Finds the inorder predecessor of a node by following child and parent links (no comparisons are made), along with
+ *                          the offsets kept by its ancestors (see next_ptr)
+ *
+ * @param pCur              Node whose predecessor is to be found
+ * @param pOffset           Sum of the offsets kept by the ancestors of the node (updated to that of the predecessor)
+ *
+ * @return link_t           Link to the inorder predecessor (null if the node holds the smallest value)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::prev_ptr (link_t pCur, offset_t & pOffset) const
+{
+    link_t par;
+
+    // if a left subtree exists, the predecessor is its rightmost node
+    if (node (pCur)->lptr != NIL) {
+        pOffset = offset_below (node (pCur), pOffset);
+        return find_max (node (pCur)->lptr, pOffset);
+    }
+
+    // otherwise, climb up until the current node is reached from the right (that ancestor is the predecessor)
+    par = get_parent (node (pCur));
+    while (par != NIL && pCur == node (par)->lptr) {
+        pCur    = par;
+        par     = get_parent (node (par));
+
+        if constexpr (mShiftable && std::is_integral<val_t>::value) {
+            pOffset = (val_t)(pOffset - node (pCur)->shift);
+        }
+    }
+
+    if constexpr (mShiftable) {
+        if (par != NIL) {
+            if constexpr (std::is_integral<val_t>::value) {
+                pOffset = (val_t)(pOffset - node (par)->shift);
+            }
+            else {
+                pOffset = offset (par);
+            }
+        }
+    }
+    return par;
+}
+
+/**
+ * @brief                   Finds the inorder predecessor of a node by following child and parent links (no comparisons are made)
+ *
+ * @note                    Stepping through all the nodes of the tree this way takes amortized constant time per step
+ *
+ * @param pCur              Node whose predecessor is to be found
+ *
+ * @return link_t           Link to the inorder predecessor (null if the node holds the smallest value)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::prev_ptr (link_t pCur) const
+{
+    link_t par;
+
+    // if a left subtree exists, the predecessor is its rightmost node
+    if (node (pCur)->lptr != NIL) {
+        return find_max (node (pCur)->lptr);
+    }
+
+    // otherwise, climb up until the current node is reached from the right (that ancestor is the predecessor)
+    par = get_parent (node (pCur));
+    while (par != NIL && pCur == node (par)->lptr) {
+        pCur    = par;
+        par     = get_parent (node (par));
+    }
+    return par;
+}
+
+/**
+ * @brief                   Inserts a new node as a child of a given node, which must be the correct place for its value
+ *
+ * @note                    Since the path from the root is not known, balance factors are updated by following parent links upwards, until
+ *                          the height of some subtree stops changing (which always happens after a rotation)
+ *
+ * @param pPar              Link to the node which is to become the parent (null if the tree is empty)
+ * @param pLeft             Whether the new node is to become the left child (the child must be null)
+ * @param pVal              Reference to value to be inserted
+ *
+ * @return link_t           Link to the new node (null if it could not be allocated)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::insert_at (link_t pPar, bool pLeft, const val_t & pVal)
+{
+    link_t      ins     {mPool->allocate ()};
+
+    if (ins == NIL) {
+        DBG_MODE (std::cout << "Could not allocate new node\n";)
+        return NIL;
+    }
+    new (node (ins)) node_t {NIL, NIL, pPar, pVal};
+
+    if (pPar == NIL) {
+        mRoot = ins;
+        return ins;
+    }
+
+    // the parent was not reached from the root here, so the offsets above it are pushed down before the node goes below it
+    settle (pPar);
+    push (pPar);
+    (pLeft) ? (node (pPar)->lptr = ins) : (node (pPar)->rptr = ins);
+
+    // go up, updating the balance factor of each ancestor as long as its subtree has grown taller
+    link_t      cur     {ins};
+    link_ptr_t  link;
+    bool        grown;
+
+    for (link_t par = pPar; par != NIL; par = get_parent (node (cur))) {
+
+        link    = link_to (par);
+        grown   = rebalance_grown (link, node (par)->lptr == cur);
+        cur     = *link;
+
+        if (!grown) {
+            break;
+        }
+    }
+
+    // the ancestors above keep their balance factors, but their subtrees still hold one more node (so the fast path takes O(log n) here)
+    if constexpr (AUGMENTED) {
+        for (cur = get_parent (node (cur)); cur != NIL; cur = get_parent (node (cur))) {
+            update (cur);
+        }
+    }
+
+    return ins;
+}
+
+/**
+ * @brief                   Returns the link which refers to a node (the root of the tree, or the link of its parent to it)
+ *
+ * @param pCur              Link to the node
+ *
+ * @return link_ptr_t       Pointer to the link
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_ptr_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_to (link_t pCur)
+{
+    link_t      par     {get_parent (node (pCur))};
+
+    if (par == NIL) {
+        return &mRoot;
+    }
+    return (node (par)->lptr == pCur) ? (&node (par)->lptr) : (&node (par)->rptr);
+}
+
+/**
+ * @brief                   Attempts to insert a new node in the subtree of an existing node (without recursion)
+ *
+ * @note                    The links followed on the way down are kept on a fixed-size stack, and on the way back up balance factors
+ *                          are only updated until the height of some subtree stops changing (which always happens after a rotation)
+ *
+ * @param pRoot             Pointer to the link of the node in whose subtree the new value must be inserted
+ * @param pVal              Reference to value to be inserted
+ * @param pRes              Reference to the variable where the link to the new node (or the node equal to the value) is kept (null if a node
+ *                          could not be allocated)
+ *
+ * @return true             If insertion was successful (new node created)
+ * @return false            If insertion failed
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+bool
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::insert (link_ptr_t pRoot, const val_t & pVal, link_t & pRes)
+{
+    link_ptr_t  path[MAX_DEPTH];                    // links followed from the root to the parent of the new node
+    size_t      depth   {0};
+
+    link_ptr_t  cur     {pRoot};                    // link under which the new node is to be placed
+    link_t      par     {(*pRoot != NIL) ? (get_parent (node (*pRoot))) : (NIL)};
+    node_ptr_t  curNode;
+    int32_t     res;
+
+    // go down until a null link is reached, which is the correct location to insert a node
+    while (*cur != NIL) {
+
+        curNode = node (*cur);
+        res     = compare (pVal, curNode->val);
+
+        // found matching node, return false to indicate failed insertion
+        if (res == 0) {
+            pRes = *cur;
+            return false;
+        }
+
+        push (*cur);
+        path[depth++]   = cur;
+        par             = *cur;
+        cur             = (res < 0) ? (&curNode->lptr) : (&curNode->rptr);
+    }
+
+    link_t      ins     {mPool->allocate ()};
+
+    pRes    = ins;
+
+    // failed insertion (allocation failed)
+    if (ins == NIL) {
+        DBG_MODE (std::cout << "Could not allocate new node\n";)
+        return false;
+    }
+    new (node (ins)) node_t {NIL, NIL, par, pVal};
+
+    // make the link point to the newly created node (which is balanced, and a new level of the subtree)
+    *cur    = ins;
+
+    // go back up, updating the balance factor of each ancestor as long as its subtree has grown taller
+    while (depth != 0) {
+
+        link_ptr_t  up  {path[--depth]};
+
+        if (!rebalance_grown (up, cur == &node (*up)->lptr)) {
+            break;
+        }
+        cur = up;
+    }
+
+    // the ancestors above keep their balance factors, but their subtrees still hold one more node
+    if constexpr (AUGMENTED) {
+        while (depth != 0) {
+            update (*path[--depth]);
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief                   Attempts to erase a node from the subtree of an existing node (without recursion)
+ *
+ * @note                    A node with two children is replaced by its inorder neighbour from the taller side (the successor if both
+ *                          sides are equally tall), and on the way back up balance factors are only updated until the height of some
+ *                          subtree stops changing
+ *
+ * @param pRoot             Pointer to the link of the node in whose subtree the value must be erased
+ * @param pVal              Reference to value to be erased
+ *
+ * @return true             If erasing was successful (old node deleted)
+ * @return false            If erasing failed
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+bool
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::erase (link_ptr_t pRoot, const val_t & pVal)
+{
+    link_ptr_t  path[MAX_DEPTH];                    // links followed from the root to the parent of the node that is unlinked
+    size_t      depth   {0};
+
+    link_ptr_t  cur     {pRoot};                    // link to the node that holds the value
+    node_ptr_t  curNode;
+    int32_t     res;
+
+    // go down until a matching node is found
+    while (true) {
+
+        // could not find matching node, return failed erase
+        if (*cur == NIL) {
+            return false;
+        }
+
+        curNode = node (*cur);
+        res     = compare (pVal, curNode->val);
+
+        // the children of the matching node are changed as well, so its offset is pushed down in any case
+        push (*cur);
+
+        if (res == 0) {
+            break;
+        }
+
+        path[depth++]   = cur;
+        cur             = (res < 0) ? (&curNode->lptr) : (&curNode->rptr);
+    }
+
+    link_t      del     {*cur};
+    link_ptr_t  below;                              // link (inside the lowest node on the path) that has lost a level
+
+    // both children exist, unlink the inorder neighbour from the taller side and put it in place of the matching node
+    if (curNode->lptr != NIL && curNode->rptr != NIL) {
+
+        bool        left    {get_balance (curNode) < 0};
+        size_t      top     {depth};
+
+        link_ptr_t  rep     {(left) ? (&curNode->lptr) : (&curNode->rptr)};
+        node_ptr_t  repNode {node (*rep)};
+
+        path[depth++] = cur;
+
+        // the predecessor is the rightmost node of the left subtree, and the successor is the leftmost node of the right subtree
+        while (((left) ? (repNode->rptr) : (repNode->lptr)) != NIL) {
+            push (*rep);
+            path[depth++]   = rep;
+            rep             = (left) ? (&repNode->rptr) : (&repNode->lptr);
+            repNode         = node (*rep);
+        }
+        push (*rep);
+
+        // the only child of the neighbour (if any) takes its place
+        link_t      nxt     {*rep};
+        link_t      orphan  {(left) ? (repNode->lptr) : (repNode->rptr)};
+
+        *rep    = orphan;
+        set_parent (orphan, get_parent (repNode));
+
+        // the neighbour takes over the children, parent and balance factor of the matching node
+        repNode->lptr   = curNode->lptr;
+        repNode->rptr   = curNode->rptr;
+        repNode->pptr   = curNode->pptr;
+
+        set_parent (repNode->lptr, nxt);
+        set_parent (repNode->rptr, nxt);
+
+        *cur    = nxt;
+
+        // links that lived inside the matching node now live inside the neighbour
+        if (depth == top + 1) {
+            below           = (left) ? (&repNode->lptr) : (&repNode->rptr);
+        }
+        else {
+            path[top + 1]   = (left) ? (&repNode->lptr) : (&repNode->rptr);
+            below           = rep;
+        }
+    }
+
+    // at most one child exists, which takes the place of the matching node
+    else {
+
+        link_t      nxt     {(curNode->lptr != NIL) ? (curNode->lptr) : (curNode->rptr)};
+
+        set_parent (nxt, get_parent (curNode));
+        *cur    = nxt;
+        below   = cur;
+    }
+
+    mPool->deallocate (del);
+
+    // go back up, updating the balance factor of each ancestor as long as its subtree has become shorter
+    while (depth != 0) {
+
+        link_ptr_t  up  {path[--depth]};
+
+        if (!rebalance_shrunk (up, below == &node (*up)->lptr)) {
+            break;
+        }
+        below = up;
+    }
+
+    // the ancestors above keep their balance factors, but their subtrees still hold one node less
+    if constexpr (AUGMENTED) {
+        while (depth != 0) {
+            update (*path[--depth]);
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief                   Clear the subtree of an entire node (including the node) by deleting
+ *
+ * @note                    See clear_subtree (the subtree is taken apart without recursing, so any number of nodes can be deleted)
+ *
+ * @param pCur              Link to node whose subtree is to be deleted
+ *
+ * @return size_t           Number of nodes which were deleted
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+size_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::clear (link_t pCur)
+{
+    return clear_subtree (*mPool, pCur);
+}
+
+/**
+ * @brief                   Destroys the subtree of a node (including the node) without recursing
+ *
+ * @note                    Each node is destroyed as soon as its children are known, going down to the left child, while the right children
+ *                          still to be destroyed are kept on a small fixed-size stack (so each node is read only once, and parent links are
+ *                          never followed)
+ *
+ * @param pPool             Pool from which the nodes were allocated
+ * @param pRoot             Link to the root of the subtree
+ *
+ * @return size_t           Number of nodes which were destroyed
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+size_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::clear_subtree (node_pool_t & pPool, link_t pRoot)
+{
+    link_t      pending[MAX_DEPTH];                 // right children still to be destroyed
+    size_t      top     {0};
+
+    size_t      res     {0};
+    link_t      cur     {pRoot};
+    link_t      lptr;
+    link_t      rptr;
+
+    while (cur != NIL) {
+
+        lptr    = pPool.get (cur)->lptr;
+        rptr    = pPool.get (cur)->rptr;
+
+        pPool.deallocate (cur);
+        ++res;
+
+        if (lptr != NIL) {
+            if (rptr != NIL) {
+                // the right child is reached only after the whole left subtree, so its node can be fetched in the meantime
+                AG_AVL_PREFETCH (pPool.get (rptr));
+                pending[top++]  = rptr;
+            }
+            cur = lptr;
+        }
+        else if (rptr != NIL) {
+            cur = rptr;
+        }
+        else {
+            cur = (top != 0) ? (pending[--top]) : (NIL);
+        }
+    }
+
+    return res;
+}
+
+/**
+ * @brief                   Erases all elements not less than a given value and less than another (or all of them, if there is no other value)
+ *
+ * @note                    The tree is split at both ends of the range, the subtree lying in between is destroyed in a single pass and the
+ *                          two outer subtrees are joined back. Only the O(log n) nodes on the paths to the two ends are rebalanced, so the
+ *                          whole range takes O(log n + k) time for k erased elements (instead of one descent and retrace per element).
+ *                          Both values may refer to values held by the tree, as nodes are only destroyed once the tree has been split
+ *
+ * @param pLo               The smallest value to be erased
+ * @param pHi               Pointer to the value up to which (exclusive) elements are erased (null to erase up to the end, must not be
+ *                          less than pLo)
+ *
+ * @return size_t           Number of elements which were erased
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+size_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::erase_range_ptr (const val_t &pLo, const val_t *pHi)
+{
+    subtree_t   left;
+    subtree_t   mid;
+    subtree_t   right   {NIL, 0};
+
+    link_t      first   {split ({mRoot, height (mRoot)}, pLo, left, mid)};
+    link_t      last    {NIL};
+
+    // a node equal to the upper end is kept, and becomes the node joining the two outer subtrees
+    if (pHi != nullptr) {
+        last    = split (mid, *pHi, mid, right);
+    }
+
+    // destroy the node equal to the lower end (if any, its child links are stale after the split) along with everything in between
+    size_t      res     {0};
+
+    if (first != NIL) {
+        mPool->deallocate (first);
+        ++res;
+    }
+    if (mid.root != NIL) {
+        res += clear (mid.root);
+    }
+
+    mRoot   = (last != NIL) ? (join (left, last, right).root) : (concat (left, right).root);
+    mSz     -= res;
+
+    return res;
+}
+
+/**
+ * @brief                   Finds the height of a subtree by following its taller children down (as given by the balance factors)
+ *
+ * @param pCur              Link to the root of the subtree
+ *
+ * @return int32_t          Number of levels of the subtree (0 if it is empty)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+int32_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::height (link_t pCur) const
+{
+    int32_t     res {0};
+    node_ptr_t  cur;
+
+    for (; pCur != NIL; ++res) {
+        cur     = node (pCur);
+        pCur    = (get_balance (cur) > 0) ? (cur->rptr) : (cur->lptr);
+    }
+    return res;
+}
+
+/**
+ * @brief                   Joins two subtrees and a node into a single subtree (all values of the left subtree must be smaller than the value of
+ *                          the node, and all values of the right subtree must be greater)
+ *
+ * @note                    If the heights differ by more than one, the node is hung in place of the first subtree of the taller tree (down the
+ *                          side facing the shorter tree) which is at most one level taller than the shorter tree, and the path back up is then
+ *                          rebalanced as after an insertion. This takes time proportional to the difference in heights
+ *
+ * @param pLeft             Subtree holding the smaller values
+ * @param pMid              Link to the node to be placed between them (its links are overwritten)
+ * @param pRight            Subtree holding the greater values
+ *
+ * @return subtree_t        The joined subtree
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::subtree_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::join (subtree_t pLeft, link_t pMid, subtree_t pRight)
+{
+    node_ptr_t  mid     {node (pMid)};
+
+    // if the heights are close enough, the node simply becomes the root
+    if (pLeft.height - pRight.height <= 1 && pRight.height - pLeft.height <= 1) {
+
+        mid->lptr   = pLeft.root;
+        mid->rptr   = pRight.root;
+        mid->pptr   = NIL;
+        set_balance (mid, (int8_t)(pRight.height - pLeft.height));
+
+        set_parent (pLeft.root, pMid);
+        set_parent (pRight.root, pMid);
+        update (pMid);
+
+        return {pMid, max (pLeft.height, pRight.height) + 1};
+    }
+
+    bool        left    {pLeft.height > pRight.height};                         // whether the node goes down the right side of the left tree
+    subtree_t   tall    {(left) ? (pLeft) : (pRight)};
+    subtree_t   shrt    {(left) ? (pRight) : (pLeft)};
+
+    link_ptr_t  path[MAX_DEPTH];                                                // links followed from the root of the taller tree
+    size_t      depth   {0};
+
+    link_t      root    {tall.root};
+    link_ptr_t  cur     {&root};
+    int32_t     h       {tall.height};
+    node_ptr_t  curNode;
+
+    // go down the inner side of the taller tree until the subtree is at most one level taller than the shorter tree
+    while (h > shrt.height + 1) {
+
+        curNode         = node (*cur);
+        path[depth++]   = cur;
+        push (*cur);
+
+        if (left) {
+            h   -= (get_balance (curNode) >= 0) ? (1) : (2);
+            cur = &curNode->rptr;
+        }
+        else {
+            h   -= (get_balance (curNode) <= 0) ? (1) : (2);
+            cur = &curNode->lptr;
+        }
+    }
+
+    // the node takes the place of the subtree, which hangs from it along with the shorter tree (making it one level taller)
+    link_t      sub     {*cur};
+
+    mid->lptr   = (left) ? (sub) : (shrt.root);
+    mid->rptr   = (left) ? (shrt.root) : (sub);
+    mid->pptr   = (depth != 0) ? (*path[depth - 1]) : (NIL);
+    set_balance (mid, (int8_t)((left) ? (shrt.height - h) : (h - shrt.height)));
+
+    set_parent (sub, pMid);
+    set_parent (shrt.root, pMid);
+    update (pMid);
+    *cur        = pMid;
+
+    // go back up, updating the balance factor of each ancestor as long as its subtree has grown taller
+    bool        grown   {true};
+
+    while (grown && depth != 0) {
+        grown = rebalance_grown (path[--depth], !left);
+    }
+
+    // the ancestors above keep their balance factors, but their subtrees now hold the shorter tree and the node as well
+    if constexpr (AUGMENTED) {
+        while (depth != 0) {
+            update (*path[--depth]);
+        }
+    }
+
+    return {root, tall.height + ((grown) ? (1) : (0))};
+}
+
+/**
+ * @brief                   Splits a subtree into the subtrees of values smaller and greater than a given value
+ *
+ * @note                    The nodes on the path to the value are joined back with the subtrees hanging off the path on their other side,
+ *                          which takes O(log n) time in total
  *
- * @param pVal               The value to be compared with
+ * @param pCur              Subtree to be split (its nodes are all moved into the two new subtrees, except for a node equal to the value)
+ * @param pVal              Value at which to split
+ * @param pLeft             Reference to the subtree where all smaller values are kept
+ * @param pRight            Reference to the subtree where all greater values are kept
  *
- * @return AgAVLTree<val_t, mComp, mEquals>::iterator Iterator to last strictly less value in the tree (end() if no match found)
+ * @return link_t           Link to the node equal to the value, detached from both subtrees (null if there is none)
  */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::iterator
-AgAVLTree<val_t, mComp, mEquals>::last_smaller_strict (const val_t &pVal) const
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::split (subtree_t pCur, const val_t & pVal, subtree_t & pLeft, subtree_t & pRight)
 {
-    // get a pointer to the node with the appropriate value and give its ownership to an iterator instance
-    // in case nullptr is recieved, the iterator points to end()
-    node_ptr_t res  {last_smaller_strict_ptr (pVal)};
-    return iterator (res, this);
+    if (pCur.root == NIL) {
+        pLeft   = {NIL, 0};
+        pRight  = {NIL, 0};
+        return NIL;
+    }
+
+    node_ptr_t  cur     {node (pCur.root)};
+    int8_t      bal     {get_balance (cur)};
+
+    push (pCur.root);
+
+    // detach both children of the node (the heights of their subtrees follow from its balance factor)
+    subtree_t   lsub    {cur->lptr, pCur.height - ((bal <= 0) ? (1) : (2))};
+    subtree_t   rsub    {cur->rptr, pCur.height - ((bal >= 0) ? (1) : (2))};
+
+    set_parent (lsub.root, NIL);
+    set_parent (rsub.root, NIL);
+
+    int32_t     res     {compare (pVal, cur->val)};
+    link_t      found;
+    subtree_t   part;
+
+    if (res == 0) {
+        pLeft   = lsub;
+        pRight  = rsub;
+        return pCur.root;
+    }
+
+    // the value lies to the left, so the node and its right subtree go to the greater side along with the greater part of the left subtree
+    if (res < 0) {
+        found   = split (lsub, pVal, pLeft, part);
+        pRight  = join (part, pCur.root, rsub);
+    }
+    else {
+        found   = split (rsub, pVal, part, pRight);
+        pLeft   = join (lsub, pCur.root, part);
+    }
+
+    return found;
 }
 
 /**
- * @brief                   Finds and returns an iterator to the last value less than or equal to the given value (end() if no match exists)
+ * @brief                   Joins two subtrees into a single subtree (all values of the left subtree must be smaller than those of the right)
  *
- * @param pVal              The value to be compared with
+ * @note                    The smallest node of the right subtree is split off and used to join the two, which takes O(log n) time
+ *
+ * @param pLeft             Subtree holding the smaller values
+ * @param pRight            Subtree holding the greater values
  *
- * @return AgAVLTree<val_t, mComp, mEquals>::iterator Iterator to last less or equal value in the tree (end() if no match found)
+ * @return subtree_t        The joined subtree
  */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::iterator
-AgAVLTree<val_t, mComp, mEquals>::last_smaller_equals (const val_t &pVal) const
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::subtree_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::concat (subtree_t pLeft, subtree_t pRight)
 {
-    // get a pointer to the node with the appropriate value and give its ownership to an iterator instance
-    // in case nullptr is recieved, the iterator points to end()
-    node_ptr_t res  {last_smaller_equals_ptr (pVal)};
-    return iterator (res, this);
+    if (pRight.root == NIL) {
+        return pLeft;
+    }
+    if (pLeft.root == NIL) {
+        return pRight;
+    }
+
+    offset_t    off     {};
+    link_t      min     {find_min (pRight.root, off)};
+
+    // nothing is smaller than the smallest node, so splitting at it leaves the greater side with everything else
+    subtree_t   none;
+    subtree_t   rest;
+
+    split (pRight, value (node (min), off), none, rest);
+    return join (pLeft, min, rest);
 }
 
 /**
- * @brief                   Returns the size of the tree (number of elements)
+ * @brief                   Returns the number of nodes in the smaller of two subtrees, and which of the two it is
  *
- * @return size_t           Size of tree
+ * @note                    Counted nodes know the sizes of their subtrees. Otherwise both subtrees are walked in order side by side, until
+ *                          the smaller one runs out, which takes O(log n + k) time for k nodes in the smaller subtree
+ *
+ * @param pA                Link to the root of the first subtree (its parent link must be null)
+ * @param pB                Link to the root of the second subtree (its parent link must be null)
+ * @param pFirst            Reference to variable which is set to whether the first subtree is the smaller one (or both are equal)
+ *
+ * @return size_t           Number of nodes in the smaller subtree
  */
-template <typename val_t, auto mComp, auto mEquals>
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
 size_t
-AgAVLTree<val_t, mComp, mEquals>::size () const
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::smaller_size (link_t pA, link_t pB, bool & pFirst) const
 {
-    return mSz;
+    if constexpr (mCounted) {
+        size_t      cntA    {subtree_size (pA)};
+        size_t      cntB    {subtree_size (pB)};
+
+        pFirst  = (cntA <= cntB);
+        return (pFirst) ? (cntA) : (cntB);
+    }
+    else {
+        link_t      curA    {find_min (pA)};
+        link_t      curB    {find_min (pB)};
+        size_t      res     {0};
+
+        while (curA != NIL && curB != NIL) {
+            curA    = next_ptr (curA);
+            curB    = next_ptr (curB);
+            ++res;
+        }
+
+        pFirst  = (curA == NIL);
+        return res;
+    }
 }
 
 /**
- * @brief                   Returns an iterator to the beginning
+ * @brief                   Takes over all nodes of another tree, which is left empty
  *
- * @return AgAVLTree<val_t, mComp, mEquals>::iterator Iterator to the first element
+ * @note                    The nodes are handed over as they are if this tree is empty (and may use the pool of the other tree), or if the
+ *                          chunks of the pool of the other tree can be taken over (see absorb). Otherwise the
+ *                          elements are copied into new nodes, which are built into a balanced subtree in O(m) time, and the other tree is cleared
+ *
+ * @param pOther            Tree whose nodes are to be taken over (must not be empty)
+ * @param pSub              Reference to the subtree where the nodes are kept (not linked to any node of this tree)
+ * @param pCount            Reference to variable where the number of nodes is kept
+ *
+ * @return true             If the nodes were taken over
+ * @return false            If memory for the copies could not be allocated (in which case neither tree is changed)
  */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::iterator
-AgAVLTree<val_t, mComp, mEquals>::begin () const
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+bool
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::adopt (AgAVLTree & pOther, subtree_t & pSub, size_t & pCount)
 {
-    // get the pointer to the smallest (first) element of the tree and give its ownership to an iterator instance
-    return iterator (find_min (mRoot), this);
+    pSub    = {pOther.mRoot, 0};
+    pCount  = pOther.mSz;
+
+    // an empty tree can simply use the pool of the other tree
+    if (mRoot == NIL && mAlloc == pOther.mAlloc) {
+        drop_pool ();
+        mPool           = pOther.mPool;
+        pOther.mPool    = nullptr;
+    }
+
+    // the nodes of the other tree can be handed over along with its chunks
+    else if (mPool != nullptr && mAlloc == pOther.mAlloc && mPool->absorb (*pOther.mPool)) {}
+
+    // otherwise copy its elements into new nodes
+    else {
+        if (!reserve_nodes (pCount)) {
+            return false;
+        }
+
+        bool        ok      {true};
+        iterator    cur     {pOther.begin ()};
+
+        pSub.root   = build_subtree (cur, pOther.end (), pCount, ok);
+
+        if (!ok) {
+            return false;
+        }
+        pOther.clear ();
+    }
+
+    pSub.height     = height (pSub.root);
+
+    pOther.mRoot    = NIL;
+    pOther.mSz      = 0;
+    pOther.drop_pool ();
+
+    return true;
 }
 
 /**
- * @brief                   Returns an iterator to the element one after the last element
+ * @brief                   Merges two subtrees into one holding all values of both (a value present in both is kept from the first one)
+ *
+ * @note                    The first subtree is split around the root of the second one, and the matching halves are merged recursively
+ *                          and joined back with the root in between, which takes O(m log (n / m + 1)) time for subtrees of m and n nodes.
+ *                          Both halves only touch their own nodes, so they can be merged on separate threads
  *
- * @return AgAVLTree<val_t, mComp, mEquals>::iterator Iterator to the element following the last element
+ * @param pA                First subtree
+ * @param pB                Second subtree
+ * @param pForks            Number of levels of the recursion at which the two halves may still be merged on separate threads
+ * @param pGarbage          Reference to the list where the nodes of the second subtree which are duplicates are put (to be destroyed later)
+ *
+ * @return subtree_t        The merged subtree
  */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::iterator
-AgAVLTree<val_t, mComp, mEquals>::end () const
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::subtree_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::unite (subtree_t pA, subtree_t pB, int32_t pForks, link_t & pGarbage)
 {
-    // return an iterator instance pointing to nullptr
-    return iterator (nullptr, this);
+    if (pB.root == NIL) {
+        return pA;
+    }
+    if (pA.root == NIL) {
+        return pB;
+    }
+
+    node_ptr_t  mid     {node (pB.root)};
+    int8_t      bal     {get_balance (mid)};
+
+    push (pB.root);
+
+    subtree_t   bl      {mid->lptr, pB.height - ((bal <= 0) ? (1) : (2))};
+    subtree_t   br      {mid->rptr, pB.height - ((bal >= 0) ? (1) : (2))};
+
+    set_parent (bl.root, NIL);
+    set_parent (br.root, NIL);
+
+    subtree_t   al;
+    subtree_t   ar;
+    link_t      key     {split (pA, mid->val, al, ar)};
+
+    // if the value is already present in the first subtree, its node is kept
+    if (key != NIL) {
+        mid->lptr   = NIL;
+        mid->rptr   = NIL;
+        discard (pB.root, pGarbage);
+    }
+    else {
+        key = pB.root;
+    }
+
+    bool        par     {pForks > 0 && max (pA.height, pB.height) >= PARALLEL_HEIGHT};
+    link_t      lgarb   {NIL};
+    subtree_t   lres;
+    subtree_t   rres;
+
+    fork (par, [&] { lres = unite (al, bl, pForks - 1, (par) ? (lgarb) : (pGarbage)); },
+               [&] { rres = unite (ar, br, pForks - 1, pGarbage); });
+    splice (pGarbage, lgarb);
+
+    return join (lres, key, rres);
 }
 
 /**
- * @brief                   Returns a reverse iterator to the beginning
+ * @brief                   Removes all nodes of a subtree whose values are not present in a subtree of another tree
+ *
+ * @note                    The subtree is split around the root of the other subtree, and the matching halves are intersected recursively
+ *                          (on separate threads, see unite) and joined back, with the node equal to the root in between if there is one
  *
- * @return AgAVLTree<val_t, mComp, mEquals>::reverse_iterator Reverse Iterator to the beginning
+ * @param pA                Subtree to be intersected
+ * @param pOther            Tree holding the other subtree (only read)
+ * @param pB                Link to the root of the other subtree
+ * @param pOffset           Sum of the offsets kept by the ancestors of the root of the other subtree (which is only read, so they are not
+ *                          pushed down)
+ * @param pForks            Number of levels of the recursion at which the two halves may still be intersected on separate threads
+ * @param pGarbage          Reference to the list where the removed nodes (and subtrees) are put (to be destroyed later)
+ *
+ * @return subtree_t        The subtree holding only the common values
  */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::reverse_iterator
-AgAVLTree<val_t, mComp, mEquals>::rbegin () const
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::subtree_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::intersect (subtree_t pA, const AgAVLTree & pOther, link_t pB, offset_t pOffset, int32_t pForks, link_t & pGarbage)
 {
-    // get the pointer to the greatest (last) element of the tree and give its ownership to an iterator instance
-    return reverse_iterator (find_max (mRoot), this);
+    if (pA.root == NIL) {
+        return pA;
+    }
+
+    // nothing is common with an empty subtree, so the whole subtree goes
+    if (pB == NIL) {
+        discard (pA.root, pGarbage);
+        return {NIL, 0};
+    }
+
+    node_ptr_t  mid     {pOther.node (pB)};
+    offset_t    below   {offset_below (mid, pOffset)};
+
+    subtree_t   al;
+    subtree_t   ar;
+    link_t      key     {split (pA, value (mid, pOffset), al, ar)};
+
+    bool        par     {pForks > 0 && pA.height >= PARALLEL_HEIGHT};
+    link_t      lgarb   {NIL};
+    subtree_t   lres;
+    subtree_t   rres;
+
+    fork (par, [&] { lres = intersect (al, pOther, mid->lptr, below, pForks - 1, (par) ? (lgarb) : (pGarbage)); },
+               [&] { rres = intersect (ar, pOther, mid->rptr, below, pForks - 1, pGarbage); });
+    splice (pGarbage, lgarb);
+
+    return (key != NIL) ? (join (lres, key, rres)) : (concat (lres, rres));
 }
 
 /**
- * @brief                   Returns a reverse iterator to the element one after the last element
+ * @brief                   Removes all nodes of a subtree whose values are present in a subtree of another tree
+ *
+ * @note                    The subtree is split around the root of the other subtree, and the matching halves are subtracted from
+ *                          recursively (on separate threads, see unite) and joined back, without the node equal to the root
+ *
+ * @param pA                Subtree to be subtracted from
+ * @param pOther            Tree holding the other subtree (only read)
+ * @param pB                Link to the root of the other subtree
+ * @param pOffset           Sum of the offsets kept by the ancestors of the root of the other subtree (see intersect)
+ * @param pForks            Number of levels of the recursion at which the two halves may still be subtracted from on separate threads
+ * @param pGarbage          Reference to the list where the removed nodes are put (to be destroyed later)
  *
- * @return AgAVLTree<val_t, mComp, mEquals>::reverse_iterato Iterator to the element following the last element
+ * @return subtree_t        The subtree holding only the values not present in the other subtree
  */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::reverse_iterator
-AgAVLTree<val_t, mComp, mEquals>::rend () const
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::subtree_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::subtract (subtree_t pA, const AgAVLTree & pOther, link_t pB, offset_t pOffset, int32_t pForks, link_t & pGarbage)
 {
-    // return an iterator instance and which points to nullptr
-    return reverse_iterator (nullptr, this);
-}
+    if (pA.root == NIL || pB == NIL) {
+        return pA;
+    }
 
-// PRIVATE
+    node_ptr_t  mid     {pOther.node (pB)};
+    offset_t    below   {offset_below (mid, pOffset)};
+
+    subtree_t   al;
+    subtree_t   ar;
+    link_t      key     {split (pA, value (mid, pOffset), al, ar)};
+
+    // the node equal to the root goes (its links are stale after the split)
+    if (key != NIL) {
+        node (key)->lptr    = NIL;
+        node (key)->rptr    = NIL;
+        discard (key, pGarbage);
+    }
+
+    bool        par     {pForks > 0 && pA.height >= PARALLEL_HEIGHT};
+    link_t      lgarb   {NIL};
+    subtree_t   lres;
+    subtree_t   rres;
+
+    fork (par, [&] { lres = subtract (al, pOther, mid->lptr, below, pForks - 1, (par) ? (lgarb) : (pGarbage)); },
+               [&] { rres = subtract (ar, pOther, mid->rptr, below, pForks - 1, pGarbage); });
+    splice (pGarbage, lgarb);
+
+    return concat (lres, rres);
+}
 
 /**
- * @brief                   Returns the maximum of two elements (first if both compare equal)
- * @tparam arg_t            Type of values to be compared
+ * @brief                   Runs two functions, on separate threads if asked to
  *
- * @param pA                First element to be compared
- * @param pB                Second element to be compared
+ * @note                    The first function is run on a new thread while the calling thread runs the second one. If a thread can not be
+ *                          started, both are run one after the other on the calling thread
  *
- * @return arg_t            The maximum of the two supplied arguments
+ * @tparam left_t           Type of the first function
+ * @tparam right_t          Type of the second function
+ *
+ * @param pParallel         Whether the functions should be run on separate threads
+ * @param pLeft             First function
+ * @param pRight            Second function
  */
-template <typename val_t, auto mComp, auto mEquals>
-template <class arg_t>
-arg_t
-AgAVLTree<val_t, mComp, mEquals>::max (const arg_t & pA, const arg_t & pB)
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+template <typename left_t, typename right_t>
+void
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::fork (bool pParallel, left_t pLeft, right_t pRight)
 {
-    return (pA > pB) ? (pA) : (pB);
+    std::thread     thread;
+
+    if (pParallel) {
+        try {
+            thread = std::thread (pLeft);
+        }
+        catch (const std::system_error &) {}
+    }
+
+    if (thread.joinable ()) {
+        DBG_MODE (dbg_forks += 1;)
+        pRight ();
+        thread.join ();
+        return;
+    }
+
+    pLeft ();
+    pRight ();
 }
 
 /**
- * @brief                   Returns the minimum of two elements (first if both compare mEquals)
- * @tparam arg_t            Type of values to be compared
+ * @brief                   Returns the number of levels of a recursion which must fork to keep a number of threads busy
  *
- * @param pA                First element to be compared
- * @param pB                Second element to be compared
+ * @param pThreads          Maximum number of threads to run on (including the calling thread)
  *
- * @return arg_t            The maximum of the two supplied arguments
+ * @return int32_t          Number of levels at which to fork (each level doubles the number of threads, so this is the largest number of
+ *                          doublings which does not exceed the given number of threads)
  */
-template <typename val_t, auto mComp, auto mEquals>
-template <class arg_t>
-arg_t
-AgAVLTree<val_t, mComp, mEquals>::min (const arg_t & pA, const arg_t & pB)
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+int32_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::forks (size_t pThreads)
 {
-    return (pA < pB) ? (pA) : (pB);
+    return (pThreads > 1) ? (levels (pThreads) - 1) : (0);
 }
 
 /**
- * @brief                   Calculates the depths of the left and right subtrees of the given node
- *
- * @note                    The calculated depths are of the subtrees of the given node, i.e. they include the supplied node
+ * @brief                   Puts a subtree (or a single node, whose child links must be null) on a list of subtrees to be destroyed
  *
- * @param pCur              Node whose subtrees's heights are to be calculated
- * @param pLdep             Reference to variable where left subtree's depth is kept
- * @param pRdep             Reference to variable where right subtree's depth is kept
+ * @note                    The subtrees are linked through the parent links of their roots, which are not needed anymore
  *
+ * @param pRoot             Link to the root of the subtree (detached from its parent)
+ * @param pGarbage          Reference to the head of the list
  */
-template <typename val_t, auto mComp, auto mEquals>
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
 void
-AgAVLTree<val_t, mComp, mEquals>::calc_height (node_ptr_t pCur, uint8_t & pLdep, uint8_t & pRdep)
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::discard (link_t pRoot, link_t & pGarbage) const
 {
-    // if a child does not exist, return 0 (the corresponding subtree is non-existant) otherwise return its height + 1
-    pLdep   = (pCur->lptr != nullptr) ? (1 + pCur->lptr->height) : (0);
-    pRdep   = (pCur->rptr != nullptr) ? (1 + pCur->rptr->height) : (0);
+    node (pRoot)->pptr  = pGarbage;
+    pGarbage            = pRoot;
 }
 
 /**
- * @brief                   Function to balance a node which is left-left heavy
+ * @brief                   Moves all subtrees of one list of subtrees to be destroyed to the front of another
  *
- * @param pRoot             Pointer to the edge between the pivot and it's parent
+ * @param pGarbage          Reference to the head of the list to move the subtrees to
+ * @param pOther            Head of the list to move the subtrees from
  */
-template <typename val_t, auto mComp, auto mEquals>
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
 void
-AgAVLTree<val_t, mComp, mEquals>::balance_ll (link_ptr_t pRoot)
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::splice (link_t & pGarbage, link_t pOther) const
 {
-    uint8_t    ldep;                                // stores the left and
-    uint8_t    rdep;                                // right depths of the pivot (top) node
-
-    node_ptr_t top;                                 // pointers to the pivot (top) node and
-    node_ptr_t bot;                                 // the heavier child (left) of the pivot
-
-    top             = *pRoot;
-    bot             = top->lptr;
-
-    top->lptr       = bot->rptr;                    // right child of bot becomes left child of top
-    bot->rptr       = top;                          // top becomes the right child of bot
-    *pRoot          = bot;                          // pointer to top now points to bot
+    if (pOther == NIL) {
+        return;
+    }
 
-    // recalculate depths of shifted nodes
-    calc_height (top, ldep, rdep);
-    top->height     = max (ldep, rdep);
+    link_t  tail    {pOther};
 
-    // calc_height (bot, ldep, rdep);
-    // bot->height = max (ldep, rdep);
-    bot->height     = 1 + max (bot->lptr->height, bot->rptr->height);
+    while (node (tail)->pptr != NIL) {
+        tail = node (tail)->pptr;
+    }
 
-    DBG_MODE (dbg_info.ll_count += 1;)
+    node (tail)->pptr   = pGarbage;
+    pGarbage            = pOther;
 }
 
 /**
- * @brief                   Function to balance a node which is left-right heavy
+ * @brief                   Destroys all subtrees on a list of subtrees to be destroyed
  *
- * @param pRoot             Pointer to the edge between the pivot and it's parent
+ * @param pGarbage          Head of the list
+ *
+ * @return size_t           Number of nodes which were destroyed
  */
-template <typename val_t, auto mComp, auto mEquals>
-void
-AgAVLTree<val_t, mComp, mEquals>::balance_lr (link_ptr_t pRoot)
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+size_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::clear_list (link_t pGarbage)
 {
-    uint8_t    ldep;                                // intermediary variables for storing the left
-    uint8_t    rdep;                                // and right depths of nodes while recalculating their depths
+    size_t  res     {0};
+    link_t  nxt;
 
-    node_ptr_t top;                                 // pointers to the pivot (top) node,
-    node_ptr_t mid;                                 // the heavier child (left) of the pivot,
-    node_ptr_t bot;                                 // heavier child (right) of the middle
+    for (; pGarbage != NIL; pGarbage = nxt) {
+        nxt = node (pGarbage)->pptr;
+        res += clear (pGarbage);
+    }
+    return res;
+}
 
-    top             = *pRoot;
-    mid             = top->lptr;
-    bot             = mid->rptr;
+/**
+ * @brief                   Finds a node with value equal to the given value
+ *
+ * @param pVal              Value to find
+ *
+ * @return AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t Link to the node with equal value (or null in the case of no match)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::find_ptr (const val_t & pVal) const
+{
+    link_t      cur {mRoot};
+    node_ptr_t  ptr;
+    offset_t    off {};
+    int32_t     res;
 
-    mid->rptr       = bot->lptr;                    // left child of bot becomes right child of mid
-    bot->lptr       = mid;                          // mid becomes left child of bot
-    top->lptr       = bot->rptr;                    // right child of bot becomes left child of top
-    bot->rptr       = top;                          // top becomes right child of bot
-    *pRoot          = bot;                          // pointer to top now points to bot
+    // repeat while a valid node is being pointed to (not crossed a leaf)
+    while (cur != NIL) {
 
-    // recalculate depths of shifted nodes
-    calc_height (top, ldep, rdep);
-    top->height     = max (ldep, rdep);
+        // if a matching node was found, return it
+        ptr = node (cur);
+        res = compare (pVal, value (ptr, off));
 
-    calc_height (mid, ldep, rdep);
-    mid->height     = max (ldep, rdep);
+        if (res == 0) {
+            return cur;
+        }
 
-    // calc_height (bot, ldep, rdep);
-    // bot->height = max (ldep, rdep);
-    bot->height     = 1 + max (bot->lptr->height, bot->rptr->height);
+        // go left if current node is too big, else go right
+        off = offset_below (ptr, off);
+        cur = (res < 0) ? (ptr->lptr) : (ptr->rptr);
+    }
 
-    DBG_MODE (dbg_info.lr_count += 1;)
+    // if no match was found, return null
+    return NIL;
 }
 
 /**
- * @brief                   Function to balance a node which is right-left heavy
+ * @brief                   Finds a node with value strictly greater than the given value in an existing node's subtree
  *
- * @param pRoot             Pointer to the edge between the pivot and it's parent
+ * @param pVal              Value to find
+ * @param pCur              Pointer to node in whose subtree the search must take place
+ * @param pOffset           Sum of the offsets kept by the ancestors of the node
+ *
+ * @return AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t Link to node with a strictly greater value (or null in the case of no match)
  */
-template <typename val_t, auto mComp, auto mEquals>
-void
-AgAVLTree<val_t, mComp, mEquals>::balance_rl (link_ptr_t pRoot)
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::first_greater_strict_ptr (const val_t & pVal, link_t pCur, offset_t pOffset) const
 {
-    uint8_t    ldep;                                // intermediary variables for storing the left
-    uint8_t    rdep;                                // and right depths of nodes while recalculating their depths
+    link_t      res {NIL};                                                      // best match found so far
+    node_ptr_t  cur;
 
-    node_ptr_t top;                                 // pointers to the pivot (top) node,
-    node_ptr_t mid;                                 // the heavier child (right) of the pivot,
-    node_ptr_t bot;                                 // heavier child (left) of the middle
+    // repeat while a valid node is being pointed to (not crossed a leaf)
+    while (pCur != NIL) {
 
-    top             = *pRoot;
-    mid             = top->rptr;
-    bot             = mid->lptr;
+        cur = node (pCur);
 
-    top->rptr       = bot->lptr;                    // left child of bot becomes right child of top
-    bot->lptr       = top;                          // top becomes left child of bot
-    mid->lptr       = bot->rptr;                    // right child of bot becomes left child of mid
-    bot->rptr       = mid;                          // mid becomes right child of bot
-    *pRoot          = bot;                          // pointer to top now points to bot
+        // if the current node <= supplied value, go right (current node's value is too small)
+        if (!less (pVal, value (cur, pOffset))) {
+            pCur    = cur->rptr;
+        }
 
-    // recalculate depths of shifted nodes
-    calc_height (top, ldep, rdep);
-    top->height     = max (ldep, rdep);
+        // otherwise the current node is a match, but a smaller one might exist on the left
+        else {
+            res     = pCur;
+            pCur    = cur->lptr;
+        }
 
-    calc_height (mid, ldep, rdep);
-    mid->height     = max (ldep, rdep);
+        pOffset = offset_below (cur, pOffset);
+    }
 
-    // calc_height (bot, ldep, rdep);
-    // bot->height = max (ldep, rdep);
-    bot->height     = 1 + max (bot->lptr->height, bot->rptr->height);
+    return res;
+}
 
-    DBG_MODE (dbg_info.rl_count += 1;)
+/**
+ * @brief                   Finds a node with value strictly greater than the given value
+ *
+ * @param pVal              Value to find
+ *
+ * @return AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t Link to node with a strictly greater value (or null in the case of no match)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::first_greater_strict_ptr (const val_t & pVal) const
+{
+    return first_greater_strict_ptr (pVal, mRoot, {});
 }
 
 /**
- * @brief                   Function to balance a node which is right-right heavy
+ * @brief                   Finds a node with value not less than the given value in an existing node's subtree
  *
- * @param pRoot             Pointer to the edge between the pivot and it's parent
+ * @param pVal              Value to find
+ * @param pCur              Pointer to node in whose subtree the search must take place
+ * @param pOffset           Sum of the offsets kept by the ancestors of the node
+ *
+ * @return AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t Link to node with a greater or equal value (or null in the case of no match)
  */
-template <typename val_t, auto mComp, auto mEquals>
-void
-AgAVLTree<val_t, mComp, mEquals>::balance_rr (link_ptr_t pRoot)
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::first_greater_equals_ptr (const val_t & pVal, link_t pCur, offset_t pOffset) const
 {
-    uint8_t    ldep;                                // stores the left and
-    uint8_t    rdep;                                // right depths of the pivot (top) node
+    link_t      res {NIL};                                                      // best match found so far
+    node_ptr_t  cur;
 
-    node_ptr_t top;                                 // pointers to the pivot (top) node and
-    node_ptr_t bot;                                 // the heavier child (right) of the pivot
+    // repeat while a valid node is being pointed to (not crossed a leaf)
+    while (pCur != NIL) {
 
-    top             = *pRoot;
-    bot             = top->rptr;
+        cur = node (pCur);
 
-    top->rptr       = bot->lptr;                    // left child of bot becomes right child of top
-    bot->lptr       = top;                          // top becomes the left child of bot
-    *pRoot          = bot;                          // pointer to top now points to bot
+        // if the current node < supplied value, go right (current node's value is too small)
+        if (less (value (cur, pOffset), pVal)) {
+            pCur    = cur->rptr;
+        }
 
-    // recalculate depths of shifted nodes
-    calc_height (top, ldep, rdep);
-    top->height     = max (ldep, rdep);
+        // otherwise the current node is a match, but a smaller one might exist on the left
+        else {
+            res     = pCur;
+            pCur    = cur->lptr;
+        }
 
-    // calc_height (bot, ldep, rdep);
-    // bot->height = max (ldep, rdep);
+        pOffset = offset_below (cur, pOffset);
+    }
 
-    bot->height     = 1 + max (bot->lptr->height, bot->rptr->height);
+    return res;
+}
 
-    DBG_MODE (dbg_info.rr_count += 1;)
+/**
+ * @brief                   Finds a node with value not less than the given value
+ *
+ * @param pVal              Value to find
+ *
+ * @return AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t Link to node with a greater or equal value (or null in the case of no match)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::first_greater_equals_ptr (const val_t & pVal) const
+{
+    return first_greater_equals_ptr (pVal, mRoot, {});
 }
 
 /**
- * @brief                   Finds the minimum value node in a subtree without modifying it
+ * @brief                   Finds a node with value strictly less than the given value in an existing node's subtree
  *
- * @param pRoot             Root of the subtree to be processed
+ * @param pVal              Value to find
+ * @param pCur              Pointer to node in whose subtree the search must take place
+ * @param pOffset           Sum of the offsets kept by the ancestors of the node
  *
- * @return node_ptr_t       Pointer to minimum value node in the subtree of pRoot
+ * @return AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t Link to node with a strictly less value (or null in the case of no match)
  */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::node_ptr_t
-AgAVLTree<val_t, mComp, mEquals>::find_min (node_ptr_t pRoot) const
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::last_smaller_strict_ptr (const val_t & pVal, link_t pCur, offset_t pOffset) const
 {
-    node_ptr_t res {pRoot};
+    link_t      res {NIL};                                                      // best match found so far
+    node_ptr_t  cur;
 
-    // if the root does not exist (no nodes in tree), return null
-    if (res == nullptr) {
-        return nullptr;
-    }
+    // repeat while a valid node is being pointed to (not crossed a leaf)
+    while (pCur != NIL) {
 
-    // keep going left for as long as possible and return the leftmost (smallest) node
-    while (res->lptr != nullptr) {
-        res = res->lptr;
+        cur = node (pCur);
+
+        // if the supplied value <= current node, go left (current node's value is too big)
+        if (!less (value (cur, pOffset), pVal)) {
+            pCur    = cur->lptr;
+        }
+
+        // otherwise the current node is a match, but a larger one might exist on the right
+        else {
+            res     = pCur;
+            pCur    = cur->rptr;
+        }
+
+        pOffset = offset_below (cur, pOffset);
     }
 
     return res;
 }
 
 /**
- * @brief                   Finds the minimum value node in the entire tree without modifying it
+ * @brief                   Finds a node with value strictly less than the given value
+ *
+ * @param pVal              Value to find
  *
- * @return node_ptr_t       Pointer to the minimum value node in the entire tree
+ * @return AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t Link to node with a strictly less value (or null in the case of no match)
  */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::node_ptr_t
-AgAVLTree<val_t, mComp, mEquals>::find_min () const
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::last_smaller_strict_ptr (const val_t & pVal) const
 {
-    // return a pointer to the minimum value node in the root's subtree (entire tree)
-    return find_min (mRoot);
+    return last_smaller_strict_ptr (pVal, mRoot, {});
 }
 
 /**
- * @brief                   Finds the maximum value node in a subtree without modifying it
+ * @brief                   Finds a node with value not more than the given value in an existing node's subtree
  *
- * @param pRoot             Root of the subtree to be processed
+ * @param pVal              Value to find
+ * @param pCur              Pointer to node in whose subtree the search must take place
+ * @param pOffset           Sum of the offsets kept by the ancestors of the node
  *
- * @return node_ptr_t       Pointer to maximum value node in the subtree of pRoot
+ * @return AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t Link to node with a less or equal value (or null in the case of no match)
  */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::node_ptr_t
-AgAVLTree<val_t, mComp, mEquals>::find_max (node_ptr_t pRoot) const
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::last_smaller_equals_ptr (const val_t & pVal, link_t pCur, offset_t pOffset) const
 {
-    node_ptr_t res {pRoot};
+    link_t      res {NIL};                                                      // best match found so far
+    node_ptr_t  cur;
 
-    // if the root does not exist (no nodesi n tree), return null
-    if (res == nullptr) {
-        return nullptr;
-    }
+    // repeat while a valid node is being pointed to (not crossed a leaf)
+    while (pCur != NIL) {
 
-    // keep going right for as long as possible and return the rightmost (greatest) node
-    while (res->rptr != nullptr) {
-        res = res->rptr;
+        cur = node (pCur);
+
+        // if the supplied value < current node, go left (current node's value is too big)
+        if (less (pVal, value (cur, pOffset))) {
+            pCur    = cur->lptr;
+        }
+
+        // otherwise the current node is a match, but a larger one might exist on the right
+        else {
+            res     = pCur;
+            pCur    = cur->rptr;
+        }
+
+        pOffset = offset_below (cur, pOffset);
     }
 
     return res;
 }
 
 /**
- * @brief                   Finds the maximum value node in the entire tree without modifying it
+ * @brief                   Finds a node with value not more than the given value
+ *
+ * @param pVal              Value to find
  *
- * @return node_ptr_t       Pointer to the maximum value node in the entire tree
+ * @return AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t Link to node with a less or equal value (or null in the case of no match)
  */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::node_ptr_t
-AgAVLTree<val_t, mComp, mEquals>::find_max () const
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::last_smaller_equals_ptr (const val_t & pVal) const
 {
-    // return a pointer to the maximum value node in the root's subtree (entire tree)
-    return find_max (mRoot);
+    return last_smaller_equals_ptr (pVal, mRoot, {});
 }
 
 /**
- * @brief                   Attempts to insert a new node in the subtree of an existing node
+ * @brief                   Finds the nodes with values equal to each value of a range, making groups of searches side by side
  *
- * @param pCur              Pointer to node's link in whose subtree a new value must be inserted
- * @param pVal              Reference to value to be inserted
+ * @note                    A single search spends most of its time waiting for each node on its path to arrive from memory. Here, the searches
+ *                          of a group of LOOKUP_GROUP values go down the tree together one level at a time, and the next node of each search is
+ *                          prefetched when it is known, so that it has arrived by the time the search takes its next step (after the steps of
+ *                          all other searches of the group). This way many nodes are fetched from memory at the same time
  *
- * @return true             If insertion was successful (new node created)
- * @return false            If insertion failed
- */
-template <typename val_t, auto mComp, auto mEquals>
-bool
-AgAVLTree<val_t, mComp, mEquals>::insert (link_ptr_t pCur, const val_t & pVal)
-{
-    // if the current pointer points to null, this is the correct location to insert a node
-    if (*pCur == nullptr) {
-
-        node_ptr_t  ins;
-        ins     = new (std::nothrow) node_t {nullptr, nullptr, 0, pVal};
-
-        // failed insertion (new failed)
-        if (ins == nullptr) {
-            DBG_MODE (std::cout << "Could not allocate new node\n";)
-            return false;
-        }
+ * @tparam iter_t           Type of forward iterator to the values
+ * @tparam func_t           Type of function called with the result of each search
+ *
+ * @param pFirst            Iterator to the first value to be searched for
+ * @param pLast             Iterator past the last value to be searched for
+ * @param pReport           Function called with the link to the matching node (or null) for each value, in the order of the values
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+template <typename iter_t, typename func_t>
+void
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::find_batch_ptr (iter_t pFirst, iter_t pLast, func_t pReport) const
+{
+    static_assert (std::is_base_of<std::forward_iterator_tag, typename std::iterator_traits<iter_t>::iterator_category>::value,
+                   "Values must be given by forward iterators (a group of values is read side by side)");
 
-        // make the current node point to the newly created node
-        *pCur   = ins;
+    iter_t      keys[LOOKUP_GROUP];                 // values being searched for
+    link_t      cur[LOOKUP_GROUP];                  // next node of each search (null once the search is over)
+    offset_t    off[LOOKUP_GROUP];                  // offsets kept by the ancestors of the next node of each search
+    link_t      res[LOOKUP_GROUP];                  // result of each search
 
-        // return true to indicate successful insertion
-        return true;
-    }
+    node_ptr_t  ptr;
+    int32_t     cmp;
 
-    // found matching node, return false to indicate failed insertion
-    if (mEquals (pVal, (*pCur)->val)) {
-        return false;
-    }
+    while (pFirst != pLast) {
 
-    // if not equal, try to recursively insert
-    // if successful, recalculate depths and mBalance
+        size_t  cnt     {0};
+        size_t  active;
 
-    node_ptr_t  *whichPtr;
-    whichPtr    = (mComp (pVal, (*pCur)->val)) ? (&(*pCur)->lptr) : (&(*pCur)->rptr);
+        for (; cnt < LOOKUP_GROUP && pFirst != pLast; ++cnt, ++pFirst) {
+            keys[cnt]   = pFirst;
+            cur[cnt]    = mRoot;
+            off[cnt]    = {};
+            res[cnt]    = NIL;
+        }
 
-    if (insert (whichPtr, pVal)) {
+        // take one step of every unfinished search in turn, until all are over
+        do {
+            active = 0;
 
-        uint8_t ldep;                               // stores the left and
-        uint8_t rdep;                               // right depths of the current node
+            for (size_t i = 0; i < cnt; ++i) {
 
-        // uint8_t lldep;
-        // uint8_t rrdep;
+                if (cur[i] == NIL) {
+                    continue;
+                }
 
-        calc_height (*pCur, ldep, rdep);
+                ptr = node (cur[i]);
+                cmp = compare (*keys[i], value (ptr, off[i]));
 
-        // left side too heavy
-        if (ldep > (1 + rdep)) {
+                if (cmp == 0) {
+                    res[i]  = cur[i];
+                    cur[i]  = NIL;
+                    continue;
+                }
 
-            // check, in the direction of which grandhild, the insertion took place and balance towards that side
-            (mComp (pVal, (*pCur)->lptr->val)) ? (balance_ll (pCur)) : (balance_lr (pCur));
-            // calc_height ((*pCur)->lptr, lldep, rrdep);
-            // (lldep >= rrdep) ? (balance_ll (pCur)) : (balance_lr (pCur));
-            --ldep;
-        }
+                off[i] = offset_below (ptr, off[i]);
+                cur[i] = (cmp < 0) ? (ptr->lptr) : (ptr->rptr);
 
-        // right side too heavy
-        else if (rdep > (1 + ldep)) {
+                if (cur[i] != NIL) {
+                    AG_AVL_PREFETCH (node (cur[i]));
+                    ++active;
+                }
+            }
+        } while (active != 0);
 
-            // check, in the direction of which grandhild, the insertion took place and balance towards that side
-            (mComp (pVal, (*pCur)->rptr->val)) ? (balance_rl (pCur)) : (balance_rr (pCur));
-            // calc_height ((*pCur)->rptr, lldep, rrdep);
-            // (lldep >= rrdep) ? (balance_rl (pCur)) : (balance_rr (pCur));
-            --rdep;
+        for (size_t i = 0; i < cnt; ++i) {
+            pReport (res[i]);
         }
-
-        // re-assign heights after insertion
-        (*pCur)->height = max (ldep, rdep);
-
-        // return true (as recursive insertion was successful)
-        return true;
     }
-
-    return false;
 }
 
 /**
- * @brief                   Attempts to erase a node from the subtree of an existing node
+ * @brief                   Finds the nodes bounding the range of values equal to the given value in a single descent
  *
- * @param pCur              Pointer to node's link in whose subtree a new value must be inserted
- * @param pVal              Reference to value to be erased
+ * @param pVal              Value to find
  *
- * @return true             If erasing was successful (old node deleted)
- * @return false            If erasing failed
+ * @return std::pair<link_t, link_t> Links to the first node not less than pVal and the first node strictly greater than pVal (null if none)
  */
-template <typename val_t, auto mComp, auto mEquals>
-bool
-AgAVLTree<val_t, mComp, mEquals>::erase (link_ptr_t pCur, const val_t & pVal)
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+std::pair<typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t, typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t>
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::equal_range_ptr (const val_t & pVal) const
 {
-    // could not find matching node, return failed insertion
-    if (*pCur == nullptr) {
-        return false;
-    }
-
-    // found a matching node, try to remove it
-    if (mEquals (pVal, (*pCur)->val)) {
-
-        node_ptr_t nxt {nullptr};
-
-        // todo use inorder predeccessor if more efficient
-        // both children exist, find its inorder successor to move up
-        if ((*pCur)->lptr != nullptr && (*pCur)->rptr != nullptr) {
-
-            nxt       = find_min_move_up (&(*pCur)->rptr);
-
-            nxt->lptr = (*pCur)->lptr;
-            nxt->rptr = (*pCur)->rptr;
+    link_t      cur {mRoot};
+    link_t      hi  {NIL};                                                      // smallest node greater than the value found so far
+    node_ptr_t  ptr;
+    offset_t    off {};
+    int32_t     res;
+
+    while (cur != NIL) {
+
+        ptr = node (cur);
+        res = compare (pVal, value (ptr, off));
+        off = offset_below (ptr, off);
+
+        // the matching node starts the range, which ends at the next greater node (in its right subtree, or the best one above it)
+        if (res == 0) {
+            link_t  nxt {first_greater_strict_ptr (pVal, ptr->rptr, off)};
+            return {cur, (nxt != NIL) ? (nxt) : (hi)};
         }
 
-        // only left child exists, move it up and delete the current node
-        else if ((*pCur)->lptr != nullptr && (*pCur)->rptr == nullptr) {
-            nxt = (*pCur)->lptr;
+        // a greater node bounds the range, but a smaller bound might exist on the left
+        if (res < 0) {
+            hi  = cur;
+            cur = ptr->lptr;
         }
-
-        // only right child exists, make this the next node
-        else if ((*pCur)->lptr == nullptr && (*pCur)->rptr != nullptr) {
-            nxt = (*pCur)->rptr;
+        else {
+            cur = ptr->rptr;
         }
-
-        // delete the current node and move up the next node
-        delete *pCur;
-        *pCur = nxt;
     }
 
-    // if not mtching node, try to recursively erase (go left if current > supplied value else right), return false if failed
-    else if (!erase ((mComp (pVal, (*pCur)->val)) ? (&(*pCur)->lptr) : (&(*pCur)->rptr), pVal)) {
-        return false;
-    }
-
-    // if the current node (or some descendant) was removed, recalculate depths and rebalance if required
-    if (*pCur != nullptr) {
-
-        //stores the left and right depths of the current node
-        uint8_t ldep;
-        uint8_t rdep;
-
-        // stores the left and right depths of the current node's heavier child
-        uint8_t lldep;
-        uint8_t rrdep;
+    // no matching node, so the range is empty at the first greater node
+    return {hi, hi};
+}
 
-        calc_height (*pCur, ldep, rdep);
+/**
+ * @brief                   Finds the nodes bounding the range of values between two given values (inclusive of both)
+ *
+ * @note                    Both searches share the path from the root as long as the current node lies outside the range, and split up at the
+ *                          first node inside it (the lower bound continues to its left and the upper bound to its right)
+ *
+ * @param pLo               The smallest value to be included in the range
+ * @param pHi               The largest value to be included in the range
+ *
+ * @return std::pair<link_t, link_t> Links to the first node not less than pLo and the first node strictly greater than pHi (null if none)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+std::pair<typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t, typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t>
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::bounds_ptr (const val_t & pLo, const val_t & pHi) const
+{
+    // an inverted interval contains nothing
+    if (less (pHi, pLo)) {
+        return {NIL, NIL};
+    }
 
-        if (ldep > (1 + rdep)) {
+    link_t      cur {mRoot};
+    link_t      hi  {NIL};                                                      // smallest node greater than both values found so far
+    node_ptr_t  ptr;
+    offset_t    off {};
 
-            // in case the left child is too heavy, get heights of its children to check
-            calc_height ((*pCur)->lptr, lldep, rrdep);
+    while (cur != NIL) {
 
-            // balance from current node towards the heavier grandchild
-            (lldep >= rrdep) ? (balance_ll (pCur)) : (balance_lr (pCur));
+        ptr = node (cur);
 
-            // left side no more as heavy
-            --ldep;
+        // the current node is too small for both bounds, go right
+        if (less (value (ptr, off), pLo)) {
+            cur = ptr->rptr;
         }
 
-        else if (rdep > (1 + ldep)) {
+        // the current node is too big for both bounds (and the best candidate for both so far), go left
+        else if (less (pHi, value (ptr, off))) {
+            hi  = cur;
+            cur = ptr->lptr;
+        }
 
-            // in case the right child is too heavy, get heights of its children to check
-            calc_height ((*pCur)->rptr, lldep, rrdep);
+        // the current node lies in the range, so the paths to the two bounds diverge here
+        else {
+            off = offset_below (ptr, off);
 
-            // balance from current node towards the heavier grandchild
-            (lldep >= rrdep) ? (balance_rl (pCur)) : (balance_rr (pCur));
+            link_t  lo  {first_greater_equals_ptr (pLo, ptr->lptr, off)};
+            link_t  nxt {first_greater_strict_ptr (pHi, ptr->rptr, off)};
 
-            // right side no more as heavy
-            --rdep;
+            return {(lo != NIL) ? (lo) : (cur), (nxt != NIL) ? (nxt) : (hi)};
         }
 
-        // re-assign heights after to current node after balancing
-        (*pCur)->height = max (ldep, rdep);
+        off = offset_below (ptr, off);
     }
 
-    return true;
+    // no node lies in the range, which is empty at the first node greater than both values
+    return {hi, hi};
 }
 
 /**
- * @brief                   Clear the subtree of an entire node (including the node) by deleting
+ * @brief                   Returns the number of nodes in the subtree of a node
  *
- * @param pCur              Pointer to node whose subtree is to be deleted
+ * @note                    A counted node keeps the size of its subtree. Otherwise the subtree is walked without recursion (as in clear_subtree)
+ *
+ * @param pCur              Link to the root of the subtree (might be null)
+ *
+ * @return size_t           Number of nodes in the subtree (0 if it is empty)
  */
-template <typename val_t, auto mComp, auto mEquals>
-void
-AgAVLTree<val_t, mComp, mEquals>::clear (node_ptr_t pCur)
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+size_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::subtree_size (link_t pCur) const
 {
-    // if left child exists, recursively clear its subtree
-    if (pCur->lptr != nullptr) {
-        clear (pCur->lptr);
+    if constexpr (mCounted) {
+        return (pCur != NIL) ? (node (pCur)->cnt) : (0);
     }
+    else {
+        link_t      pending[MAX_DEPTH];             // right children still to be counted
+        size_t      top     {0};
+
+        size_t      res     {0};
+        node_ptr_t  cur;
+
+        while (pCur != NIL) {
+
+            cur = node (pCur);
+            ++res;
+
+            if (cur->lptr != NIL) {
+                if (cur->rptr != NIL) {
+                    pending[top++]  = cur->rptr;
+                }
+                pCur = cur->lptr;
+            }
+            else if (cur->rptr != NIL) {
+                pCur = cur->rptr;
+            }
+            else {
+                pCur = (top != 0) ? (pending[--top]) : (NIL);
+            }
+        }
 
-    // if right child exists, recursively clear its subtree
-    if (pCur->rptr != nullptr) {
-        clear (pCur->rptr);
+        return res;
     }
-
-    delete pCur;
 }
 
 /**
- * @brief                   Finds inorder successor of a node and replace the node with it
+ * @brief                   Counts the nodes with values strictly less than the given value in an existing node's subtree
  *
- * @param pCur              Pointer to node's link which is to be replaced
+ * @note                    Whenever the search goes right, the current node and its whole left subtree are smaller, and are counted at once
  *
- * @return AgAVLTree<val_t, mComp, mEquals>::node_ptr_t Inorder succesor of given node (after it's right child has been moved up)
+ * @param pVal              Value to compare with
+ * @param pCur              Link to node in whose subtree the nodes must be counted
+ * @param pOffset           Sum of the offsets kept by the ancestors of the node
+ *
+ * @return size_t           Number of nodes with a strictly less value
  */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::node_ptr_t
-AgAVLTree<val_t, mComp, mEquals>::find_min_move_up (link_ptr_t pCur)
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+size_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::count_less_strict (const val_t & pVal, link_t pCur, offset_t pOffset) const
 {
-    node_ptr_t res;
+    size_t      res {0};
+    node_ptr_t  cur;
 
-    // stores the left and right depths of the current node
-    uint8_t ldep;
-    uint8_t rdep;
+    while (pCur != NIL) {
 
-    // stores the left and right depths of the current node's right child
-    uint8_t lldep;
-    uint8_t rrdep;
+        cur = node (pCur);
 
-    if ((*pCur)->lptr != nullptr) {                                             // if the left child exists, then atleast one smaller node exists
-
-        res = find_min_move_up (&(*pCur)->lptr);                                // recursively go left
-        calc_height (*pCur, ldep, rdep);                                        // after left subtree is processed, recalculate height of current node
-
-        if (rdep > (1 + ldep)) {
-
-            // in case the right child is too heavy, get its childrens's heights and balance accordingly
-            calc_height ((*pCur)->rptr, lldep, rrdep);
-            (lldep > rrdep) ? (balance_rl (pCur)) : (balance_rr (pCur));
-            --rdep;
+        if (less (value (cur, pOffset), pVal)) {
+            res     += subtree_size (cur->lptr) + 1;
+            pCur    = cur->rptr;
+        }
+        else {
+            pCur    = cur->lptr;
         }
 
-        (*pCur)->height = max (ldep, rdep);
-
-    }
-
-    else {                                                                    // since no left child exsists. this is the smallest node in the current subtree
-
-        res  = *pCur;                                                           // make res point to the current node
-        *pCur = res->rptr;                                                      // replace the current node with its right child
+        pOffset = offset_below (cur, pOffset);
     }
 
     return res;
 }
 
 /**
- * @brief                   Finds inorder successor of the root
+ * @brief                   Counts the nodes with values not more than the given value in an existing node's subtree
  *
- * @return AgAVLTree<val_t, mComp, mEquals>::node_ptr_t Inorder succesor of the root
- */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::node_ptr_t
-AgAVLTree<val_t, mComp, mEquals>::find_min_move_up ()
-{
-    return find_min_move_up (&mRoot);
-}
-
-/**
- * @brief                   Finds a node with value equal to the given value
+ * @note                    Whenever the search goes right, the current node and its whole left subtree are not greater, and are counted at once
  *
- * @param pVal              Value to find
+ * @param pVal              Value to compare with
+ * @param pCur              Link to node in whose subtree the nodes must be counted
+ * @param pOffset           Sum of the offsets kept by the ancestors of the node
  *
- * @return AgAVLTree<val_t, mComp, mEquals>::node_ptr_t Pointer to the node with equal value (or nullptr in the case of no match)
+ * @return size_t           Number of nodes with a less or equal value
  */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::node_ptr_t
-AgAVLTree<val_t, mComp, mEquals>::find_ptr (const val_t & pVal) const
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+size_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::count_less_equals (const val_t & pVal, link_t pCur, offset_t pOffset) const
 {
-    node_ptr_t cur {mRoot};
+    size_t      res {0};
+    node_ptr_t  cur;
 
-    // repeat while a valid node is being pointed to (not crossed a leaf)
-    while (cur != nullptr) {
+    while (pCur != NIL) {
 
-        // if a matching node was found, return it
-        if (mEquals (pVal, cur->val)) {
-            return cur;
+        cur = node (pCur);
+
+        if (!less (pVal, value (cur, pOffset))) {
+            res     += subtree_size (cur->lptr) + 1;
+            pCur    = cur->rptr;
+        }
+        else {
+            pCur    = cur->lptr;
         }
 
-        // go left if current node is too big, else go right
-        cur = (mComp (pVal, cur->val)) ? (cur->lptr) : (cur->rptr);
+        pOffset = offset_below (cur, pOffset);
     }
 
-    // if no match was found, return null
-    return nullptr;
+    return res;
 }
 
 /**
- * @brief                   Finds a node with value strictly greater than the given value in an existing node's subtree
+ * @brief                   Counts the nodes with values not less than the given value in an existing node's subtree
  *
- * @param pVal              Value to find
- * @param pCur              Pointer to node in whose subtree the search must take place
+ * @note                    Whenever the search goes left, the current node and its whole right subtree are not smaller, and are counted at once
+ *
+ * @param pVal              Value to compare with
+ * @param pCur              Link to node in whose subtree the nodes must be counted
+ * @param pOffset           Sum of the offsets kept by the ancestors of the node
  *
- * @return AgAVLTree<val_t, mComp, mEquals>::node_ptr_t Pointer to node with a strictly greater value (or nullptr in the case of no match)
+ * @return size_t           Number of nodes with a greater or equal value
  */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::node_ptr_t
-AgAVLTree<val_t, mComp, mEquals>::first_greater_strict_ptr (const val_t & pVal, node_ptr_t pCur) const
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+size_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::count_greater_equals (const val_t & pVal, link_t pCur, offset_t pOffset) const
 {
-    // if reached beyond leaf (no valid node could be found in the current subtree), return null
-    if (pCur == nullptr) {
-        return nullptr;
-    }
+    size_t      res {0};
+    node_ptr_t  cur;
+
+    while (pCur != NIL) {
+
+        cur = node (pCur);
 
-    // if the current node <= supplied value, go right (current node's value is too small)
-    if (mComp (pCur->val, pVal) || mEquals (pCur->val, pVal)) {
-        return first_greater_strict_ptr (pVal, pCur->rptr);
+        if (!less (value (cur, pOffset), pVal)) {
+            res     += subtree_size (cur->rptr) + 1;
+            pCur    = cur->lptr;
+        }
+        else {
+            pCur    = cur->rptr;
+        }
+
+        pOffset = offset_below (cur, pOffset);
     }
 
-    node_ptr_t res  {first_greater_strict_ptr (pVal, pCur->lptr)};              // try going right recursively to find a better match than the current node
-    return (res != nullptr) ? (res) : (pCur);                                   // if a valid, larger-value node was found, use it otherwise use the current node
+    return res;
 }
 
 /**
- * @brief                   Finds a node with value strictly greater than the given value
+ * @brief                   Combines the summaries of the nodes with values not more than the given value in an existing node's subtree
  *
- * @param pVal              Value to find
+ * @note                    Whenever the search goes right, the current node and its whole left subtree are not greater, and their summaries
+ *                          are combined after those found so far (as they follow them)
  *
- * @return AgAVLTree<val_t, mComp, mEquals>::node_ptr_t Pointer to node with a strictly greater value (or nullptr in the case of no match)
- */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::node_ptr_t
-AgAVLTree<val_t, mComp, mEquals>::first_greater_strict_ptr (const val_t & pVal) const
-{
-    return first_greater_strict_ptr (pVal, mRoot);
-}
-
-/**
- * @brief                   Finds a node with value not less than the given value in an existing node's subtree
+ * @tparam policy_t         Augmentation policy of the tree
  *
- * @param pVal              Value to find
- * @param pCur              Pointer to node in whose subtree the search must take place
+ * @param pVal              Value to compare with
+ * @param pCur              Link to node in whose subtree the summaries must be combined
  *
- * @return AgAVLTree<val_t, mComp, mEquals>::node_ptr_t Pointer to node with a greater or equal value (or nullptr in the case of no match)
+ * @return policy_t::summary_t Combined summary of the nodes with a less or equal value
  */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::node_ptr_t
-AgAVLTree<val_t, mComp, mEquals>::first_greater_equals_ptr (const val_t & pVal, node_ptr_t pCur) const
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+template <typename policy_t>
+typename policy_t::summary_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::summary_less_equals (const val_t & pVal, link_t pCur) const
 {
-    // if reached beyond leaf (no valid node could be found in the current subtree), return null
-    if (pCur == nullptr) {
-        return nullptr;
-    }
+    typename policy_t::summary_t    res {policy_t::identity ()};
+    node_ptr_t                      cur;
+
+    while (pCur != NIL) {
 
-    // if the current node < supplied value, go right (current node's value is too small)
-    if (mComp (pCur->val, pVal)) {
-        return first_greater_equals_ptr (pVal, pCur->rptr);
+        cur = node (pCur);
+
+        if (!less (pVal, cur->val)) {
+            if (cur->lptr != NIL) {
+                res = policy_t::combine (res, node (cur->lptr)->sum);
+            }
+            res     = policy_t::combine (res, policy_t::of (cur->val));
+            pCur    = cur->rptr;
+        }
+        else {
+            pCur    = cur->lptr;
+        }
     }
 
-    node_ptr_t res  {first_greater_equals_ptr (pVal, pCur->lptr)};              // try going left recursively to find a better match than the current node
-    return (res != nullptr) ? (res) : (pCur);                                   // if a valid, smaller-value node was found, use it otherwise use the current node
+    return res;
 }
 
 /**
- * @brief                   Finds a node with value not less than the given value
+ * @brief                   Combines the summaries of the nodes with values not less than the given value in an existing node's subtree
  *
- * @param pVal              Value to find
+ * @note                    Whenever the search goes left, the current node and its whole right subtree are not smaller, and their summaries
+ *                          are combined before those found so far (as they precede them)
+ *
+ * @tparam policy_t         Augmentation policy of the tree
+ *
+ * @param pVal              Value to compare with
+ * @param pCur              Link to node in whose subtree the summaries must be combined
  *
- * @return AgAVLTree<val_t, mComp, mEquals>::node_ptr_t Pointer to node with a greater or equal value (or nullptr in the case of no match)
+ * @return policy_t::summary_t Combined summary of the nodes with a greater or equal value
  */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::node_ptr_t
-AgAVLTree<val_t, mComp, mEquals>::first_greater_equals_ptr (const val_t & pVal) const
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+template <typename policy_t>
+typename policy_t::summary_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::summary_greater_equals (const val_t & pVal, link_t pCur) const
 {
-    return first_greater_equals_ptr (pVal, mRoot);
+    typename policy_t::summary_t    res {policy_t::identity ()};
+    node_ptr_t                      cur;
+
+    while (pCur != NIL) {
+
+        cur = node (pCur);
+
+        if (!less (cur->val, pVal)) {
+            if (cur->rptr != NIL) {
+                res = policy_t::combine (node (cur->rptr)->sum, res);
+            }
+            res     = policy_t::combine (policy_t::of (cur->val), res);
+            pCur    = cur->lptr;
+        }
+        else {
+            pCur    = cur->rptr;
+        }
+    }
+
+    return res;
 }
 
 /**
- * @brief                   Finds a node with value strictly less than the given value in an existing node's subtree
+ * @brief                   Combines the summaries of the nodes with values strictly between two bounds, in order
  *
- * @param pVal              Value to find
- * @param pCur              Pointer to node in whose subtree the search must take place
+ * @note                    The highest node inside the bounds is found first (all others are in its subtree), and on each side of it whole
+ *                          subtrees are combined as in summary_greater_equals and summary_less_equals
+ *
+ * @param pLo               Pointer to the lower bound (null for no lower bound)
+ * @param pHi               Pointer to the upper bound (null for no upper bound)
  *
- * @return AgAVLTree<val_t, mComp, mEquals>::node_ptr_t Pointer to node with a strictly less value (or nullptr in the case of no match)
+ * @return auto             Combined summary of the nodes between the bounds (the identity of the augmentation policy if there are none)
  */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::node_ptr_t
-AgAVLTree<val_t, mComp, mEquals>::last_smaller_strict_ptr (const val_t & pVal, node_ptr_t pCur) const
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+auto
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::summary_between (const val_t * pLo, const val_t * pHi) const
 {
-    // if reached beyond leaf (no valid node could be found in the current subtree), return null
-    if (pCur == nullptr) {
-        return nullptr;
+    typename aug_t::summary_t   lres    {aug_t::identity ()};
+    typename aug_t::summary_t   rres    {aug_t::identity ()};
+    link_t                      cur     {mRoot};
+    node_ptr_t                  ptr;
+    node_ptr_t                  top;
+
+    while (cur != NIL) {
+
+        ptr = node (cur);
+
+        if (pLo != nullptr && !less (*pLo, ptr->val)) {
+            cur = ptr->rptr;
+        }
+        else if (pHi != nullptr && !less (ptr->val, *pHi)) {
+            cur = ptr->lptr;
+        }
+        else {
+            break;
+        }
+    }
+
+    // no node lies between the bounds
+    if (cur == NIL) {
+        return lres;
     }
+    top = ptr;
 
-    // if the supplied value <= current node, go left (current node's value is too big)
-    if (mComp (pVal, pCur->val) || mEquals (pVal, pCur->val)) {
-        return last_smaller_strict_ptr (pVal, pCur->lptr);
+    // the nodes of the left subtree greater than the lower bound (all of them if there is none)
+    for (cur = top->lptr; cur != NIL; ) {
+
+        ptr = node (cur);
+
+        if (pLo == nullptr) {
+            lres    = aug_t::combine (ptr->sum, lres);
+            break;
+        }
+        if (less (*pLo, ptr->val)) {
+            if (ptr->rptr != NIL) {
+                lres = aug_t::combine (node (ptr->rptr)->sum, lres);
+            }
+            lres    = aug_t::combine (aug_t::of (ptr->val), lres);
+            cur     = ptr->lptr;
+        }
+        else {
+            cur     = ptr->rptr;
+        }
+    }
+
+    // the nodes of the right subtree less than the upper bound (all of them if there is none)
+    for (cur = top->rptr; cur != NIL; ) {
+
+        ptr = node (cur);
+
+        if (pHi == nullptr) {
+            rres    = aug_t::combine (rres, ptr->sum);
+            break;
+        }
+        if (less (ptr->val, *pHi)) {
+            if (ptr->lptr != NIL) {
+                rres = aug_t::combine (rres, node (ptr->lptr)->sum);
+            }
+            rres    = aug_t::combine (rres, aug_t::of (ptr->val));
+            cur     = ptr->rptr;
+        }
+        else {
+            cur     = ptr->lptr;
+        }
     }
 
-    node_ptr_t res  {last_smaller_strict_ptr (pVal, pCur->rptr)};               // try going right recursively to find a better match than the current node
-    return (res != nullptr) ? (res) : (pCur);                                   // if a valid, larger-value node was found, use it otherwise use the current node
+    return aug_t::combine (aug_t::combine (lres, aug_t::of (top->val)), rres);
 }
 
 /**
- * @brief                   Finds a node with value strictly less than the given value
+ * @brief                   Finds the values present in only one of a subtree and the range of values of another tree between the same bounds
  *
- * @param pVal              Value to find
+ * @note                    See diff
  *
- * @return AgAVLTree<val_t, mComp, mEquals>::node_ptr_t Pointer to node with a strictly less value (or nullptr in the case of no match)
+ * @tparam out_here_t       Type of output iterator to which values present only in this tree are written
+ * @tparam out_there_t      Type of output iterator to which values present only in the other tree are written
+ *
+ * @param pCur              Link to the root of the subtree (holding all values of this tree strictly between the bounds)
+ * @param pLo               Pointer to the lower bound (null for no lower bound)
+ * @param pHi               Pointer to the upper bound (null for no upper bound)
+ * @param pOther            Tree to compare with
+ * @param pOnlyHere         Reference to the iterator where the next value present only in this tree is written
+ * @param pOnlyThere        Reference to the iterator where the next value present only in the other tree is written
  */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::node_ptr_t
-AgAVLTree<val_t, mComp, mEquals>::last_smaller_strict_ptr (const val_t & pVal) const
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+template <typename out_here_t, typename out_there_t>
+void
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::diff_range (link_t pCur, const val_t * pLo, const val_t * pHi, const AgAVLTree & pOther, out_here_t & pOnlyHere, out_there_t & pOnlyThere) const
 {
-    return last_smaller_strict_ptr (pVal, mRoot);
+    auto        there   {pOther.summary_between (pLo, pHi)};
+    node_ptr_t  cur;
+
+    // nothing lies between the bounds here, so everything there is missing
+    if (pCur == NIL) {
+        if (there == aug_t::identity ()) {
+            return;
+        }
+
+        link_t  ptr {(pLo == nullptr) ? (pOther.find_min ()) : (pOther.first_greater_strict_ptr (*pLo))};
+
+        for (; ptr != NIL && (pHi == nullptr || less (pOther.node (ptr)->val, *pHi)); ptr = pOther.next_ptr (ptr)) {
+            *pOnlyThere = pOther.node (ptr)->val;
+            ++pOnlyThere;
+        }
+        return;
+    }
+
+    cur = node (pCur);
+
+    // the same values are (almost certainly) on both sides
+    if (cur->sum == there) {
+        return;
+    }
+
+    diff_range (cur->lptr, pLo, &cur->val, pOther, pOnlyHere, pOnlyThere);
+
+    if (!pOther.exists (cur->val)) {
+        *pOnlyHere = cur->val;
+        ++pOnlyHere;
+    }
+
+    diff_range (cur->rptr, &cur->val, pHi, pOther, pOnlyHere, pOnlyThere);
 }
 
 /**
- * @brief                   Finds a node with value not more than the given value in an existing node's subtree
+ * @brief                   Draws a random offset into the total weight of the tree (which must be positive)
  *
- * @param pVal              Value to find
- * @param pCur              Pointer to node in whose subtree the search must take place
+ * @tparam rng_t            Type of the random number generator
  *
- * @return AgAVLTree<val_t, mComp, mEquals>::node_ptr_t Pointer to node with a less or equal value (or nullptr in the case of no match)
+ * @param pRng              Random number generator
+ *
+ * @return auto             Offset in [0, total weight), of the type of the summaries
  */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::node_ptr_t
-AgAVLTree<val_t, mComp, mEquals>::last_smaller_equals_ptr (const val_t & pVal, node_ptr_t pCur) const
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+template <typename rng_t>
+auto
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::random_weight (rng_t &pRng) const
 {
-    // if reached beyond leaf (no valid node could be found in current subtree), return null
-    if (pCur == nullptr) {
-        return nullptr;
-    }
+    using weight_t  = typename aug_t::summary_t;
 
-    // if the supplied value < current node, go left (current node's value is too big)
-    if (mComp (pVal, pCur->val)) {
-        return last_smaller_equals_ptr (pVal, pCur->lptr);
-    }
+    static_assert (std::is_arithmetic<weight_t>::value, "Weights must be numbers");
 
-    node_ptr_t res  {last_smaller_equals_ptr (pVal, pCur->rptr)};               // try going right recursively to find a better match than the current node
-    return (res != nullptr) ? (res) : (pCur);                                   // if a valid, larger-value node was found, use it otherwise use the current node
+    if constexpr (std::is_integral<weight_t>::value) {
+        return std::uniform_int_distribution<weight_t> {0, node (mRoot)->sum - 1} (pRng);
+    }
+    else {
+        return std::uniform_real_distribution<weight_t> {0, node (mRoot)->sum} (pRng);
+    }
 }
 
 /**
- * @brief                   Finds a node with value not more than the given value
+ * @brief                   Finds the elements at a sorted sequence of offsets (positions, or offsets into the total weight) in a single walk
  *
- * @param pVal              Value to find
+ * @note                    Each subtree is visited along with the run of offsets which fall inside it, which is split between its left subtree,
+ *                          its root and its right subtree by binary searches, and subtrees without any offsets are never visited. Offsets
+ *                          which are close together share the nodes on their paths, so m offsets take O(m log (n / m + 1)) time instead of
+ *                          O(m log n) (and the elements are written in order). Subtrees are kept on a fixed-size stack instead of recursing
+ *
+ * @tparam mWeighted        Whether the offsets are into the total weight (otherwise they are positions)
+ * @tparam key_t            Type of the offsets
+ * @tparam out_iter_t       Type of output iterator to which iterators of the tree are written
  *
- * @return AgAVLTree<val_t, mComp, mEquals>::node_ptr_t Pointer to node with a less or equal value (or nullptr in the case of no match)
+ * @param pKeys             The offsets (sorted, each less than the size or total weight of the tree)
+ * @param pOut              Iterator where the element at the first offset is written (followed by the others, in order)
+ *
+ * @return out_iter_t       Iterator past the last element
  */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::node_ptr_t
-AgAVLTree<val_t, mComp, mEquals>::last_smaller_equals_ptr (const val_t & pVal) const
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+template <bool mWeighted, typename key_t, typename out_iter_t>
+out_iter_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::sample_sorted (const std::vector<key_t> & pKeys, out_iter_t pOut) const
 {
-    return last_smaller_equals_ptr (pVal, mRoot);
+    struct pending_t {
+
+        link_t      cur;                            // root of the subtree (or the node to be written, if emit is set)
+        size_t      first;                          // index of the first offset in the subtree
+        size_t      last;                           // index past the last offset in the subtree
+        key_t       base;                           // offset at which the subtree starts
+        bool        emit;                           // whether the node is to be written for each offset, rather than its subtree split
+    };
+
+    // each subtree is replaced on the stack by (at most) its right subtree, its root and its left subtree
+    pending_t   pending[2 * MAX_DEPTH + 1];
+    size_t      top     {0};
+
+    node_ptr_t  ptr;
+    key_t       lw;                                 // measure (weight or size) of the left subtree
+    key_t       w;                                  // measure of the node itself
+
+    pending[top++] = {mRoot, 0, pKeys.size (), 0, false};
+
+    while (top != 0) {
+
+        pending_t   cur     {pending[--top]};
+
+        if (cur.emit) {
+            for (size_t i = cur.first; i < cur.last; ++i) {
+                *pOut = iterator (cur.cur, this);
+                ++pOut;
+            }
+            continue;
+        }
+
+        ptr = node (cur.cur);
+
+        if constexpr (mWeighted) {
+            lw  = (ptr->lptr != NIL) ? (node (ptr->lptr)->sum) : (0);
+            w   = aug_t::of (ptr->val);
+        }
+        else {
+            lw  = (key_t)subtree_size (ptr->lptr);
+            w   = 1;
+        }
+
+        // offsets left over by rounding (past either end of a subtree) fall on the node
+        auto        first   {pKeys.begin () + cur.first};
+        auto        last    {pKeys.begin () + cur.last};
+        auto        mid1    {(ptr->lptr != NIL) ? (std::lower_bound (first, last, (key_t)(cur.base + lw))) : (first)};
+        auto        mid2    {(ptr->rptr != NIL) ? (std::lower_bound (mid1, last, (key_t)(cur.base + lw + w))) : (last)};
+
+        size_t      i1      {(size_t)(mid1 - pKeys.begin ())};
+        size_t      i2      {(size_t)(mid2 - pKeys.begin ())};
+
+        if (i2 != cur.last) {
+            pending[top++] = {ptr->rptr, i2, cur.last, (key_t)(cur.base + lw + w), false};
+        }
+        if (i1 != i2) {
+            pending[top++] = {cur.cur, i1, i2, cur.base, true};
+        }
+        if (cur.first != i1) {
+            pending[top++] = {ptr->lptr, cur.first, i1, cur.base, false};
+        }
+    }
+
+    return pOut;
 }
 
 DBG_MODE (
-template <typename val_t, auto mComp, auto mEquals>
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
 bool
-AgAVLTree<val_t, mComp, mEquals>::check_balance (node_ptr_t cur)
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::check_balance (link_t pCur, int32_t & pHeight)
 {
+    int32_t lh      {0};
+    int32_t rh      {0};
+    bool    flag    {1};
 
-    uint8_t ldep {};
-    uint8_t rdep {};
-    bool    flag {1};
+    if (pCur == NIL) {
+        pHeight = 0;
+        return true;
+    }
+
+    node_ptr_t cur  {node (pCur)};
+
+    flag    = check_balance (cur->lptr, lh) && flag;
+    flag    = check_balance (cur->rptr, rh) && flag;
 
-    if (cur->lptr != nullptr) {
-        flag = check_balance (cur->lptr);
-        ldep = 1 + cur->lptr->height;
+    // the children must point back to this node
+    if (cur->lptr != NIL && get_parent (node (cur->lptr)) != pCur)
+        flag = false;
+    if (cur->rptr != NIL && get_parent (node (cur->rptr)) != pCur)
+        flag = false;
+
+    // the stored balance factor must match the actual heights, which must not differ by more than 1
+    if (rh - lh != get_balance (cur))
+        flag = false;
+    if (lh > 1 + rh || rh > 1 + lh)
+        flag = false;
+
+    // a counted node must hold the size of its subtree
+    if constexpr (mCounted) {
+        if (cur->cnt != 1 + subtree_size (cur->lptr) + subtree_size (cur->rptr))
+            flag = false;
     }
 
-    if (cur->rptr != nullptr) {
-        flag = check_balance (cur->rptr);
-        rdep = 1 + cur->rptr->height;
+    // a summarised node must hold the summary of its children and value (only checked if summaries can be compared)
+    if constexpr (SUMMARISED) {
+        if constexpr (std::is_arithmetic<typename aug_t::summary_t>::value) {
+            typename aug_t::summary_t   sum {cur->sum};
+
+            update (pCur);
+            if (sum != cur->sum)
+                flag = false;
+        }
     }
 
-    if (ldep > 1 + rdep)
-        return false;
-    if (rdep > 1 + ldep)
-        return false;
+    pHeight = 1 + max (lh, rh);
     return flag;
 }
 
-template <typename val_t, auto mComp, auto mEquals>
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
 bool
-AgAVLTree<val_t, mComp, mEquals>::check_balance ()
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::check_balance ()
 {
-    if (mRoot != nullptr) {
-        return check_balance (mRoot);
+    int32_t height;
+
+    if (mRoot != NIL) {
+        return (get_parent (node (mRoot)) == NIL) && check_balance (mRoot, height);
     }
     return 1;
 }
 
-template <typename val_t, auto mComp, auto mEquals>
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
 val_t
-AgAVLTree<val_t, mComp, mEquals>::get_root_val ()
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::get_root_val ()
 {
-    return mRoot->val;
+    return node (mRoot)->val;
 }
 )
 
 #include "AgAVLTree_iter.h"
+#include "AgAVLTree_pool.h"
+
+/**
+ * @brief                   AgAVLTree whose nodes are allocated from a std::pmr::memory_resource (such as a monotonic_buffer_resource or a per-request arena)
+ *
+ * @tparam val_t            Type of data held by tree instance
+ * @tparam mComp            Comparator to use while making less than comparisons (defaults to operator<)
+ * @tparam mEquals          Comparator to use while making equals comparisons (defaults to operator==)
+ */
+template <typename val_t, auto mComp = ag_avl_default_comp<val_t>, auto mEquals = ag_avl_default_equals<val_t>>
+using AgAVLTreePmr = AgAVLTree<val_t, mComp, mEquals, std::pmr::polymorphic_allocator<val_t>>;
+
+/**
+ * @brief                   AgAVLTree whose nodes are kept in a contiguous arena and linked by 32-bit indices instead of pointers (smaller nodes, fewer than 2^30 of them)
+ *
+ * @tparam val_t            Type of data held by tree instance
+ * @tparam mComp            Comparator to use while making less than comparisons (defaults to operator<)
+ * @tparam mEquals          Comparator to use while making equals comparisons (defaults to operator==)
+ * @tparam alloc_t          Allocator used to get memory for the arena of the tree (defaults to std::allocator)
+ */
+template <typename val_t, auto mComp = ag_avl_default_comp<val_t>, auto mEquals = ag_avl_default_equals<val_t>, typename alloc_t = std::allocator<val_t>>
+using AgAVLTreeCompact = AgAVLTree<val_t, mComp, mEquals, alloc_t, true>;
+
+/**
+ * @brief                   AgAVLTree whose nodes keep the sizes of their subtrees, to find elements by position (select) and count elements
+ *                          below a value (rank) or between two values (count_range) in O(log n)
+ *
+ * @tparam val_t            Type of data held by tree instance
+ * @tparam mComp            Comparator to use while making less than comparisons (defaults to operator<)
+ * @tparam mEquals          Comparator to use while making equals comparisons (defaults to operator==)
+ * @tparam alloc_t          Allocator used to get memory for the nodes of the tree (defaults to std::allocator)
+ * @tparam mCompact         Whether nodes are kept in a contiguous arena and linked by 32-bit indices instead of pointers (defaults to false)
+ */
+template <typename val_t, auto mComp = ag_avl_default_comp<val_t>, auto mEquals = ag_avl_default_equals<val_t>, typename alloc_t = std::allocator<val_t>, bool mCompact = false>
+using AgAVLTreeCounted = AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, true>;
+
+/**
+ * @brief                   AgAVLTree whose nodes keep a summary of the values in their subtrees (given by an augmentation policy), to aggregate
+ *                          the values between two values in O(log n)
+ *
+ * @tparam val_t            Type of data held by tree instance
+ * @tparam aug_t            Augmentation policy (such as AgAVLSum, AgAVLMin or AgAVLMax)
+ * @tparam mComp            Comparator to use while making less than comparisons (defaults to operator<)
+ * @tparam mEquals          Comparator to use while making equals comparisons (defaults to operator==)
+ * @tparam alloc_t          Allocator used to get memory for the nodes of the tree (defaults to std::allocator)
+ * @tparam mCompact         Whether nodes are kept in a contiguous arena and linked by 32-bit indices instead of pointers (defaults to false)
+ * @tparam mCounted         Whether each node also keeps the number of nodes in its subtree (defaults to false)
+ */
+template <typename val_t, typename aug_t, auto mComp = ag_avl_default_comp<val_t>, auto mEquals = ag_avl_default_equals<val_t>, typename alloc_t = std::allocator<val_t>, bool mCompact = false, bool mCounted = false>
+using AgAVLTreeAugmented = AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t>;
+
+/**
+ * @brief                   AgAVLTree of closed intervals (ordered by their starts) whose nodes keep the largest end in their subtrees, to find
+ *                          the intervals overlapping an interval (overlapping) or containing a point (stabbing)
+ *
+ * @tparam point_t          Type of the ends of the intervals
+ * @tparam alloc_t          Allocator used to get memory for the nodes of the tree (defaults to std::allocator)
+ * @tparam mCompact         Whether nodes are kept in a contiguous arena and linked by 32-bit indices instead of pointers (defaults to false)
+ */
+template <typename point_t, typename alloc_t = std::allocator<AgAVLInterval<point_t>>, bool mCompact = false>
+using AgAVLIntervalTree = AgAVLTreeAugmented<AgAVLInterval<point_t>, AgAVLMaxEnd<AgAVLInterval<point_t>, point_t>, ag_avl_default_comp<AgAVLInterval<point_t>>, ag_avl_default_equals<AgAVLInterval<point_t>>, alloc_t, mCompact>;
+
+/**
+ * @brief                   AgAVLTree whose nodes keep the number of nodes and the sum of the weights of the values in their subtrees, to pick
+ *                          elements at random in O(log n), either uniformly (sample) or in proportion to their weights (sample_weighted)
+ *
+ * @tparam val_t            Type of data held by tree instance
+ * @tparam weight_t         Type of the weights (an integral or floating point type)
+ * @tparam mWeight          Function giving the (non-negative) weight of a value
+ * @tparam mComp            Comparator to use while making less than comparisons (defaults to operator<)
+ * @tparam mEquals          Comparator to use while making equals comparisons (defaults to operator==)
+ * @tparam alloc_t          Allocator used to get memory for the nodes of the tree (defaults to std::allocator)
+ * @tparam mCompact         Whether nodes are kept in a contiguous arena and linked by 32-bit indices instead of pointers (defaults to false)
+ */
+template <typename val_t, typename weight_t, auto mWeight, auto mComp = ag_avl_default_comp<val_t>, auto mEquals = ag_avl_default_equals<val_t>, typename alloc_t = std::allocator<val_t>, bool mCompact = false>
+using AgAVLTreeWeighted = AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, true, AgAVLSum<val_t, weight_t, mWeight>>;
+
+/**
+ * @brief                   AgAVLTree of arithmetic values whose nodes keep offsets still to be added to the values below them, to add a constant to
+ *                          all values between two values in O(log n) (shift_range)
+ *
+ * @tparam val_t            Type of data held by tree instance (an integral or floating point type)
+ * @tparam mComp            Comparator to use while making less than comparisons (defaults to operator<)
+ * @tparam mEquals          Comparator to use while making equals comparisons (defaults to operator==)
+ * @tparam alloc_t          Allocator used to get memory for the nodes of the tree (defaults to std::allocator)
+ * @tparam mCompact         Whether nodes are kept in a contiguous arena and linked by 32-bit indices instead of pointers (defaults to false)
+ * @tparam mCounted         Whether each node also keeps the number of nodes in its subtree (defaults to false)
+ */
+template <typename val_t, auto mComp = ag_avl_default_comp<val_t>, auto mEquals = ag_avl_default_equals<val_t>, typename alloc_t = std::allocator<val_t>, bool mCompact = false, bool mCounted = false>
+using AgAVLTreeShiftable = AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, void, true>;
+
+/**
+ * @brief                   AgAVLTree whose nodes keep a hash of the set of values in their subtrees, to fingerprint the tree in O(1) and find the
+ *                          differences between two trees by going down only into the ranges where their hashes disagree (diff)
+ *
+ * @tparam val_t            Type of data held by tree instance
+ * @tparam mHash            Function giving the hash of a value (defaults to std::hash)
+ * @tparam mComp            Comparator to use while making less than comparisons (defaults to operator<)
+ * @tparam mEquals          Comparator to use while making equals comparisons (defaults to operator==)
+ * @tparam alloc_t          Allocator used to get memory for the nodes of the tree (defaults to std::allocator)
+ * @tparam mCompact         Whether nodes are kept in a contiguous arena and linked by 32-bit indices instead of pointers (defaults to false)
+ * @tparam mCounted         Whether each node also keeps the number of nodes in its subtree (defaults to false)
+ */
+template <typename val_t, auto mHash = ag_avl_default_hash<val_t>, auto mComp = ag_avl_default_comp<val_t>, auto mEquals = ag_avl_default_equals<val_t>, typename alloc_t = std::allocator<val_t>, bool mCompact = false, bool mCounted = false>
+using AgAVLTreeHashed = AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, AgAVLHash<val_t, mHash>>;
 
 #undef DBG_MODE
 #undef NO_DBG_MODE
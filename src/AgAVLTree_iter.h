@@ -7,40 +7,40 @@
 /**
  * @brief                   Construct a new avl tree::AVL<val t>::iterator::iterator object
  *
- * @note                    if pPtr is nullptr, then the iterator is said to be pointing to pTreePtr->end() (the logical element after the end in the forward direction)
+ * @note                    if pPtr is null, then the iterator is said to be pointing to pTreePtr->end() (the logical element after the end in the forward direction)
  *
- * @param pPtr              The pointer to encapsulate (points to node or nullptr)
+ * @param pPtr              The link to encapsulate (refers to node or is null)
  * @param PTreeptr          The point to the tree which contains the node
  */
-template <typename val_t, auto mComp, auto mEquals>
-AgAVLTree<val_t, mComp, mEquals>::iterator::iterator (node_ptr_t pPtr, tree_ptr_t pTreePtr) noexcept :
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator::iterator (link_t pPtr, tree_ptr_t pTreePtr) noexcept :
     mPtr {pPtr}, mTreePtr {pTreePtr}
 {}
 
 /**
  * @brief                   Dereferences and returns the value held by the encapsulated node
  *
- * @return AgAVLTree<val_t, mComp, mEquals>::iterator::ref_t Data held by tree node the iterator points to
+ * @return AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator::ref_t Data held by tree node the iterator points to
  */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::iterator::ref_t
-AgAVLTree<val_t, mComp, mEquals>::iterator::operator* () const
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator::ref_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator::operator* () const
 {
-    return mPtr->val;
+    return mTreePtr->iter_value (mPtr, *this);
 }
 
 /**
  * @brief                   Prefix increment operator (incremements the pointer to the next inorder node)
  *
- * @return AgAVLTree<val_t, mComp, mEquals>::iterator Incremented Iterator
+ * @return AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator Incremented Iterator
  */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::iterator
-AgAVLTree<val_t, mComp, mEquals>::iterator::operator++ ()
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator::operator++ ()
 {
     // if not pointing to end(), then get the next greater node
-    if (mPtr != nullptr) {
-        mPtr = mTreePtr->first_greater_strict_ptr (mPtr->val);                  // if a valid node is pointed to (not end()), then get the next greater node
+    if (mPtr != NIL) {
+        mPtr = mTreePtr->iter_next (mPtr, *this);                               // if a valid node is pointed to (not end()), then get the next greater node
     }
     return *this;
 }
@@ -48,13 +48,13 @@ AgAVLTree<val_t, mComp, mEquals>::iterator::operator++ ()
 /**
  * @brief                   Suffix increment operator (incremements the pointer to the next inorder node)
  *
- * @return AgAVLTree<val_t, mComp, mEquals>::iterator Incremented Iterator
+ * @return AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator Incremented Iterator
  */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::iterator
-AgAVLTree<val_t, mComp, mEquals>::iterator::operator++ (int)
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator::operator++ (int)
 {
-    iterator cpy (this->mPtr, this->mTreePtr);                                  // create a copy of the current iterator,
+    iterator cpy {*this};                                                       // create a copy of the current iterator,
     ++(*this);                                                                  // increment it,
     return cpy;                                                                 // and finally return the copy
 }
@@ -62,18 +62,19 @@ AgAVLTree<val_t, mComp, mEquals>::iterator::operator++ (int)
 /**
  * @brief                   Prefix decrement operator (incremements the pointer to the next inorder node)
  *
- * @return AgAVLTree<val_t, mComp, mEquals>::iterator Decremented Iterator
+ * @return AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator Decremented Iterator
  */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::iterator
-AgAVLTree<val_t, mComp, mEquals>::iterator::operator-- ()
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator::operator-- ()
 {
-    if (mPtr != nullptr) {                                                      // if the node being being pointed to is valid,
-        node_ptr_t t    {mTreePtr->last_smaller_strict_ptr (mPtr->val)};        // try to get the next smaller node
-        mPtr            = (t != nullptr) ? (t) : (mPtr);                        // if such a node exists, use it
+    if (mPtr != NIL) {                                                      // if the node being being pointed to is valid,
+        link_t t        {mTreePtr->iter_prev (mPtr, *this)};                    // try to get the next smaller node
+        mPtr            = (t != NIL) ? (t) : (mPtr);                            // if such a node exists, use it
     }
     else {                                                                    // else, if the current node is not valid (instance points to end())
         mPtr = mTreePtr->find_max ();                                           // then get the greateest (last) element of the tree
+        static_cast<iter_extra_t &> (*this) = {};                               // whose value is not known yet
     }
 
     return *this;
@@ -82,13 +83,13 @@ AgAVLTree<val_t, mComp, mEquals>::iterator::operator-- ()
 /**
  * @brief                   Suffix decrement operator (incremements the pointer to the next inorder node)
  *
- * @return AgAVLTree<val_t, mComp, mEquals>::iterator Decremented Iterator
+ * @return AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator Decremented Iterator
  */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::iterator
-AgAVLTree<val_t, mComp, mEquals>::iterator::operator-- (int)
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator::operator-- (int)
 {
-    iterator cpy (this->mPtr, this->mTreePtr);                                  // create a copy of the current iterator,
+    iterator cpy {*this};                                                       // create a copy of the current iterator,
     --(*this);                                                                  // decrement it,
     return cpy;                                                                 // and finally return the copy
 }
@@ -101,9 +102,9 @@ AgAVLTree<val_t, mComp, mEquals>::iterator::operator-- (int)
  * @return true             If both iterators point to the same node of the same tree
  * @return false            If both iterators point to different nodes or belong to different trees
  */
-template <typename val_t, auto mComp, auto mEquals>
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
 bool
-AgAVLTree<val_t, mComp, mEquals>::iterator::operator== (const AgAVLTree<val_t, mComp, mEquals>::iterator & pOther) const
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator::operator== (const AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator & pOther) const
 {
     return (mPtr == pOther.mPtr) && (mTreePtr == pOther.mTreePtr);
 }
@@ -116,9 +117,9 @@ AgAVLTree<val_t, mComp, mEquals>::iterator::operator== (const AgAVLTree<val_t, m
  * @return true             If both iterators point to the different nodes or belong to different trees
  * @return false            If both iterators point to the same node in the same tree
  */
-template <typename val_t, auto mComp, auto mEquals>
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
 bool
-AgAVLTree<val_t, mComp, mEquals>::iterator::operator!= (const AgAVLTree<val_t, mComp, mEquals>::iterator & pOther) const
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator::operator!= (const AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator & pOther) const
 {
     return (mPtr != pOther.mPtr) || (mTreePtr != pOther.mTreePtr);
 }
@@ -126,40 +127,40 @@ AgAVLTree<val_t, mComp, mEquals>::iterator::operator!= (const AgAVLTree<val_t, m
 /**
  * @brief                   Construct a new avl tree::AVL<val t>::reverse_iterator instance
  *
- * @note                    if pPtr is nullptr, then the iterator is said to be pointing to pTreePtr->rend() (the logical element after the end in the reverse direction)
+ * @note                    if pPtr is null, then the iterator is said to be pointing to pTreePtr->rend() (the logical element after the end in the reverse direction)
  *
- * @param pPtr              The pointer to encapsulate (points to node or nullptr)
+ * @param pPtr              The link to encapsulate (refers to node or is null)
  * @param pTreePtr          The point to the tree which contains the node
  */
-template <typename val_t, auto mComp, auto mEquals>
-AgAVLTree<val_t, mComp, mEquals>::reverse_iterator::reverse_iterator (node_ptr_t pPtr, tree_ptr_t pTreePtr) noexcept :
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::reverse_iterator::reverse_iterator (link_t pPtr, tree_ptr_t pTreePtr) noexcept :
     mPtr {pPtr}, mTreePtr {pTreePtr}
 {}
 
 /**
  * @brief                   Dereferences and returns the value held by the encapsulated node
  *
- * @return AgAVLTree<val_t, mComp, mEquals>::reverse_iterator::ref_t Data held by tree node the iterator points to
+ * @return AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::reverse_iterator::ref_t Data held by tree node the iterator points to
  */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::reverse_iterator::ref_t
-AgAVLTree<val_t, mComp, mEquals>::reverse_iterator::operator* () const
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::reverse_iterator::ref_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::reverse_iterator::operator* () const
 {
-    return mPtr->val;
+    return mTreePtr->iter_value (mPtr, *this);
 }
 
 /**
  * @brief                   Prefix increment operator (incremements the pointer to the next inorder node)
  *
- * @return AgAVLTree<val_t, mComp, mEquals>::reverse_iterator Incremented Iterator
+ * @return AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::reverse_iterator Incremented Iterator
  */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::reverse_iterator
-AgAVLTree<val_t, mComp, mEquals>::reverse_iterator::operator++ ()
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::reverse_iterator
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::reverse_iterator::operator++ ()
 {
-    // if not pointing to rend(), then get the next greater node
-    if (mPtr != nullptr) {
-        mPtr = mTreePtr->last_smaller_strict_ptr (mPtr->val);
+    // if not pointing to rend(), then get the next smaller node
+    if (mPtr != NIL) {
+        mPtr = mTreePtr->iter_prev (mPtr, *this);
     }
     return *this;
 }
@@ -167,13 +168,13 @@ AgAVLTree<val_t, mComp, mEquals>::reverse_iterator::operator++ ()
 /**
  * @brief                   Suffix increment operator (incremements the pointer to the next inorder node)
  *
- * @return AgAVLTree<val_t, mComp, mEquals>::reverse_iterator Incremented Iterator
+ * @return AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::reverse_iterator Incremented Iterator
  */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::reverse_iterator
-AgAVLTree<val_t, mComp, mEquals>::reverse_iterator::operator++ (int)
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::reverse_iterator
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::reverse_iterator::operator++ (int)
 {
-    reverse_iterator cpy (this->mPtr, this->mTreePtr);                          // create a copy of the current iterator,
+    reverse_iterator cpy {*this};                                               // create a copy of the current iterator,
     ++(*this);                                                                  // increment it,
     return cpy;                                                                 // and finally return the copy
 }
@@ -181,18 +182,19 @@ AgAVLTree<val_t, mComp, mEquals>::reverse_iterator::operator++ (int)
 /**
  * @brief                   Prefix decrement operator (incremements the pointer to the next inorder node)
  *
- * @return AgAVLTree<val_t, mComp, mEquals>::iterator Decremented Iterator
+ * @return AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::iterator Decremented Iterator
  */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::reverse_iterator
-AgAVLTree<val_t, mComp, mEquals>::reverse_iterator::operator-- ()
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::reverse_iterator
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::reverse_iterator::operator-- ()
 {
-    if (mPtr != nullptr) {                                                      // if the node being being pointed to is valid,
-        node_ptr_t t    {mTreePtr->first_greater_strict_ptr (mPtr->val)};       // try to get the next greater node
-        mPtr            = (t != nullptr) ? (t) : (mPtr);                        // if such a node exists, use it
+    if (mPtr != NIL) {                                                      // if the node being being pointed to is valid,
+        link_t t        {mTreePtr->iter_next (mPtr, *this)};                    // try to get the next greater node
+        mPtr            = (t != NIL) ? (t) : (mPtr);                            // if such a node exists, use it
     }
     else {                                                                      // else, if the current node is not valid (instance points to rend())
         mPtr = mTreePtr->find_min ();                                           // then get the smallest (first) element of the tree
+        static_cast<iter_extra_t &> (*this) = {};                               // whose value is not known yet
     }
     return *this;
 }
@@ -200,13 +202,13 @@ AgAVLTree<val_t, mComp, mEquals>::reverse_iterator::operator-- ()
 /**
  * @brief                   Suffix decrement operator (incremements the pointer to the next inorder node)
  *
- * @return AgAVLTree<val_t, mComp, mEquals>::reverse_iterator Decremented Iterator
+ * @return AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::reverse_iterator Decremented Iterator
  */
-template <typename val_t, auto mComp, auto mEquals>
-typename AgAVLTree<val_t, mComp, mEquals>::reverse_iterator
-AgAVLTree<val_t, mComp, mEquals>::reverse_iterator::operator-- (int)
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::reverse_iterator
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::reverse_iterator::operator-- (int)
 {
-    reverse_iterator cpy (this->mPtr, this->mTreePtr);                          // create a copy of the current iterator,
+    reverse_iterator cpy {*this};                                               // create a copy of the current iterator,
     --(*this);                                                                  // decrement it,
     return cpy;                                                                 // and finally return the copy
 }
@@ -219,9 +221,9 @@ AgAVLTree<val_t, mComp, mEquals>::reverse_iterator::operator-- (int)
  * @return true             If both iterators point to the same node in the same tree
  * @return false            If both iterators point to the same nodes of belong to different trees
  */
-template <typename val_t, auto mComp, auto mEquals>
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
 bool
-AgAVLTree<val_t, mComp, mEquals>::reverse_iterator::operator== (const AgAVLTree<val_t, mComp, mEquals>::reverse_iterator & pOther) const
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::reverse_iterator::operator== (const AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::reverse_iterator & pOther) const
 {
     return (mPtr == pOther.mPtr) && (mTreePtr == pOther.mTreePtr);
 }
@@ -234,9 +236,9 @@ AgAVLTree<val_t, mComp, mEquals>::reverse_iterator::operator== (const AgAVLTree<
  * @return true             If both iterators point to the different nodes or belong to different trees
  * @return false            If both iterators point to the same node in the same tree
  */
-template <typename val_t, auto mComp, auto mEquals>
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
 bool
-AgAVLTree<val_t, mComp, mEquals>::reverse_iterator::operator!= (const AgAVLTree<val_t, mComp, mEquals>::reverse_iterator & pOther) const
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::reverse_iterator::operator!= (const AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::reverse_iterator & pOther) const
 {
     return (mPtr != pOther.mPtr) || (mTreePtr != pOther.mTreePtr);
 }
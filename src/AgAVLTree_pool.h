@@ -0,0 +1,557 @@
+/**
+ * @file                    AgAVLTree_pool.h
+ * @author                  Aditya Agarwal (aditya,agarwal@dumblebots.com)
+ * @brief                   Implementation of the pool from which AgAVLTree allocates its nodes
+ *
+ * @note                    Nodes are carved out of fixed-size chunks and freed nodes are kept on an intrusive free list,
+ *                          so that insertions after erasures reuse memory instead of calling the global allocator.
+ *                          Chunks are obtained from the allocator of the tree. Defining AG_AVL_NO_POOL makes the pool fall back to
+ *                          allocating every node individually from the allocator.
+ *                          In compact mode, all the nodes are instead kept in a single contiguous arena and are named by their
+ *                          32-bit position in it (position 0 is never handed out, as it is used as the null link). When the arena is full,
+ *                          the nodes are moved to one twice as large (their positions, and hence all links, stay the same).
+ *                          Every tree has a pool of its own. A tree split off from another gets a new pool, and the chunks holding the nodes
+ *                          handed to it become a group which both pools keep alive (with an atomic count of the pools using it), so that the
+ *                          two trees can be changed and destroyed independently of each other. Each pool only ever puts slots on its own free
+ *                          list, and a group is released along with the older groups it keeps alive once no pool uses it anymore
+ */
+
+/**
+ * @brief                   Construct a new, empty node pool
+ *
+ * @param pAlloc            Allocator from which chunks (or single nodes) are to be obtained
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::node_pool_t::node_pool_t (const alloc_t & pAlloc) noexcept :
+    mAlloc {pAlloc}
+{}
+
+/**
+ * @brief                   Move construct a new node pool (takes over all the chunks of the other pool)
+ *
+ * @param pOther            Pool to move from (left without any chunks)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::node_pool_t::node_pool_t (node_pool_t && pOther) noexcept :
+    mAlloc {std::move (pOther.mAlloc)}, mChunks {pOther.mChunks}, mArena {pOther.mArena}, mCap {pOther.mCap}, mUsed {pOther.mUsed}, mFree {pOther.mFree}, mShared {pOther.mShared}
+{
+    pOther.mChunks  = nullptr;
+    pOther.mArena   = nullptr;
+    pOther.mCap     = 0;
+    pOther.mUsed    = (mCompact) ? (0) : (CHUNK_NODES);
+    pOther.mFree    = NIL;
+    pOther.mShared  = nullptr;
+}
+
+/**
+ * @brief                   Destroy the node pool, releasing all of its chunks
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::node_pool_t::~node_pool_t ()
+{
+    release ();
+}
+
+/**
+ * @brief                   Moves all the slots of the arena into a new one, at least twice as large (compact mode only)
+ *
+ * @note                    Every node keeps its position, so links between nodes remain valid (but pointers to values do not)
+ *
+ * @param pMinCap           Minimum number of slots the new arena must have
+ *
+ * @return true             If the arena was grown
+ * @return false            If memory could not be allocated, the arena can not grow any further, or a value could not be moved
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+bool
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::node_pool_t::grow_arena (size_t pMinCap)
+{
+    slot_alloc_t    slotAlloc   (mAlloc);
+    mask_alloc_t    maskAlloc   (mAlloc);
+
+    node_slot_t     *arena;
+    uint64_t        *freeMask   {nullptr};
+    size_t          cap;
+    size_t          words       {(mUsed + 63) / 64};
+
+    if (mCap == MAX_NODES || pMinCap > MAX_NODES) {
+        return false;
+    }
+    cap     = (mCap == 0) ? (CHUNK_NODES) : ((mCap < MAX_NODES / 2) ? (2 * mCap) : (MAX_NODES));
+    cap     = (cap < pMinCap) ? (pMinCap) : (cap);
+
+    // failure to allocate is reported by returning false (irrespective of whether the allocator throws)
+    try {
+        arena   = std::allocator_traits<slot_alloc_t>::allocate (slotAlloc, cap);
+    }
+    catch (...) {
+        return false;
+    }
+
+    if constexpr (std::is_trivially_copyable<val_t>::value) {
+
+        // slots holding trivial values (and freed slots) can be copied as they are
+        if (mUsed != 0) {
+            std::memcpy (arena, mArena, mUsed * sizeof (node_slot_t));
+        }
+    }
+    else {
+
+        // mark which of the handed out slots are on the free list (all others hold nodes which must be moved)
+        try {
+            freeMask    = std::allocator_traits<mask_alloc_t>::allocate (maskAlloc, words);
+        }
+        catch (...) {
+            std::allocator_traits<slot_alloc_t>::deallocate (slotAlloc, arena, cap);
+            return false;
+        }
+        for (size_t i = 0; i < words; ++i) {
+            freeMask[i] = 0;
+        }
+        for (link_t cur = mFree; cur != NIL; cur = mArena[cur].nxt) {
+            freeMask[cur / 64] |= (uint64_t)1 << (cur % 64);
+        }
+
+        size_t  i       {1};
+
+        try {
+            for (; i < mUsed; ++i) {
+                if (freeMask[i / 64] & ((uint64_t)1 << (i % 64))) {
+                    arena[i].nxt    = mArena[i].nxt;
+                }
+                else {
+                    new (&arena[i]) node_t (std::move_if_noexcept (*reinterpret_cast<node_ptr_t> (&mArena[i])));
+                }
+            }
+        }
+        catch (...) {
+
+            // undo the partial move (the old arena is still intact) and report failure
+            while (--i > 0) {
+                if (!(freeMask[i / 64] & ((uint64_t)1 << (i % 64)))) {
+                    reinterpret_cast<node_ptr_t> (&arena[i])->~node_t ();
+                }
+            }
+            std::allocator_traits<mask_alloc_t>::deallocate (maskAlloc, freeMask, words);
+            std::allocator_traits<slot_alloc_t>::deallocate (slotAlloc, arena, cap);
+            return false;
+        }
+
+        // the moved-from nodes can now be destroyed
+        for (i = 1; i < mUsed; ++i) {
+            if (!(freeMask[i / 64] & ((uint64_t)1 << (i % 64)))) {
+                reinterpret_cast<node_ptr_t> (&mArena[i])->~node_t ();
+            }
+        }
+        std::allocator_traits<mask_alloc_t>::deallocate (maskAlloc, freeMask, words);
+    }
+
+    if (mArena != nullptr) {
+        std::allocator_traits<slot_alloc_t>::deallocate (slotAlloc, mArena, mCap);
+    }
+
+    mArena  = arena;
+    mCap    = cap;
+    mUsed   = (mUsed == 0) ? (1) : (mUsed);                                    // position 0 is the null link, so it is never handed out
+
+    return true;
+}
+
+/**
+ * @brief                   Allocates (but does not construct) storage for a single node
+ *
+ * @note                    In compact mode, this might move all the nodes to a larger arena
+ *
+ * @return link_t           Link to storage for a node (null if memory could not be allocated)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::link_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::node_pool_t::allocate ()
+{
+    link_t  res;
+
+    // prefer reusing the most recently freed slot (it is the most likely to still be in the cache)
+    if (mFree != NIL) {
+        res     = mFree;
+        mFree   = reinterpret_cast<node_slot_t *> (get (res))->nxt;
+        return res;
+    }
+
+    if constexpr (mCompact) {
+
+        // if the arena has been used up, move everything to a larger one
+        if (mUsed == mCap && !grow_arena (0)) {
+            return NIL;
+        }
+
+        // hand out the next unused slot of the arena
+        return static_cast<link_t> (mUsed++);
+    }
+    else {
+
+#ifdef AG_AVL_NO_POOL
+        slot_alloc_t    slotAlloc   (mAlloc);
+
+        // failure to allocate is reported by returning nullptr (irrespective of whether the allocator throws)
+        try {
+            return reinterpret_cast<node_ptr_t> (std::allocator_traits<slot_alloc_t>::allocate (slotAlloc, 1));
+        }
+        catch (...) {
+            return nullptr;
+        }
+#else
+        // if the most recent chunk has been used up, get a new one and put it at the head of the list of chunks
+        if (mUsed == CHUNK_NODES) {
+
+            chunk_alloc_t   chunkAlloc  (mAlloc);
+            chunk_t         *chunk;
+
+            // failure to allocate is reported by returning nullptr (irrespective of whether the allocator throws)
+            try {
+                chunk   = std::allocator_traits<chunk_alloc_t>::allocate (chunkAlloc, 1);
+            }
+            catch (...) {
+                return nullptr;
+            }
+
+            chunk->nxt  = mChunks;
+            mChunks     = chunk;
+            mUsed       = 0;
+        }
+
+        // hand out the next unused slot of the most recent chunk
+        return reinterpret_cast<node_ptr_t> (&mChunks->slots[mUsed++]);
+#endif
+    }
+}
+
+/**
+ * @brief                   Destroys a node and gives its storage back to the pool
+ *
+ * @param pLink             Link to the node to be destroyed
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+void
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::node_pool_t::deallocate (link_t pLink)
+{
+    node_slot_t *slot   {reinterpret_cast<node_slot_t *> (get (pLink))};
+
+    get (pLink)->~node_t ();
+
+#ifdef AG_AVL_NO_POOL
+    if constexpr (!mCompact) {
+        slot_alloc_t    slotAlloc   (mAlloc);
+        std::allocator_traits<slot_alloc_t>::deallocate (slotAlloc, slot, 1);
+        return;
+    }
+#endif
+
+    // push the slot onto the free list, so that it is reused by the next allocation
+    slot->nxt           = mFree;
+    mFree               = pLink;
+}
+
+/**
+ * @brief                   Makes sure that a number of nodes can be allocated without moving any of the existing nodes
+ *
+ * @note                    Only nodes in compact mode are ever moved, so this does nothing otherwise
+ *
+ * @param pCount            Number of nodes which are going to be allocated
+ *
+ * @return true             If the nodes can be allocated without moving any node
+ * @return false            If memory for the nodes could not be allocated
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+bool
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::node_pool_t::reserve (size_t pCount)
+{
+    if constexpr (mCompact) {
+
+        // a single node can always be allocated if some slot has been freed (the free list is not counted otherwise)
+        if (pCount == 1 && mFree != NIL) {
+            return true;
+        }
+        if (mCap - mUsed < pCount) {
+            return grow_arena (((mUsed == 0) ? (1) : (mUsed)) + pCount);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief                   Releases all chunks of the pool, and stops using the groups of chunks it shares with other pools
+ *
+ * @note                    All nodes allocated from the pool must have been destroyed before calling this (unless their values need no
+ *                          destructor, in which case the nodes in shared chunks are simply left there)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+void
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::node_pool_t::release ()
+{
+    chunk_alloc_t   chunkAlloc  (mAlloc);
+    slot_alloc_t    slotAlloc   (mAlloc);
+    chunk_t         *nxt;
+
+    while (mChunks != nullptr) {
+        nxt     = mChunks->nxt;
+        std::allocator_traits<chunk_alloc_t>::deallocate (chunkAlloc, mChunks, 1);
+        mChunks = nxt;
+    }
+
+    if (mArena != nullptr) {
+        std::allocator_traits<slot_alloc_t>::deallocate (slotAlloc, mArena, mCap);
+    }
+
+    mArena  = nullptr;
+    mCap    = 0;
+    mFree   = NIL;
+    mUsed   = (mCompact) ? (0) : (CHUNK_NODES);
+
+    drop_shared ();
+}
+
+/**
+ * @brief                   Stops using the newest group of chunks shared with other pools, releasing it (and then each older group it kept
+ *                          alive, in turn) if no other pool uses it
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+void
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::node_pool_t::drop_shared ()
+{
+    chunk_alloc_t   chunkAlloc  (mAlloc);
+    chunk_t         *group      {mShared};
+    chunk_t         *below;
+    chunk_t         *nxt;
+
+    // the last pool to stop using a group releases it (the count is decremented with acquire-release ordering, so that all writes
+    // made to its nodes by other pools happen before the release)
+    while (group != nullptr && group->refs.fetch_sub (1, std::memory_order_acq_rel) == 1) {
+
+        below   = group->below;
+
+        while (group != nullptr) {
+            nxt     = group->nxt;
+            std::allocator_traits<chunk_alloc_t>::deallocate (chunkAlloc, group, 1);
+            group   = nxt;
+        }
+        group   = below;
+    }
+
+    mShared = nullptr;
+}
+
+/**
+ * @brief                   Checks whether a group of chunks is kept alive by another one (or is the same one)
+ *
+ * @param pFrom             Head of the newer group
+ * @param pTo               Head of the group to be looked for among the groups kept alive by pFrom
+ *
+ * @return true             If pTo is pFrom, or is reached by following the older groups kept alive by it
+ * @return false            Otherwise
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+bool
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::node_pool_t::reaches (chunk_t * pFrom, chunk_t * pTo)
+{
+    for (; pFrom != nullptr; pFrom = pFrom->below) {
+        if (pFrom == pTo) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief                   Takes over all the chunks of another pool, along with the nodes allocated from them
+ *
+ * @note                    The unused slots of the most recent chunk of the other pool are added to the free slots, and allocations continue
+ *                          from the most recent chunk of this pool. This takes time proportional to the number of chunks and free slots of the
+ *                          other pool. A group of chunks shared by the other pool is taken over as well if this pool shares none, or one which
+ *                          keeps it alive (or is kept alive by it). Slots can not be moved between arenas, so nothing is taken over in compact mode
+ *
+ * @param pOther            Pool to take the chunks of (left without any chunks)
+ *
+ * @return true             If all the nodes of the other pool now belong to this pool
+ * @return false            If the two pools share unrelated groups of chunks, use allocators which are not equal, or in compact mode
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+bool
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::node_pool_t::absorb (node_pool_t & pOther)
+{
+    if constexpr (mCompact) {
+        return false;
+    }
+    else {
+
+        if (!(mAlloc == pOther.mAlloc)) {
+            return false;
+        }
+
+        // this pool can keep only one chain of shared groups alive
+        if (pOther.mShared != nullptr && mShared != nullptr && !reaches (mShared, pOther.mShared) && !reaches (pOther.mShared, mShared)) {
+            return false;
+        }
+
+#ifndef AG_AVL_NO_POOL
+        if (pOther.mChunks != nullptr) {
+
+            // free the slots which were never handed out from the most recent chunk of the other pool
+            for (; pOther.mUsed < CHUNK_NODES; ++pOther.mUsed) {
+
+                node_slot_t *slot   {&pOther.mChunks->slots[pOther.mUsed]};
+
+                slot->nxt           = pOther.mFree;
+                pOther.mFree        = reinterpret_cast<node_ptr_t> (slot);
+            }
+
+            // hang the chunks of the other pool behind the most recent chunk of this one
+            chunk_t     *tail   {pOther.mChunks};
+
+            while (tail->nxt != nullptr) {
+                tail = tail->nxt;
+            }
+
+            if (mChunks != nullptr) {
+                tail->nxt       = mChunks->nxt;
+                mChunks->nxt    = pOther.mChunks;
+            }
+            else {
+                mChunks         = pOther.mChunks;
+                mUsed           = CHUNK_NODES;
+            }
+        }
+
+        // put the free slots of the other pool in front of those of this one
+        if (pOther.mFree != NIL) {
+
+            link_t      tail    {pOther.mFree};
+
+            while (reinterpret_cast<node_slot_t *> (tail)->nxt != NIL) {
+                tail = reinterpret_cast<node_slot_t *> (tail)->nxt;
+            }
+
+            reinterpret_cast<node_slot_t *> (tail)->nxt = mFree;
+            mFree               = pOther.mFree;
+        }
+
+        pOther.mChunks  = nullptr;
+        pOther.mUsed    = CHUNK_NODES;
+        pOther.mFree    = NIL;
+
+        // keep the newer of the two groups (which keeps the other one alive), or the only one, and let go of the other
+        if (pOther.mShared != nullptr) {
+            if (mShared == nullptr || reaches (pOther.mShared, mShared)) {
+                std::swap (mShared, pOther.mShared);
+            }
+            pOther.drop_shared ();
+        }
+#endif
+
+        return true;
+    }
+}
+
+/**
+ * @brief                   Lets another (new) pool keep alive all the chunks of this pool, so that the nodes in them can be handed to a tree
+ *                          using the other pool
+ *
+ * @note                    The chunks of this pool become a new group (whose head keeps the group this pool shared so far alive), which both
+ *                          pools then use, and allocations continue from new chunks. The unused slots of the most recent chunk are freed
+ *                          first. This takes time proportional to the number of unused slots. Slots can not be moved between arenas, so
+ *                          nothing is shared in compact mode
+ *
+ * @param pOther            Pool which is to share the chunks (must not hold any chunks or share any group)
+ *
+ * @return true             If the other pool keeps all chunks of this pool alive
+ * @return false            In compact mode
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+bool
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::node_pool_t::share (node_pool_t & pOther)
+{
+    if constexpr (mCompact) {
+        return false;
+    }
+    else {
+
+#ifndef AG_AVL_NO_POOL
+        if (mChunks != nullptr) {
+
+            // free the slots which were never handed out from the most recent chunk
+            for (; mUsed < CHUNK_NODES; ++mUsed) {
+
+                node_slot_t *slot   {&mChunks->slots[mUsed]};
+
+                slot->nxt           = mFree;
+                mFree               = reinterpret_cast<node_ptr_t> (slot);
+            }
+
+            // the chunks become a group, which takes over the use of the group shared so far
+            new (&mChunks->refs) std::atomic<size_t> {1};
+            mChunks->below  = mShared;
+            mShared         = mChunks;
+            mChunks         = nullptr;
+        }
+
+        if (mShared != nullptr) {
+            mShared->refs.fetch_add (1, std::memory_order_relaxed);
+            pOther.mShared  = mShared;
+        }
+#else
+        (void)pOther;
+#endif
+
+        return true;
+    }
+}
+
+/**
+ * @brief                   Checks whether releasing the pool would also give back the memory of all nodes allocated from it
+ *
+ * @note                    Nodes in chunks shared with other pools are given back once the last of the pools is released
+ *
+ * @return true             If the pool keeps its nodes in chunks (or an arena)
+ * @return false            If every node is allocated individually
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+bool
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::node_pool_t::releasable () const
+{
+#ifdef AG_AVL_NO_POOL
+    if constexpr (!mCompact) {
+        return false;
+    }
+#endif
+    return true;
+}
+
+/**
+ * @brief                   Returns the node a link refers to
+ *
+ * @param pLink             Link to a node allocated from the pool
+ *
+ * @return node_ptr_t       Pointer to the node (the link itself unless in compact mode)
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+typename AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::node_ptr_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::node_pool_t::get (link_t pLink) const
+{
+    if constexpr (mCompact) {
+        return reinterpret_cast<node_ptr_t> (&mArena[pLink]);
+    }
+    else {
+        return pLink;
+    }
+}
+
+/**
+ * @brief                   Returns a copy of the allocator used by the pool
+ *
+ * @return alloc_t          Allocator from which chunks (or single nodes) are obtained
+ */
+template <typename val_t, auto mComp, auto mEquals, typename alloc_t, bool mCompact, bool mCounted, typename aug_t, bool mShiftable>
+alloc_t
+AgAVLTree<val_t, mComp, mEquals, alloc_t, mCompact, mCounted, aug_t, mShiftable>::node_pool_t::get_allocator () const
+{
+    return mAlloc;
+}
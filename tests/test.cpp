@@ -4,8 +4,17 @@
  * @brief                       Unit Tests
  */
 
+#include <algorithm>
+#include <cmath>
 #include <cstdlib>
 #include <functional>
+#include <iterator>
+#include <memory_resource>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -415,6 +424,115 @@ TEST (Insert, insert_rr_compound)
     //       0               2               4               6
 }
 
+/**
+ * @brief   Test that retracing after an insertion stops at the first rotation, on a long run of ascending and descending values
+ *
+ */
+TEST (Insert, insert_sequential_deep)
+{
+    // a perfectly balanced tree of 2^k - 1 nodes is built with exactly one rotation per node outside of its leftmost path
+    constexpr int32_t       levels  {16};
+    constexpr int32_t       n       {(1 << levels) - 1};
+
+    AgAVLTree<int32_t> ascending;
+
+    for (int32_t v = 0; v < n; ++v) {
+        ASSERT_EQ (ascending.insert (v), true);
+    }
+    ASSERT_EQ (ascending.size (), (size_t)n);
+    ASSERT_ROTATIONS (ascending, 0, 0, 0, n - levels);
+    ASSERT_EQ (ascending.check_balance (), true);
+
+    AgAVLTree<int32_t> descending;
+
+    for (int32_t v = n - 1; v >= 0; --v) {
+        ASSERT_EQ (descending.insert (v), true);
+    }
+    ASSERT_EQ (descending.size (), (size_t)n);
+    ASSERT_ROTATIONS (descending, n - levels, 0, 0, 0);
+    ASSERT_EQ (descending.check_balance (), true);
+
+    // duplicates are rejected without touching the tree
+    for (int32_t v = 0; v < n; v += 97) {
+        ASSERT_EQ (ascending.insert (v), false);
+    }
+    ASSERT_EQ (ascending.size (), (size_t)n);
+    ASSERT_ROTATIONS (ascending, 0, 0, 0, n - levels);
+    ASSERT_EQ (ascending.check_balance (), true);
+}
+
+/**
+ * @brief   Test inserting with hints, which give the same tree as inserting from the root when right, and fall back to it when wrong
+ *
+ */
+TEST (Insert, insert_hinted)
+{
+    constexpr int32_t       levels  {16};
+    constexpr int32_t       n       {(1 << levels) - 1};
+
+    // appending at the end makes the same rotations as inserting from the root
+    AgAVLTree<int32_t>      ascending;
+
+    for (int32_t v = 0; v < n; ++v) {
+        auto it = ascending.insert (ascending.end (), v);
+        ASSERT_EQ (*it, v);
+    }
+    ASSERT_EQ (ascending.size (), (size_t)n);
+    ASSERT_ROTATIONS (ascending, 0, 0, 0, n - levels);
+    ASSERT_EQ (ascending.check_balance (), true);
+
+    // so does prepending before the first element
+    AgAVLTree<int32_t>      descending;
+
+    for (int32_t v = n - 1; v >= 0; --v) {
+        descending.insert (descending.begin (), v);
+    }
+    ASSERT_EQ (descending.size (), (size_t)n);
+    ASSERT_ROTATIONS (descending, n - levels, 0, 0, 0);
+    ASSERT_EQ (descending.check_balance (), true);
+
+    // fill in the gaps, each right before the next greater element (which is then found from the hint of the previous one)
+    AgAVLTree<int32_t>      gaps;
+
+    for (int32_t v = 0; v < 2 * n; v += 2) {
+        gaps.insert (v);
+    }
+    auto                    hint    = gaps.find (2);
+    for (int32_t v = 1; v < 2 * n - 2; v += 2) {
+        hint = gaps.insert (hint, v);
+        ASSERT_EQ (*hint, v);
+        ++hint;
+        ++hint;
+    }
+    ASSERT_EQ (gaps.size (), (size_t)(2 * n - 1));
+    ASSERT_EQ (gaps.check_balance (), true);
+
+    int32_t                 expected    {0};
+    for (auto v : gaps) {
+        ASSERT_EQ (v, expected++);
+    }
+
+    // wrong hints and duplicates
+    AgAVLTree<int32_t>      tree;
+
+    insert (tree, 10, 20, 30);
+
+    ASSERT_EQ (*tree.insert (tree.begin (), 25), 25);
+    ASSERT_EQ (*tree.insert (tree.end (), 5), 5);
+    ASSERT_EQ (*tree.insert (tree.find (30), 20), 20);
+    ASSERT_EQ (*tree.insert (tree.find (30), 25), 25);
+    ASSERT_EQ (*tree.insert (tree.begin (), 30), 30);
+    ASSERT_EQ (tree.size (), (size_t)5);
+    ASSERT_EQ (tree.check_balance (), true);
+
+    int32_t                 values[]    {5, 10, 20, 25, 30};
+
+    expected = 0;
+    for (auto v : tree) {
+        ASSERT_EQ (v, values[expected++]);
+    }
+}
+
 /**
  * @brief   Test erasing an ancestorless node without chidren (simple case)
  *
@@ -965,10 +1083,10 @@ TEST (Erase, both_child_find_min_rr)
 }
 
 /**
- * @brief   Test erasing a node with both children, and resulting in a left-left rotation (at the position of the deleted node)
+ * @brief   Test erasing a left-heavy node with both children (replaced by its predecessor), and resulting in a left-left rotation
  *
  */
-TEST (Erase, both_child_ll)
+TEST (Erase, both_child_find_max_ll)
 {
     AgAVLTree<int32_t> tree;
 
@@ -991,24 +1109,62 @@ TEST (Erase, both_child_ll)
     ASSERT_ROTATIONS (tree, 1, 0, 0, 0);
     ASSERT_EQ (tree.check_balance (), true);
 
-    // Expected shape of tree after erase (left-left imbalance at node 5)
-    //                               5
+    // Expected shape of tree after erase (left-left imbalance at node 2)
+    //                               3
     //               2                               6
-    //       1               3
+    //       1                               5
     //   0
 
     // Expected shape of tree after rebalancing
-    //                               2
-    //               1                               5
-    //       0                               3               6
-    //                                   2
+    //                               3
+    //               1                               6
+    //       0               2               5
+}
+
+/**
+ * @brief   Test erasing a left-heavy node with both children (replaced by its predecessor), and resulting in a left-right rotation
+ *
+ */
+TEST (Erase, both_child_find_max_lr)
+{
+    AgAVLTree<int32_t> tree;
+
+    insert (tree, 6);
+    insert (tree, 2, 8);
+    insert (tree, 0, 3, 7, 9);
+    insert (tree, 1);
+    ASSERT_EQ (tree.size (), (size_t)8);
+    ASSERT_ROTATIONS (tree, 0, 0, 0, 0);
+    ASSERT_EQ (tree.check_balance (), true);
+
+    // Expected shape of tree after insertions (balanced)
+    //                               6
+    //               2                               8
+    //       0               3               7               9
+    //           1
+
+    tree.erase (6);
+    ASSERT_EQ (tree.size (), (size_t)7);
+    ASSERT_ROTATIONS (tree, 0, 1, 0, 0);
+    ASSERT_EQ (tree.check_balance (), true);
+
+    // Expected shape of tree after erase (left-right imbalance at node 2)
+    //                               3
+    //               2                               8
+    //       0                               7               9
+    //           1
+
+    // Expected shape of tree after rebalancing
+    //                               3
+    //               1                               8
+    //       0               2               7               9
 }
 
 /**
- * @brief   Test erasing a node with both children, and resulting in a left-right rotation (at the position of the deleted node)
+ * @brief   Test that a node with both children is never out of balance after being replaced by a neighbour from its taller side
  *
  */
-TEST (Erase, both_child_lr)
+TEST (Erase, both_child_taller_side)
 {
     AgAVLTree<int32_t> tree;
 
@@ -1026,23 +1182,139 @@ TEST (Erase, both_child_lr)
     //       1               4               6
     //                   3
 
+    // taking the successor (6) would leave node 7 empty and force a rotation at the root, the predecessor (4) needs none
     tree.erase (5);
     ASSERT_EQ (tree.size (), (size_t)6);
-    ASSERT_ROTATIONS (tree, 0, 1, 0, 0);
+    ASSERT_ROTATIONS (tree, 0, 0, 0, 0);
     ASSERT_EQ (tree.check_balance (), true);
 
-    // Expected shape of tree after erase (left-right imbalance at node 6)
-    //                               6
-    //               2                               7
-    //       1               4
-    //                   3
-
-    // Expected shape of tree after rebalancing
+    // Expected shape of tree after erase (balanced)
     //                               4
     //               2                               7
     //       1               3               6
 }
 
+/**
+ * @brief   Test erasing half-open ranges of values, checking the contents and balance of the tree after each
+ *
+ */
+TEST (Erase, erase_range)
+{
+    AgAVLTree<int32_t>  tree;
+    std::set<int32_t>   ref;
+
+    for (int32_t v = 0; v < 4096; v += 2) {
+        tree.insert (v);
+        ref.insert (v);
+    }
+
+    // empty and inverted ranges erase nothing
+    ASSERT_EQ (tree.erase_range (10, 10), (size_t)0);
+    ASSERT_EQ (tree.erase_range (20, 10), (size_t)0);
+    ASSERT_EQ (tree.erase_range (11, 12), (size_t)0);
+
+    // erase every element of a small tree on its own (leaves, inner nodes and the root)
+    for (int32_t v = 1; v <= 15; ++v) {
+
+        AgAVLTree<int32_t>  small;
+
+        for (int32_t w = 1; w <= 15; ++w) {
+            small.insert (w);
+        }
+        ASSERT_EQ (small.erase_range (v, v + 1), (size_t)1);
+        ASSERT_EQ (small.size (), (size_t)14);
+        ASSERT_EQ (small.exists (v), false);
+        ASSERT_EQ (small.check_balance (), true);
+    }
+
+    // ranges whose ends lie on and between elements, including both ends of the tree
+    std::pair<int32_t, int32_t>     ranges[]    {{100, 200}, {101, 301}, {-50, 40}, {4000, 5000}, {1000, 1001}, {2047, 3003}, {-1, 9000}};
+
+    for (auto [lo, hi] : ranges) {
+
+        size_t  expected    = (size_t)std::distance (ref.lower_bound (lo), ref.lower_bound (hi));
+
+        ref.erase (ref.lower_bound (lo), ref.lower_bound (hi));
+        ASSERT_EQ (tree.erase_range (lo, hi), expected);
+        ASSERT_EQ (tree.size (), ref.size ());
+        ASSERT_EQ (tree.check_balance (), true);
+
+        // reuse the freed nodes, which must not be linked into the tree anymore
+        for (int32_t v = 1; v < 256; v += 2) {
+            tree.insert (v + 8192);
+        }
+        for (int32_t v = 1; v < 256; v += 2) {
+            tree.erase (v + 8192);
+        }
+        ASSERT_EQ (tree.size (), ref.size ());
+        ASSERT_EQ (tree.check_balance (), true);
+
+        auto    it  = ref.begin ();
+        for (auto v : tree) {
+            ASSERT_EQ (v, *it++);
+        }
+    }
+    ASSERT_EQ (tree.size (), (size_t)0);
+
+    // iterators of shiftable trees give the values by value, and a range between two of them is erased all the same
+    AgAVLTreeShiftable<int32_t> shifted;
+
+    for (int32_t v = 1; v <= 100; ++v) {
+        shifted.insert (v);
+    }
+    ASSERT_EQ (shifted.shift_range (50, 100, 1'000), true);
+
+    auto        last    {shifted.erase (shifted.find (40), shifted.find (1'060))};
+
+    ASSERT_EQ (*last, 1'060);
+    ASSERT_EQ (shifted.size (), (size_t)80);
+    ASSERT_EQ (shifted.exists (39), true);
+    ASSERT_EQ (shifted.exists (1'059), false);
+    ASSERT_EQ (shifted.check_balance (), true);
+    ASSERT_EQ (shifted.erase (shifted.find (1'090), shifted.end ()) == shifted.end (), true);
+    ASSERT_EQ (shifted.size (), (size_t)69);
+    ASSERT_EQ (*shifted.rbegin (), 1'089);
+}
+
+/**
+ * @brief   Test erasing ranges given by iterators into the tree, including ranges up to end ()
+ *
+ */
+TEST (Erase, erase_iterators)
+{
+    AgAVLTreeCompact<int32_t>   tree;
+
+    for (int32_t v = 0; v < 1000; ++v) {
+        tree.insert (v);
+    }
+
+    // the iterator to the end of the range stays valid
+    auto    it  = tree.erase (tree.find (100), tree.find (600));
+    ASSERT_EQ (*it, 600);
+    ASSERT_EQ (tree.size (), (size_t)500);
+    ASSERT_EQ (tree.check_balance (), true);
+    ASSERT_EQ (tree.exists (99), true);
+    ASSERT_EQ (tree.exists (100), false);
+    ASSERT_EQ (tree.exists (599), false);
+
+    ASSERT_EQ (tree.erase (it, it), it);
+    ASSERT_EQ (tree.size (), (size_t)500);
+
+    ASSERT_EQ (tree.erase (tree.find (900), tree.end ()), tree.end ());
+    ASSERT_EQ (tree.size (), (size_t)400);
+    ASSERT_EQ (tree.check_balance (), true);
+    ASSERT_EQ (*tree.rbegin (), 899);
+
+    tree.erase (tree.begin (), tree.end ());
+    ASSERT_EQ (tree.size (), (size_t)0);
+    ASSERT_EQ (tree.begin (), tree.end ());
+
+    // the tree can still be used afterwards
+    tree.insert (5);
+    ASSERT_EQ (tree.size (), (size_t)1);
+    ASSERT_EQ (tree.exists (5), true);
+}
+
 /**
  * @brief   Test simple forward iteration
  *
@@ -1459,6 +1731,57 @@ TEST (Iteration, reverse_equality_test)
     ASSERT_NE (it1_cpy, it2);
 }
 
+/**
+ * @brief   Test iteration in both directions after a random mix of insertions and erasures (exercises parent links)
+ *
+ */
+TEST (Iteration, mixed_modifications_test)
+{
+    constexpr int32_t               ops     {20'000};
+    constexpr int32_t               range   {5'000};
+
+    AgAVLTree<int32_t>              tree;
+    std::set<int32_t>               expected;
+
+    std::mt19937                    gen     (42);
+    std::uniform_int_distribution   dist    (0, range);
+
+    // randomly insert and erase values, keeping a std::set in sync to compare with
+    for (int32_t i = 0; i < ops; ++i) {
+        int32_t     v       = dist (gen);
+
+        if (gen () & 1) {
+            ASSERT_EQ (tree.insert (v), expected.insert (v).second);
+        }
+        else {
+            ASSERT_EQ (tree.erase (v), expected.erase (v) == 1);
+        }
+    }
+    ASSERT_EQ (tree.size (), expected.size ());
+    ASSERT_EQ (tree.check_balance (), true);
+
+    // forward iteration should visit the values in ascending order
+    auto                            eit     = expected.begin ();
+    for (auto it = tree.begin (); it != tree.end (); ++it, ++eit) {
+        ASSERT_EQ (*it, *eit);
+    }
+    ASSERT_EQ (eit, expected.end ());
+
+    // reverse iteration should visit the values in descending order
+    auto                            reit    = expected.rbegin ();
+    for (auto it = tree.rbegin (); it != tree.rend (); ++it, ++reit) {
+        ASSERT_EQ (*it, *reit);
+    }
+    ASSERT_EQ (reit, expected.rend ());
+
+    // stepping backwards from end() should also visit the values in descending order
+    reit    = expected.rbegin ();
+    for (auto it = tree.end (); reit != expected.rend (); ++reit) {
+        --it;
+        ASSERT_EQ (*it, *reit);
+    }
+}
+
 /**
  * @brief   Test all variations of find (strictly matching element)
  *
@@ -1633,6 +1956,99 @@ TEST (Find, find_less_equals_test)
     }
 }
 
+/**
+ * @brief   Test equal_range against std::set, for values present in and missing from the tree
+ *
+ */
+TEST (Find, equal_range_test)
+{
+    constexpr int32_t   lo      {1};
+    constexpr int32_t   hi      {1000};
+
+    AgAVLTree<int32_t>  tree;
+
+    // for an empty tree, all ranges should be empty at end()
+    ASSERT_EQ (tree.equal_range (lo).first, tree.end ());
+    ASSERT_EQ (tree.equal_range (lo).second, tree.end ());
+
+    // insert all odd elements between lo and hi (inclusive of both bounds)
+    for (int32_t v = lo; v <= hi; ++v) {
+        if (v % 2) {
+            tree.insert (v);
+        }
+    }
+
+    for (int32_t v = lo - 1; v <= hi + 1; ++v) {
+
+        auto [first, last]  = tree.equal_range (v);
+
+        // a present value is the only element of its range, a missing value gives an empty range at the next greater element
+        ASSERT_EQ (first, tree.first_greater_equals (v));
+        ASSERT_EQ (last, tree.first_greater_strict (v));
+
+        if (v % 2 && v <= hi) {
+            ASSERT_EQ (*first, v);
+            ASSERT_EQ (++first, last);
+        }
+        else {
+            ASSERT_EQ (first, last);
+        }
+    }
+}
+
+/**
+ * @brief   Test bounds against std::set, for random intervals (including empty and inverted ones)
+ *
+ */
+TEST (Find, bounds_test)
+{
+    constexpr int32_t                       n       {2000};
+    constexpr int32_t                       range   {5000};
+
+    AgAVLTree<int32_t>                      tree;
+    std::set<int32_t>                       ref;
+
+    std::mt19937                            gen     {42};
+    std::uniform_int_distribution<int32_t>  dist    {-range, range};
+
+    // for an empty tree, all ranges should be empty at end()
+    ASSERT_EQ (tree.bounds (-range, range).first, tree.end ());
+    ASSERT_EQ (tree.bounds (-range, range).second, tree.end ());
+
+    for (int32_t i = 0; i < n; ++i) {
+        int32_t v   = dist (gen);
+        tree.insert (v);
+        ref.insert (v);
+    }
+
+    for (int32_t i = 0; i < n; ++i) {
+
+        int32_t a   = dist (gen);
+        int32_t b   = (i % 4 == 0) ? (a) : (dist (gen));
+
+        auto [first, last]  = tree.bounds (a, b);
+
+        // an inverted interval is empty
+        if (b < a) {
+            ASSERT_EQ (first, last);
+            continue;
+        }
+
+        // the range must hold exactly the elements of [a, b] and end at the first element after b
+        ASSERT_EQ (first, tree.first_greater_equals (a));
+        ASSERT_EQ (last, tree.first_greater_strict (b));
+
+        auto    refFirst    = ref.lower_bound (a);
+        auto    refLast     = ref.upper_bound (b);
+
+        for (; first != last && refFirst != refLast; ++first, ++refFirst) {
+            ASSERT_EQ (*first, *refFirst);
+        }
+        ASSERT_EQ (first, last);
+        ASSERT_EQ (refFirst, refLast);
+    }
+}
+
 bool
 lt (const char * const & a, const char * const & b)
 {
@@ -1672,58 +2088,2588 @@ TEST (CustomComparator, c_string_test)
     }
 }
 
-TEST (CopyConstructor, multiElementTree)
+int32_t
+cmp (const char * const & a, const char * const & b)
 {
-    constexpr int                   lo  = 1;
-    constexpr int                   hi  = 1'000;
+    return strcmp (a, b);
+}
 
-    AgAVLTree<int>                  tree1;
+/**
+ * @brief   Test if C style strings work with a single three-way comparator
+ *
+ */
+TEST (CustomComparator, c_string_three_way_test)
+{
+    AgAVLTree<const char *, cmp>    tree;
 
-    for (auto i = lo; i <= hi; ++i) {
-        ASSERT_TRUE (tree1.insert (i));
-    }
+    char                            ar[]    = "useful";
 
-    AgAVLTree<int>                  tree2 (tree1);
+    ASSERT_EQ (tree.insert ("AVL"), true);
+    ASSERT_EQ (tree.insert ("Trees"), true);
+    ASSERT_EQ (tree.insert ("are"), true);
+    ASSERT_EQ (tree.insert ("very"), true);
+    ASSERT_EQ (tree.insert ("useful"), true);
 
-    ASSERT_EQ (tree1.size (), tree2.size ());
+    // repeat insert should fail
+    ASSERT_EQ (tree.insert (ar), false);
 
-    auto                            it1 = tree1.begin ();
-    auto                            it2 = tree2.begin ();
+    ASSERT_EQ (tree.size (), (size_t)5);
 
-    for (; it1 != tree1.end (); ++it1, ++it2) {
-        ASSERT_EQ (*it1, *it2);
+    // each element should be strictly greater than the previous one
+    for (auto it1 = tree.begin (), it2 = ++tree.begin (); it2 != tree.end (); ++it1, ++it2) {
+        ASSERT_LT (cmp (*it1, *it2), 0);
     }
 
-    ASSERT_TRUE (tree2.erase (hi));
-
-    ASSERT_EQ (tree1.size (), hi - lo + 1);
-    ASSERT_EQ (tree2.size (), hi - lo);
+    ASSERT_EQ (tree.exists (ar), true);
+    ASSERT_EQ (tree.exists ("tree"), false);
+    ASSERT_EQ (*tree.first_greater_strict ("are"), std::string ("useful"));
+    ASSERT_EQ (*tree.first_greater_equals ("are"), std::string ("are"));
+    ASSERT_EQ (*tree.last_smaller_strict ("are"), std::string ("Trees"));
+    ASSERT_EQ (*tree.last_smaller_equals ("b"), std::string ("are"));
 
-    it1 = tree1.begin ();
-    it2 = tree2.begin ();
+    ASSERT_EQ (tree.erase (ar), true);
+    ASSERT_EQ (tree.erase (ar), false);
+    ASSERT_EQ (tree.size (), (size_t)4);
+}
 
-    for (auto i = lo; i <= hi; ++i, ++it1) {
-        ASSERT_EQ (*it1, i);
-    }
-    ASSERT_EQ (it1, tree1.end ());
+static size_t   compCalls   {0};
 
-    for (auto i = lo; i < hi; ++i, ++it2) {
-        ASSERT_EQ (*it2, i);
-    }
-    ASSERT_EQ (++it2, tree2.end ());
+bool
+counted_lt (const int32_t & a, const int32_t & b)
+{
+    ++compCalls;
+    return a < b;
 }
 
-TEST (CopyConstructor, emptyTree)
+bool
+counted_eq (const int32_t & a, const int32_t & b)
 {
-    AgAVLTree<int>                  tree1;
-    AgAVLTree<int>                  tree2 (tree1);
+    ++compCalls;
+    return a == b;
+}
 
-    ASSERT_EQ (tree1.size (), tree2.size ());
+int32_t
+counted_cmp (const int32_t & a, const int32_t & b)
+{
+    ++compCalls;
+    return (a > b) - (a < b);
+}
 
-    auto                            it1 = tree1.begin ();
+/**
+ * @brief   Test that inserting with a right hint takes at most two comparisons, however large the tree is
+ *
+ */
+TEST (CustomComparator, hinted_insert_call_count)
+{
+    constexpr int32_t                           n       {100'000};
+
+    AgAVLTree<int32_t, counted_cmp>             tree;
+
+    compCalls = 0;
+    for (int32_t v = 0; v < n; ++v) {
+        tree.insert (tree.end (), 2 * v);
+    }
+
+    // only the greatest element is compared against when appending
+    ASSERT_EQ (compCalls, (size_t)(n - 1));
+
+    // filling a gap compares against the elements on both sides of it
+    std::vector<AgAVLTree<int32_t, counted_cmp>::iterator>  hints;
+
+    for (int32_t v = 0; v < n - 1; ++v) {
+        hints.push_back (tree.find (2 * v + 2));
+    }
+
+    compCalls = 0;
+    for (int32_t v = 0; v < n - 1; ++v) {
+        tree.insert (hints[v], 2 * v + 1);
+    }
+    ASSERT_EQ (compCalls, (size_t)(2 * (n - 1)));
+    ASSERT_EQ (tree.size (), (size_t)(2 * n - 1));
+    ASSERT_EQ (tree.check_balance (), true);
+}
+
+/**
+ * @brief   Test that a three-way comparator is called once per level while searching, against up to twice for the pair of comparators
+ *
+ */
+TEST (CustomComparator, three_way_call_count)
+{
+    // a perfectly balanced tree with 10 levels, where the nodes at depth d (starting from 1) take d comparisons to be found
+    constexpr int32_t                           levels  {10};
+    constexpr int32_t                           n       {(1 << levels) - 1};
+    constexpr size_t                            visits  {(size_t)(levels - 1) * (1 << levels) + 1};
+
+    AgAVLTree<int32_t, counted_cmp>             threeWay;
+    AgAVLTree<int32_t, counted_lt, counted_eq>  twoWay;
+
+    for (int32_t v = 0; v < n; ++v) {
+        threeWay.insert (v);
+        twoWay.insert (v);
+    }
+
+    compCalls = 0;
+    for (int32_t v = 0; v < n; ++v) {
+        ASSERT_EQ (threeWay.exists (v), true);
+    }
+    ASSERT_EQ (compCalls, visits);
+
+    // every node on the way is checked for equality and then ordered, except for the last one
+    compCalls = 0;
+    for (int32_t v = 0; v < n; ++v) {
+        ASSERT_EQ (twoWay.exists (v), true);
+    }
+    ASSERT_EQ (compCalls, 2 * visits - n);
+
+    // bound searches take a single comparison per level with either form
+    compCalls = 0;
+    ASSERT_EQ (*threeWay.last_smaller_strict (n / 2), n / 2 - 1);
+    ASSERT_EQ (compCalls, (size_t)levels);
+
+    compCalls = 0;
+    ASSERT_EQ (*twoWay.last_smaller_strict (n / 2), n / 2 - 1);
+    ASSERT_EQ (compCalls, (size_t)levels);
+}
+
+TEST (CopyConstructor, multiElementTree)
+{
+    constexpr int                   lo  = 1;
+    constexpr int                   hi  = 1'000;
+
+    AgAVLTree<int>                  tree1;
+
+    for (auto i = lo; i <= hi; ++i) {
+        ASSERT_TRUE (tree1.insert (i));
+    }
+
+    AgAVLTree<int>                  tree2 (tree1);
+
+    ASSERT_EQ (tree1.size (), tree2.size ());
+
+    auto                            it1 = tree1.begin ();
+    auto                            it2 = tree2.begin ();
+
+    for (; it1 != tree1.end (); ++it1, ++it2) {
+        ASSERT_EQ (*it1, *it2);
+    }
+
+    ASSERT_TRUE (tree2.erase (hi));
+
+    ASSERT_EQ (tree1.size (), hi - lo + 1);
+    ASSERT_EQ (tree2.size (), hi - lo);
+
+    it1 = tree1.begin ();
+    it2 = tree2.begin ();
+
+    for (auto i = lo; i <= hi; ++i, ++it1) {
+        ASSERT_EQ (*it1, i);
+    }
+    ASSERT_EQ (it1, tree1.end ());
+
+    for (auto i = lo; i < hi; ++i, ++it2) {
+        ASSERT_EQ (*it2, i);
+    }
+    ASSERT_EQ (++it2, tree2.end ());
+}
+
+/**
+ * @brief   Test copying large trees on several threads, in both modes and with values which are not trivially copyable
+ *
+ */
+TEST (CopyConstructor, parallel)
+{
+    AgAVLTree<int32_t>              tree;
+    AgAVLTreeCompact<int32_t>       compact;
+    AgAVLTree<std::string>          strings;
+
+    for (int32_t v = 0; v < 200'000; ++v) {
+        tree.insert (v * 7 % 200'000);
+        compact.insert (v);
+    }
+    for (int32_t v = 0; v < 100'000; ++v) {
+        strings.insert (std::to_string (v) + std::string (20, 'x'));
+    }
+
+    AgAVLTree<int32_t>              tree2       (tree, 4);
+    AgAVLTreeCompact<int32_t>       compact2    (compact, 4);
+    AgAVLTree<std::string>          strings2    (strings, 4);
+
+    ASSERT_EQ (tree2.size (), (size_t)200'000);
+    ASSERT_EQ (compact2.size (), (size_t)200'000);
+    ASSERT_EQ (strings2.size (), (size_t)100'000);
+    ASSERT_EQ (tree2.check_balance (), true);
+    ASSERT_EQ (compact2.check_balance (), true);
+    ASSERT_EQ (strings2.check_balance (), true);
+
+    // the copies must have the same shape, with every node linked to its parent
+    int32_t                         v           {0};
+    for (auto it = tree2.begin (); it != tree2.end (); ++it, ++v) {
+        ASSERT_EQ (*it, v);
+    }
+    for (auto it = --tree2.end (); v > 0; --it) {
+        ASSERT_EQ (*it, --v);
+    }
+    auto                            itc         = compact2.begin ();
+    for (auto &e : compact) {
+        ASSERT_EQ (*itc++, e);
+    }
+    auto                            its         = strings2.begin ();
+    for (auto &e : strings) {
+        ASSERT_EQ (*its++, e);
+    }
+
+    // modifying a copy leaves the original alone (the left halves were copied into pools which the copy took over)
+    for (int32_t i = 0; i < 200'000; i += 2) {
+        ASSERT_EQ (tree2.erase (i), true);
+    }
+    for (int32_t i = 0; i < 100'000; ++i) {
+        ASSERT_EQ (tree2.insert (200'000 + i), true);
+    }
+    ASSERT_EQ (tree2.check_balance (), true);
+    ASSERT_EQ (tree.size (), (size_t)200'000);
+    ASSERT_EQ (*tree.begin (), 0);
+}
+
+/**
+ * @brief   Test that copying a tree never starts more threads than it is given (less the calling thread)
+ *
+ */
+TEST (CopyConstructor, thread_limit)
+{
+    using tree_t                = AgAVLTree<int32_t>;
+
+    std::vector<int32_t>        values;
+
+    // large enough for the copy to fork at every level it is allowed to
+    for (int32_t v = 0; v < 400'000; ++v) {
+        values.push_back (v);
+    }
+
+    tree_t                      tree    (values.begin (), values.end ());
+
+    for (size_t threads = 1; threads <= 8; ++threads) {
+
+        tree_t::dbg_forks = 0;
+
+        tree_t                  cpy     (tree, threads);
+
+        ASSERT_LE (tree_t::dbg_forks, (int32_t)threads - 1);
+        ASSERT_EQ (cpy.size (), values.size ());
+        ASSERT_EQ (cpy.check_balance (), true);
+
+        // a number of threads which is not a power of two is rounded down to one
+        if (threads == 3) {
+            ASSERT_GT (tree_t::dbg_forks, 0);
+        }
+    }
+}
+
+TEST (CopyConstructor, emptyTree)
+{
+    AgAVLTree<int>                  tree1;
+    AgAVLTree<int>                  tree2 (tree1);
+
+    ASSERT_EQ (tree1.size (), tree2.size ());
+
+    auto                            it1 = tree1.begin ();
     auto                            it2 = tree2.begin ();
 
     for (; it1 != tree1.end (); ++it1, ++it2) {
         ASSERT_EQ (*it1, *it2);
     }
 }
+
+/**
+ * @brief   Test that the storage of erased nodes is reused by later insertions
+ *
+ */
+TEST (Pool, reuse_after_erase)
+{
+    AgAVLTree<int32_t>              tree;
+
+    insert (tree, 0, 1, 2, 3, 4);
+
+    // the node of the most recently erased value should be the first to be reused
+    const int32_t                   *addr   = &(*tree.find (2));
+    erase (tree, 2);
+    insert (tree, 10);
+    ASSERT_EQ (&(*tree.find (10)), addr);
+
+    // other nodes should be untouched
+    int32_t                         expected[] {0, 1, 3, 4, 10};
+    int32_t                         i       = 0;
+    for (auto &e : tree) {
+        ASSERT_EQ (e, expected[i++]);
+    }
+    ASSERT_EQ (tree.check_balance (), true);
+}
+
+/**
+ * @brief   Test that trees holding non-trivial values can repeatedly be filled, emptied and cleared
+ *
+ */
+TEST (Pool, churn_non_trivial)
+{
+    constexpr int32_t               n       {10'000};
+
+    AgAVLTree<std::string>          tree;
+
+    for (int32_t round = 0; round < 3; ++round) {
+
+        for (int32_t v = 0; v < n; ++v) {
+            ASSERT_EQ (tree.insert (std::to_string (v) + std::string (32, 'x')), true);
+        }
+        ASSERT_EQ (tree.size (), (size_t)n);
+
+        // erase half of the values, then re-insert them (reusing the freed nodes)
+        for (int32_t v = 0; v < n; v += 2) {
+            ASSERT_EQ (tree.erase (std::to_string (v) + std::string (32, 'x')), true);
+        }
+        for (int32_t v = 0; v < n; v += 2) {
+            ASSERT_EQ (tree.insert (std::to_string (v) + std::string (32, 'x')), true);
+        }
+        ASSERT_EQ (tree.size (), (size_t)n);
+        ASSERT_EQ (tree.check_balance (), true);
+
+        // every other round, release all the chunks at once
+        if (round % 2 == 0) {
+            tree.clear ();
+            ASSERT_EQ (tree.size (), (size_t)0);
+            ASSERT_EQ (tree.begin (), tree.end ());
+        }
+        else {
+            for (int32_t v = 0; v < n; ++v) {
+                ASSERT_EQ (tree.erase (std::to_string (v) + std::string (32, 'x')), true);
+            }
+        }
+    }
+}
+
+/**
+ * @brief                       Allocator which keeps count of the bytes currently allocated through it (and all its copies)
+ *
+ * @tparam T                    Type of values to allocate
+ */
+template <typename T>
+struct counting_allocator {
+
+    using value_type            = T;
+
+    int64_t                     *mBytes;
+    int64_t                     mLimit;         // allocations which would take the count above this throw std::bad_alloc
+
+    counting_allocator (int64_t *pBytes, int64_t pLimit = INT64_MAX) noexcept : mBytes {pBytes}, mLimit {pLimit} {}
+
+    template <typename U>
+    counting_allocator (const counting_allocator<U> &pOther) noexcept : mBytes {pOther.mBytes}, mLimit {pOther.mLimit} {}
+
+    T *
+    allocate (size_t pN)
+    {
+        if (*mBytes + (int64_t)(pN * sizeof (T)) > mLimit) {
+            throw std::bad_alloc ();
+        }
+        *mBytes     += (int64_t)(pN * sizeof (T));
+        return std::allocator<T> ().allocate (pN);
+    }
+
+    void
+    deallocate (T *pPtr, size_t pN)
+    {
+        *mBytes     -= (int64_t)(pN * sizeof (T));
+        std::allocator<T> ().deallocate (pPtr, pN);
+    }
+
+    template <typename U>
+    bool
+    operator== (const counting_allocator<U> &pOther) const
+    {
+        return mBytes == pOther.mBytes;
+    }
+
+    template <typename U>
+    bool
+    operator!= (const counting_allocator<U> &pOther) const
+    {
+        return mBytes != pOther.mBytes;
+    }
+};
+
+/**
+ * @brief   Test that all memory of the tree comes from (and goes back to) the given allocator
+ *
+ */
+TEST (Allocator, custom_allocator)
+{
+    using tree_t                = AgAVLTree<int32_t, ag_avl_default_comp<int32_t>, ag_avl_default_equals<int32_t>, counting_allocator<int32_t>>;
+
+    int64_t                     bytes   {0};
+
+    {
+        tree_t                  tree    (counting_allocator<int32_t> {&bytes});
+
+        ASSERT_EQ (tree.get_allocator ().mBytes, &bytes);
+
+        for (int32_t v = 0; v < 1'000; ++v) {
+            ASSERT_EQ (tree.insert (v), true);
+        }
+        ASSERT_GT (bytes, 0);
+
+        // copies should use the same allocator
+        tree_t                  cpy     (tree);
+        ASSERT_EQ (cpy.size (), tree.size ());
+        ASSERT_EQ (cpy.get_allocator ().mBytes, &bytes);
+
+        // moving should not allocate anything
+        int64_t                 before  {bytes};
+        tree_t                  moved   (std::move (cpy));
+        ASSERT_EQ (bytes, before);
+        ASSERT_EQ (moved.size (), (size_t)1'000);
+
+        tree.clear ();
+        ASSERT_EQ (tree.size (), (size_t)0);
+    }
+
+    // everything should have been given back to the allocator
+    ASSERT_EQ (bytes, 0);
+}
+
+/**
+ * @brief                       Value which keeps count of how many of its instances are alive
+ */
+struct tracked_value {
+
+    static inline int64_t       live    {0};
+
+    int32_t                     mVal;
+
+    tracked_value (int32_t pVal) : mVal {pVal}                  { ++live; }
+    tracked_value (const tracked_value &pOther) : mVal {pOther.mVal} { ++live; }
+    ~tracked_value ()                                           { --live; }
+
+    bool operator<  (const tracked_value &pOther) const         { return mVal < pOther.mVal; }
+    bool operator== (const tracked_value &pOther) const         { return mVal == pOther.mVal; }
+};
+
+/**
+ * @brief   Test that clearing gives back all memory, whether the nodes are released along with the chunks or destroyed one by one
+ *
+ */
+TEST (Allocator, clear_releases_chunks)
+{
+    using tree_t                = AgAVLTree<int32_t, ag_avl_default_comp<int32_t>, ag_avl_default_equals<int32_t>, counting_allocator<int32_t>>;
+    using tracked_tree_t        = AgAVLTree<tracked_value, ag_avl_default_comp<tracked_value>, ag_avl_default_equals<tracked_value>, counting_allocator<tracked_value>>;
+
+    int64_t                     bytes   {0};
+
+    {
+        tree_t                  tree    (counting_allocator<int32_t> {&bytes});
+
+        for (int32_t v = 0; v < 100'000; ++v) {
+            tree.insert (v);
+        }
+
+        // the two trees share a pool, so clearing one must not release the nodes of the other
+        tree_t                  right   = tree.split (50'000);
+
+        tree.clear ();
+        ASSERT_EQ (tree.size (), (size_t)0);
+        ASSERT_GT (bytes, 0);
+        ASSERT_EQ (right.size (), (size_t)50'000);
+        ASSERT_EQ (right.check_balance (), true);
+
+        right.clear ();
+        ASSERT_EQ (bytes, 0);
+
+        // the tree can be used again after being cleared
+        tree.insert (1);
+        ASSERT_EQ (tree.size (), (size_t)1);
+    }
+    ASSERT_EQ (bytes, 0);
+
+    // values with a destructor are destroyed one by one
+    {
+        tracked_tree_t          tree    (counting_allocator<tracked_value> {&bytes});
+
+        for (int32_t v = 0; v < 10'000; ++v) {
+            tree.insert (tracked_value {v});
+        }
+        ASSERT_EQ (tracked_value::live, 10'000);
+
+        tree.clear ();
+        ASSERT_EQ (tracked_value::live, 0);
+        ASSERT_EQ (bytes, 0);
+    }
+}
+
+/**
+ * @brief   Test that a copy which runs out of memory halfway destroys everything it has copied and is left empty
+ *
+ */
+TEST (Allocator, copy_out_of_memory)
+{
+    using tree_t                = AgAVLTree<int32_t, ag_avl_default_comp<int32_t>, ag_avl_default_equals<int32_t>, counting_allocator<int32_t>>;
+
+    int64_t                     bytes   {0};
+    int64_t                     full;
+
+    {
+        tree_t                  tree    (counting_allocator<int32_t> {&bytes});
+
+        for (int32_t v = 0; v < 100'000; ++v) {
+            tree.insert (v);
+        }
+        full    = bytes;
+    }
+
+    {
+        // there is only room for half a copy
+        tree_t                  tree    (counting_allocator<int32_t> {&bytes, full + full / 2});
+
+        for (int32_t v = 0; v < 100'000; ++v) {
+            tree.insert (v);
+        }
+        ASSERT_EQ (bytes, full);
+
+        tree_t                  cpy     (tree);
+
+        ASSERT_EQ (bytes, full);
+        ASSERT_EQ (cpy.size (), (size_t)0);
+        ASSERT_EQ (cpy.begin (), cpy.end ());
+
+        // the failed copy can still be used
+        ASSERT_EQ (cpy.insert (1), true);
+        ASSERT_EQ (cpy.size (), (size_t)1);
+    }
+    ASSERT_EQ (bytes, 0);
+}
+
+/**
+ * @brief   Test backing a tree with a monotonic buffer resource through the std::pmr alias
+ *
+ */
+TEST (Allocator, pmr_monotonic_buffer)
+{
+    std::pmr::monotonic_buffer_resource     arena;
+
+    {
+        AgAVLTreePmr<int32_t>               tree    (&arena);
+
+        for (int32_t v = 0; v < 10'000; ++v) {
+            ASSERT_EQ (tree.insert (v), true);
+        }
+        for (int32_t v = 0; v < 10'000; v += 2) {
+            ASSERT_EQ (tree.erase (v), true);
+        }
+        ASSERT_EQ (tree.size (), (size_t)5'000);
+        ASSERT_EQ (tree.check_balance (), true);
+
+        int32_t                             v       = 1;
+        for (auto &e : tree) {
+            ASSERT_EQ (e, v);
+            v += 2;
+        }
+
+        ASSERT_EQ (tree.get_allocator ().resource (), &arena);
+    }
+
+    // the arena can now be discarded at once, along with everything the tree allocated from it
+    arena.release ();
+}
+
+/**
+ * @brief   Test that a compact tree makes the same rotations and holds the same values as a regular tree after a random mix of modifications
+ *
+ */
+TEST (Compact, mixed_modifications_test)
+{
+    constexpr int32_t               ops     {50'000};
+    constexpr int32_t               range   {10'000};
+
+    AgAVLTree<int32_t>              tree;
+    AgAVLTreeCompact<int32_t>       compact;
+
+    std::mt19937                    gen     (7);
+    std::uniform_int_distribution   dist    (0, range);
+
+    for (int32_t i = 0; i < ops; ++i) {
+        int32_t     v       = dist (gen);
+
+        if (gen () % 3 != 0) {
+            ASSERT_EQ (compact.insert (v), tree.insert (v));
+        }
+        else {
+            ASSERT_EQ (compact.erase (v), tree.erase (v));
+        }
+    }
+    ASSERT_EQ (compact.size (), tree.size ());
+    ASSERT_EQ (tree.check_balance (), true);
+    ASSERT_EQ (compact.check_balance (), true);
+    ASSERT_EQ (compact.get_root_val (), tree.get_root_val ());
+    ASSERT_ROTATIONS (compact, tree.dbg_info.ll_count, tree.dbg_info.lr_count, tree.dbg_info.rl_count, tree.dbg_info.rr_count);
+
+    // iteration in both directions should match
+    auto                            it      = tree.begin ();
+    for (auto cit = compact.begin (); cit != compact.end (); ++cit, ++it) {
+        ASSERT_EQ (*cit, *it);
+    }
+    ASSERT_EQ (it, tree.end ());
+
+    auto                            rit     = tree.rbegin ();
+    for (auto crit = compact.rbegin (); crit != compact.rend (); ++crit, ++rit) {
+        ASSERT_EQ (*crit, *rit);
+    }
+    ASSERT_EQ (rit, tree.rend ());
+
+    // all kinds of searches should match
+    for (int32_t v = -1; v <= range + 1; ++v) {
+        ASSERT_EQ (compact.exists (v), tree.exists (v));
+        ASSERT_EQ (compact.find (v) == compact.end (), tree.find (v) == tree.end ());
+        ASSERT_EQ (compact.first_greater_strict (v) == compact.end (), tree.first_greater_strict (v) == tree.end ());
+        ASSERT_EQ (compact.last_smaller_strict (v) == compact.end (), tree.last_smaller_strict (v) == tree.end ());
+
+        if (compact.first_greater_equals (v) != compact.end ()) {
+            ASSERT_EQ (*compact.first_greater_equals (v), *tree.first_greater_equals (v));
+        }
+        if (compact.last_smaller_equals (v) != compact.end ()) {
+            ASSERT_EQ (*compact.last_smaller_equals (v), *tree.last_smaller_equals (v));
+        }
+    }
+}
+
+/**
+ * @brief   Test copying, moving and clearing compact trees holding non-trivial values
+ *
+ */
+TEST (Compact, copy_move_clear)
+{
+    AgAVLTreeCompact<std::string>   tree;
+
+    for (int32_t v = 0; v < 5'000; ++v) {
+        ASSERT_EQ (tree.insert (std::to_string (v) + std::string (32, 'x')), true);
+    }
+
+    AgAVLTreeCompact<std::string>   cpy     (tree);
+    ASSERT_EQ (cpy.size (), tree.size ());
+    ASSERT_EQ (cpy.check_balance (), true);
+
+    // erasing from the copy should not affect the original
+    for (int32_t v = 0; v < 5'000; v += 2) {
+        ASSERT_EQ (cpy.erase (std::to_string (v) + std::string (32, 'x')), true);
+    }
+    ASSERT_EQ (cpy.size (), (size_t)2'500);
+    ASSERT_EQ (tree.size (), (size_t)5'000);
+    ASSERT_EQ (tree.exists (std::string ("0") + std::string (32, 'x')), true);
+
+    AgAVLTreeCompact<std::string>   moved   (std::move (cpy));
+    ASSERT_EQ (moved.size (), (size_t)2'500);
+    ASSERT_EQ (cpy.size (), (size_t)0);
+    ASSERT_EQ (cpy.begin (), cpy.end ());
+    ASSERT_EQ (moved.check_balance (), true);
+
+    // the moved-from tree should still be usable
+    ASSERT_EQ (cpy.insert ("a"), true);
+    ASSERT_EQ (*cpy.begin (), "a");
+
+    tree.clear ();
+    ASSERT_EQ (tree.size (), (size_t)0);
+    ASSERT_EQ (tree.insert ("b"), true);
+    ASSERT_EQ (*tree.rbegin (), "b");
+}
+
+/**
+ * @brief   Test that iterators of a compact tree stay valid while its nodes are moved to larger arenas
+ *
+ */
+TEST (Compact, iterators_survive_growth)
+{
+    AgAVLTreeCompact<std::string>   tree;
+
+    insert (tree, std::string ("m"));
+
+    auto                            it      = tree.begin ();
+    auto                            rit     = tree.rbegin ();
+
+    // insert enough values around the first one to make the arena grow several times
+    for (int32_t v = 0; v < 20'000; ++v) {
+        ASSERT_EQ (tree.insert (((v & 1) ? ("a") : ("z")) + std::to_string (v)), true);
+    }
+    ASSERT_EQ (tree.check_balance (), true);
+
+    ASSERT_EQ (*it, "m");
+    ASSERT_EQ (*rit, "m");
+    ASSERT_EQ (it, tree.find ("m"));
+    ASSERT_EQ (*(++it), "z0");
+    ASSERT_EQ (*(++rit), "a9999");
+}
+
+/**
+ * @brief   Test that a compact tree takes less memory from its allocator than a regular tree with the same values
+ *
+ */
+TEST (Compact, smaller_footprint)
+{
+    using tree_t                = AgAVLTree<int32_t, ag_avl_default_comp<int32_t>, ag_avl_default_equals<int32_t>, counting_allocator<int32_t>>;
+    using compact_t             = AgAVLTreeCompact<int32_t, ag_avl_default_comp<int32_t>, ag_avl_default_equals<int32_t>, counting_allocator<int32_t>>;
+
+    int64_t                     bytes       {0};
+    int64_t                     compactBytes{0};
+
+    {
+        tree_t                  tree        (counting_allocator<int32_t> {&bytes});
+        compact_t               compact     (counting_allocator<int32_t> {&compactBytes});
+
+        for (int32_t v = 0; v < 100'000; ++v) {
+            ASSERT_EQ (tree.insert (v), true);
+            ASSERT_EQ (compact.insert (v), true);
+        }
+
+        ASSERT_LT (compactBytes, bytes);
+    }
+
+    ASSERT_EQ (bytes, 0);
+    ASSERT_EQ (compactBytes, 0);
+}
+
+/**
+ * @brief   Test building trees of all sizes from sorted ranges (perfectly balanced, without any rotations)
+ *
+ */
+TEST (Assign, sorted_range)
+{
+    for (int32_t n = 0; n <= 300; ++n) {
+
+        std::vector<int32_t>    values;
+
+        for (int32_t v = 0; v < n; ++v) {
+            values.push_back (2 * v);
+        }
+
+        AgAVLTree<int32_t>      tree        (values.begin (), values.end ());
+        AgAVLTreeCompact<int32_t> compact   (values.begin (), values.end ());
+
+        ASSERT_EQ (tree.size (), (size_t)n);
+        ASSERT_EQ (compact.size (), (size_t)n);
+        ASSERT_ROTATIONS (tree, 0, 0, 0, 0);
+        ASSERT_EQ (tree.check_balance (), true);
+        ASSERT_EQ (compact.check_balance (), true);
+
+        auto    it  {values.begin ()};
+
+        for (auto v : tree) {
+            ASSERT_EQ (v, *it++);
+        }
+        ASSERT_EQ (it, values.end ());
+
+        // the tree must behave normally after being built
+        for (int32_t v = 0; v < n; ++v) {
+            ASSERT_EQ (tree.exists (2 * v), true);
+            ASSERT_EQ (tree.insert (2 * v + 1), true);
+            ASSERT_EQ (compact.erase (2 * v), true);
+        }
+        ASSERT_EQ (tree.size (), (size_t)(2 * n));
+        ASSERT_EQ (compact.size (), (size_t)0);
+        ASSERT_EQ (tree.check_balance (), true);
+    }
+}
+
+/**
+ * @brief   Test that repeated values in a sorted range are only kept once
+ *
+ */
+TEST (Assign, sorted_range_duplicates)
+{
+    std::vector<std::string>    values  {"a", "a", "b", "c", "c", "c", "d", "e", "e"};
+    AgAVLTree<std::string>      tree    (values.begin (), values.end ());
+
+    ASSERT_EQ (tree.size (), (size_t)5);
+    ASSERT_EQ (tree.check_balance (), true);
+
+    std::string                 res;
+
+    for (auto & v : tree) {
+        res += v;
+    }
+    ASSERT_EQ (res, "abcde");
+}
+
+/**
+ * @brief   Test that an unsorted range is inserted value by value, and that assign replaces previous contents
+ *
+ */
+TEST (Assign, unsorted_range)
+{
+    std::vector<int32_t>    values;
+    std::set<int32_t>       ref;
+
+    std::mt19937                            gen     {7};
+    std::uniform_int_distribution<int32_t>  dist    {0, 500};
+
+    for (int32_t i = 0; i < 1000; ++i) {
+        values.push_back (dist (gen));
+        ref.insert (values.back ());
+    }
+
+    AgAVLTree<int32_t>      tree;
+
+    insert (tree, 1000, 2000, 3000);
+
+    ASSERT_EQ (tree.assign (values.begin (), values.end ()), true);
+    ASSERT_EQ (tree.size (), ref.size ());
+    ASSERT_EQ (tree.check_balance (), true);
+
+    auto    it  {ref.begin ()};
+
+    for (auto v : tree) {
+        ASSERT_EQ (v, *it++);
+    }
+
+    // assigning an empty range empties the tree
+    ASSERT_EQ (tree.assign (values.end (), values.end ()), true);
+    ASSERT_EQ (tree.size (), (size_t)0);
+    ASSERT_EQ (tree.begin (), tree.end ());
+}
+
+/**
+ * @brief   Test inserting batches of random values (with repeats, and values already in the tree) against std::set
+ *
+ */
+TEST (Batch, insert_batch_random)
+{
+    AgAVLTree<int32_t>                      tree;
+    AgAVLTreeCompact<int32_t>               compact;
+    std::set<int32_t>                       ref;
+
+    std::mt19937                            gen     {11};
+    std::uniform_int_distribution<int32_t>  dist    {0, 20'000};
+
+    // an empty batch inserts nothing
+    std::vector<int32_t>                    batch;
+    ASSERT_EQ (tree.insert_batch (batch.begin (), batch.end ()), (size_t)0);
+
+    // batches of very different sizes, so that trees of very different heights are merged
+    for (int32_t sz : {1, 1000, 3, 10, 5000, 1, 200, 40, 12'000, 7}) {
+
+        batch.clear ();
+        for (int32_t i = 0; i < sz; ++i) {
+            batch.push_back (dist (gen));
+        }
+
+        size_t  before  {ref.size ()};
+        ref.insert (batch.begin (), batch.end ());
+
+        ASSERT_EQ (tree.insert_batch (batch.begin (), batch.end ()), ref.size () - before);
+        ASSERT_EQ (compact.insert_batch (batch.begin (), batch.end ()), ref.size () - before);
+        ASSERT_EQ (tree.size (), ref.size ());
+        ASSERT_EQ (compact.size (), ref.size ());
+        ASSERT_EQ (tree.check_balance (), true);
+        ASSERT_EQ (compact.check_balance (), true);
+
+        auto    it  {ref.begin ()};
+
+        for (auto v : tree) {
+            ASSERT_EQ (v, *it++);
+        }
+        it = ref.begin ();
+        for (auto v : compact) {
+            ASSERT_EQ (v, *it++);
+        }
+
+        // single insertions and erasures must work as usual on the merged tree
+        ASSERT_EQ (tree.erase (*ref.begin ()), true);
+        ASSERT_EQ (compact.erase (*ref.begin ()), true);
+        ref.erase (ref.begin ());
+        ASSERT_EQ (tree.check_balance (), true);
+    }
+}
+
+bool
+first_lt (const std::pair<int32_t, int32_t> & a, const std::pair<int32_t, int32_t> & b)
+{
+    return a.first < b.first;
+}
+
+bool
+first_eq (const std::pair<int32_t, int32_t> & a, const std::pair<int32_t, int32_t> & b)
+{
+    return a.first == b.first;
+}
+
+/**
+ * @brief   Test that elements already in the tree are kept over equal values in a batch (the same as for single insertions)
+ *
+ */
+TEST (Batch, insert_batch_keeps_existing)
+{
+    AgAVLTree<std::pair<int32_t, int32_t>, first_lt, first_eq>  tree;
+
+    for (int32_t v = 0; v < 100; v += 2) {
+        ASSERT_EQ (tree.insert ({v, 0}), true);
+    }
+
+    std::vector<std::pair<int32_t, int32_t>>    batch;
+
+    for (int32_t v = 99; v >= 0; --v) {
+        batch.push_back ({v, 1});
+    }
+    batch.push_back ({1, 2});
+
+    ASSERT_EQ (tree.insert_batch (batch.begin (), batch.end ()), (size_t)50);
+    ASSERT_EQ (tree.size (), (size_t)100);
+    ASSERT_EQ (tree.check_balance (), true);
+
+    int32_t expected    {0};
+
+    for (auto & [key, tag] : tree) {
+        ASSERT_EQ (key, expected++);
+        ASSERT_EQ (tag, key % 2);
+    }
+}
+
+/**
+ * @brief   Test batched searches against single searches, for values present in and missing from the tree
+ *
+ */
+TEST (Batch, find_batch)
+{
+    AgAVLTree<int32_t>                      tree;
+    AgAVLTreeCompact<int32_t>               compact;
+
+    std::vector<int32_t>                    keys;
+    std::vector<bool>                       found;
+    std::vector<AgAVLTree<int32_t>::iterator>   its;
+
+    // searching an empty tree (or for no values) finds nothing
+    keys = {1, 2, 3};
+    tree.exists_batch (keys.begin (), keys.end (), std::back_inserter (found));
+    ASSERT_EQ (found, std::vector<bool> (3, false));
+    ASSERT_EQ (tree.exists_batch (keys.end (), keys.end (), found.begin ()), found.begin ());
+
+    for (int32_t v = 0; v < 5000; v += 3) {
+        tree.insert (v);
+        compact.insert (v);
+    }
+
+    // a number of values which is not a multiple of the size of a group, in no particular order
+    std::mt19937                            gen     {5};
+    std::uniform_int_distribution<int32_t>  dist    {-10, 5010};
+
+    keys.clear ();
+    for (int32_t i = 0; i < 1001; ++i) {
+        keys.push_back (dist (gen));
+    }
+
+    found.clear ();
+    tree.exists_batch (keys.begin (), keys.end (), std::back_inserter (found));
+    tree.find_batch (keys.begin (), keys.end (), std::back_inserter (its));
+
+    ASSERT_EQ (found.size (), keys.size ());
+    ASSERT_EQ (its.size (), keys.size ());
+
+    for (size_t i = 0; i < keys.size (); ++i) {
+        ASSERT_EQ (found[i], tree.exists (keys[i]));
+        ASSERT_EQ (its[i], tree.find (keys[i]));
+    }
+
+    found.clear ();
+    compact.exists_batch (keys.begin (), keys.end (), std::back_inserter (found));
+
+    for (size_t i = 0; i < keys.size (); ++i) {
+        ASSERT_EQ (found[i], compact.exists (keys[i]));
+    }
+}
+
+/**
+ * @brief   Test splitting a tree and joining the two halves back, modifying both in between
+ *
+ */
+TEST (Split, split_and_join)
+{
+    AgAVLTree<int32_t>  tree;
+
+    for (int32_t v = 0; v < 10'000; ++v) {
+        tree.insert (v);
+    }
+
+    // the element equal to the value goes to the new tree
+    AgAVLTree<int32_t>  right   = tree.split (6'000);
+
+    ASSERT_EQ (tree.size (), (size_t)6'000);
+    ASSERT_EQ (right.size (), (size_t)4'000);
+    ASSERT_EQ (tree.check_balance (), true);
+    ASSERT_EQ (right.check_balance (), true);
+    ASSERT_EQ (*tree.rbegin (), 5'999);
+    ASSERT_EQ (*right.begin (), 6'000);
+
+    // each tree allocates from (and frees into) its own pool
+    for (int32_t v = 0; v < 1'000; ++v) {
+        ASSERT_EQ (tree.erase (v), true);
+        ASSERT_EQ (right.insert (v + 10'000), true);
+    }
+    ASSERT_EQ (tree.size (), (size_t)5'000);
+    ASSERT_EQ (right.size (), (size_t)5'000);
+
+    // overlapping trees can not be joined, and are left as they were
+    ASSERT_EQ (right.join (std::move (tree)), false);
+    ASSERT_EQ (tree.size (), (size_t)5'000);
+    ASSERT_EQ (right.size (), (size_t)5'000);
+
+    ASSERT_EQ (tree.join (std::move (right)), true);
+    ASSERT_EQ (tree.size (), (size_t)10'000);
+    ASSERT_EQ (right.size (), (size_t)0);
+    ASSERT_EQ (tree.check_balance (), true);
+
+    int32_t             expected    {1'000};
+    for (auto v : tree) {
+        ASSERT_EQ (v, expected++);
+    }
+
+    // splitting below or above all elements moves everything or nothing
+    AgAVLTree<int32_t>  none        = tree.split (20'000);
+    ASSERT_EQ (none.size (), (size_t)0);
+    ASSERT_EQ (tree.size (), (size_t)10'000);
+
+    AgAVLTree<int32_t>  all         = tree.split (0);
+    ASSERT_EQ (all.size (), (size_t)10'000);
+    ASSERT_EQ (tree.size (), (size_t)0);
+    ASSERT_EQ (tree.begin (), tree.end ());
+    ASSERT_EQ (all.check_balance (), true);
+}
+
+/**
+ * @brief                       Splits a tree of 0 to (pCount - 1) at pAt, then checks the sizes right after the split and modifies and destroys both parts on different threads
+ *
+ * @tparam tree_t               Type of tree to test
+ *
+ * @param pCount                Number of elements in the tree
+ * @param pAt                   Value to split the tree at
+ */
+template <typename tree_t>
+void
+check_split_independent (int32_t pCount, int32_t pAt)
+{
+    tree_t                      left;
+
+    for (int32_t v = 0; v < pCount; ++v) {
+        left.insert (v);
+    }
+
+    tree_t                      right   = left.split (pAt);
+
+    // the sizes are exact without counting anything afterwards
+    ASSERT_EQ (left.size (), (size_t)pAt);
+    ASSERT_EQ (right.size (), (size_t)(pCount - pAt));
+    ASSERT_EQ (left.check_balance (), true);
+    ASSERT_EQ (right.check_balance (), true);
+
+    bool                        okLeft  {true};
+    bool                        okRight {true};
+
+    auto                        churn   = [] (tree_t tree, int32_t pLo, int32_t pHi, bool & pOk) {
+        for (int32_t v = pLo; v < pHi; v += 2) {
+            pOk &= tree.erase (v);
+        }
+        for (int32_t v = pLo; v < pHi; v += 2) {
+            pOk &= tree.insert (v + 100'000);
+        }
+        pOk &= tree.size () == (size_t)(pHi - pLo);
+        pOk &= tree.check_balance ();
+    };
+
+    // the trees are moved into the threads and destroyed there
+    std::thread                 thrLeft     (churn, std::move (left), 0, pAt, std::ref (okLeft));
+    std::thread                 thrRight    (churn, std::move (right), pAt, pCount, std::ref (okRight));
+
+    thrLeft.join ();
+    thrRight.join ();
+
+    ASSERT_EQ (okLeft, true);
+    ASSERT_EQ (okRight, true);
+}
+
+/**
+ * @brief   Test that the two parts of a split tree do not share anything, and that their sizes are known immediately
+ *
+ */
+TEST (Split, split_independent)
+{
+    // the smaller part may be either side of the split
+    check_split_independent<AgAVLTree<int32_t>> (20'000, 3'000);
+    check_split_independent<AgAVLTree<int32_t>> (20'000, 17'000);
+    check_split_independent<AgAVLTreeCompact<int32_t>> (20'000, 3'000);
+    check_split_independent<AgAVLTreeCompact<int32_t>> (20'000, 17'000);
+    check_split_independent<AgAVLTreeCounted<int32_t>> (20'000, 3'000);
+    check_split_independent<AgAVLTreeCounted<int32_t>> (20'000, 17'000);
+
+    // a compact tree split and joined back holds all its elements
+    AgAVLTreeCompact<int32_t>   tree;
+
+    for (int32_t v = 0; v < 5'000; ++v) {
+        tree.insert (v);
+    }
+
+    AgAVLTreeCompact<int32_t>   right   = tree.split (1'000);
+
+    ASSERT_EQ (right.insert (4'999), false);
+    ASSERT_EQ (tree.join (std::move (right)), true);
+    ASSERT_EQ (tree.size (), (size_t)5'000);
+    ASSERT_EQ (tree.check_balance (), true);
+
+    int32_t                     expected    {0};
+    for (auto v : tree) {
+        ASSERT_EQ (v, expected++);
+    }
+}
+
+/**
+ * @brief   Test joining trees which do not share a pool, whose nodes are either taken over (along with the chunks holding them) or copied
+ *
+ */
+TEST (Split, join_separate_pools)
+{
+    using tree_t                = AgAVLTree<int32_t, ag_avl_default_comp<int32_t>, ag_avl_default_equals<int32_t>, counting_allocator<int32_t>>;
+
+    int64_t                     bytesA  {0};
+    int64_t                     bytesB  {0};
+
+    {
+        tree_t                  left    (counting_allocator<int32_t> {&bytesA});
+        tree_t                  mid     (counting_allocator<int32_t> {&bytesA});
+        tree_t                  right   (counting_allocator<int32_t> {&bytesB});
+
+        for (int32_t v = 0; v < 3'000; ++v) {
+            left.insert (v);
+            mid.insert (v + 3'000);
+            right.insert (v + 6'000);
+        }
+
+        // with equal allocators, the chunks of the other tree are taken over without allocating anything (only its empty pool is freed)
+        int64_t                 before  {bytesA};
+
+        ASSERT_EQ (left.join (std::move (mid)), true);
+        ASSERT_LE (bytesA, before);
+        ASSERT_GT (bytesA, before - 1'024);
+
+        // with different allocators, the elements are copied and the other tree gives back all its memory
+        ASSERT_EQ (left.join (std::move (right)), true);
+        ASSERT_EQ (bytesB, 0);
+        ASSERT_GT (bytesA, before);
+
+        ASSERT_EQ (left.size (), (size_t)9'000);
+        ASSERT_EQ (mid.size (), (size_t)0);
+        ASSERT_EQ (right.size (), (size_t)0);
+        ASSERT_EQ (left.check_balance (), true);
+
+        int32_t                 expected    {0};
+        for (auto v : left) {
+            ASSERT_EQ (v, expected++);
+        }
+    }
+    ASSERT_EQ (bytesA, 0);
+
+    // arenas can not be merged, so compact trees are always joined by copying
+    AgAVLTreeCompact<int32_t>   small;
+    AgAVLTreeCompact<int32_t>   large;
+
+    for (int32_t v = 0; v < 1'000; ++v) {
+        small.insert (v);
+        large.insert (v + 1'000);
+    }
+    ASSERT_EQ (small.join (std::move (large)), true);
+    ASSERT_EQ (small.size (), (size_t)2'000);
+    ASSERT_EQ (large.size (), (size_t)0);
+    ASSERT_EQ (small.check_balance (), true);
+    ASSERT_EQ (*small.rbegin (), 1'999);
+}
+
+/**
+ * @brief                       Checks the union, intersection and difference of two trees of random values against those of std::set
+ *
+ * @tparam tree_t               Type of tree to test
+ *
+ * @param pThreads              Number of threads to run the operations on
+ */
+template <typename tree_t>
+void
+check_set_ops (size_t pThreads)
+{
+    std::mt19937                gen (pThreads);
+    std::set<int32_t>           a;
+    std::set<int32_t>           b;
+
+    // large enough for the recursions to fork several times
+    for (int32_t i = 0; i < 150'000; ++i) {
+        a.insert ((int32_t)(gen () % 300'000));
+        b.insert ((int32_t)(gen () % 300'000));
+    }
+
+    tree_t                      treeA   (a.begin (), a.end ());
+    tree_t                      treeB   (b.begin (), b.end ());
+
+    std::vector<int32_t>        expected;
+    std::vector<int32_t>        got;
+
+    tree_t                      uni     {treeA};
+    tree_t                      other   {treeB};
+
+    std::set_union (a.begin (), a.end (), b.begin (), b.end (), std::back_inserter (expected));
+
+    ASSERT_EQ (uni.set_union (std::move (other), pThreads), expected.size () - a.size ());
+    ASSERT_EQ (uni.size (), expected.size ());
+    ASSERT_EQ (other.size (), (size_t)0);
+    ASSERT_EQ (uni.check_balance (), true);
+
+    got.clear ();
+    for (auto v : uni) {
+        got.push_back (v);
+    }
+    ASSERT_EQ (got, expected);
+
+    tree_t                      inter   {treeA};
+
+    expected.clear ();
+    std::set_intersection (a.begin (), a.end (), b.begin (), b.end (), std::back_inserter (expected));
+
+    ASSERT_EQ (inter.set_intersection (treeB, pThreads), a.size () - expected.size ());
+    ASSERT_EQ (inter.size (), expected.size ());
+    ASSERT_EQ (inter.check_balance (), true);
+
+    got.clear ();
+    for (auto v : inter) {
+        got.push_back (v);
+    }
+    ASSERT_EQ (got, expected);
+
+    tree_t                      diff    {treeA};
+
+    expected.clear ();
+    std::set_difference (a.begin (), a.end (), b.begin (), b.end (), std::back_inserter (expected));
+
+    ASSERT_EQ (diff.set_difference (treeB, pThreads), a.size () - expected.size ());
+    ASSERT_EQ (diff.size (), expected.size ());
+    ASSERT_EQ (diff.check_balance (), true);
+
+    got.clear ();
+    for (auto v : diff) {
+        got.push_back (v);
+    }
+    ASSERT_EQ (got, expected);
+
+    // the other tree is only read
+    ASSERT_EQ (treeB.size (), b.size ());
+    ASSERT_EQ (treeB.check_balance (), true);
+}
+
+/**
+ * @brief   Test union, intersection and difference of trees on a single thread and on several threads
+ *
+ */
+TEST (SetOps, against_std_set)
+{
+    check_set_ops<AgAVLTree<int32_t>> (1);
+    check_set_ops<AgAVLTree<int32_t>> (4);
+    check_set_ops<AgAVLTreeCompact<int32_t>> (1);
+    check_set_ops<AgAVLTreeCompact<int32_t>> (4);
+    check_set_ops<AgAVLTreeCounted<int32_t>> (4);
+}
+
+/**
+ * @brief   Test that the set operations never start more threads than they are given (less the calling thread)
+ *
+ */
+TEST (SetOps, thread_limit)
+{
+    using tree_t                = AgAVLTree<int32_t>;
+
+    std::vector<int32_t>        evens;
+    std::vector<int32_t>        odds;
+
+    // large enough for the recursions to fork at every level they are allowed to
+    for (int32_t v = 0; v < 400'000; v += 2) {
+        evens.push_back (v);
+        odds.push_back (v + 1);
+    }
+
+    for (size_t threads = 1; threads <= 8; ++threads) {
+
+        tree_t                  a       (evens.begin (), evens.end ());
+        tree_t                  b       (odds.begin (), odds.end ());
+        tree_t                  c       (evens.begin (), evens.end ());
+
+        tree_t::dbg_forks = 0;
+        ASSERT_EQ (a.set_intersection (c, threads), (size_t)0);
+        ASSERT_LE (tree_t::dbg_forks, (int32_t)threads - 1);
+
+        tree_t::dbg_forks = 0;
+        ASSERT_EQ (a.set_difference (b, threads), (size_t)0);
+        ASSERT_LE (tree_t::dbg_forks, (int32_t)threads - 1);
+
+        tree_t::dbg_forks = 0;
+        ASSERT_EQ (a.set_union (std::move (b), threads), odds.size ());
+        ASSERT_LE (tree_t::dbg_forks, (int32_t)threads - 1);
+        ASSERT_EQ (a.size (), evens.size () + odds.size ());
+        ASSERT_EQ (a.check_balance (), true);
+
+        // a number of threads which is not a power of two is rounded down to one
+        if (threads == 3) {
+            ASSERT_GT (tree_t::dbg_forks, 0);
+        }
+    }
+}
+
+/**
+ * @brief   Test set operations with empty trees, with the tree itself, and between trees sharing a pool or using different allocators
+ *
+ */
+TEST (SetOps, special_cases)
+{
+    AgAVLTree<int32_t>  tree;
+    AgAVLTree<int32_t>  empty;
+
+    for (int32_t v = 0; v < 1'000; ++v) {
+        tree.insert (v);
+    }
+
+    ASSERT_EQ (tree.set_union (std::move (empty)), (size_t)0);
+    ASSERT_EQ (tree.set_difference (empty), (size_t)0);
+    ASSERT_EQ (tree.set_intersection (tree), (size_t)0);
+    ASSERT_EQ (tree.size (), (size_t)1'000);
+
+    ASSERT_EQ (empty.set_intersection (tree), (size_t)0);
+    ASSERT_EQ (empty.set_union (AgAVLTree<int32_t> {tree}), (size_t)1'000);
+    ASSERT_EQ (empty.size (), (size_t)1'000);
+
+    ASSERT_EQ (empty.set_intersection (AgAVLTree<int32_t> {}), (size_t)1'000);
+    ASSERT_EQ (empty.size (), (size_t)0);
+    ASSERT_EQ (empty.begin (), empty.end ());
+
+    // the two halves of a split share their pool, and are united without moving any node
+    AgAVLTree<int32_t>  right   = tree.split (500);
+
+    ASSERT_EQ (right.insert (100), true);
+    ASSERT_EQ (tree.set_union (std::move (right), 4), (size_t)500);
+    ASSERT_EQ (tree.size (), (size_t)1'000);
+    ASSERT_EQ (tree.check_balance (), true);
+
+    // with different allocators, the elements of the other tree are copied
+    std::pmr::monotonic_buffer_resource     res;
+    AgAVLTreePmr<int32_t>                   pmr     {&res};
+    AgAVLTreePmr<int32_t>                   odd     {std::pmr::new_delete_resource ()};
+
+    for (int32_t v = 0; v < 2'000; v += 2) {
+        pmr.insert (v);
+        odd.insert (v + 1);
+    }
+    ASSERT_EQ (pmr.set_union (std::move (odd)), (size_t)1'000);
+    ASSERT_EQ (pmr.size (), (size_t)2'000);
+    ASSERT_EQ (odd.size (), (size_t)0);
+    ASSERT_EQ (pmr.check_balance (), true);
+
+    int32_t             expected    {0};
+    for (auto v : pmr) {
+        ASSERT_EQ (v, expected++);
+    }
+
+    ASSERT_EQ (tree.set_difference (tree), (size_t)1'000);
+    ASSERT_EQ (tree.size (), (size_t)0);
+}
+
+/**
+ * @brief   Test merging trees with disjoint and overlapping ranges, reusing the nodes of the merged tree without allocating any
+ *
+ */
+TEST (SetOps, merge)
+{
+    using tree_t                = AgAVLTree<int32_t, ag_avl_default_comp<int32_t>, ag_avl_default_equals<int32_t>, counting_allocator<int32_t>>;
+
+    int64_t                     bytes   {0};
+
+    {
+        tree_t                  tree    (counting_allocator<int32_t> {&bytes});
+        tree_t                  low     (counting_allocator<int32_t> {&bytes});
+        tree_t                  high    (counting_allocator<int32_t> {&bytes});
+        tree_t                  mixed   (counting_allocator<int32_t> {&bytes});
+
+        for (int32_t v = 0; v < 2'000; ++v) {
+            tree.insert (v + 2'000);
+            low.insert (v);
+            high.insert (v + 4'000);
+        }
+
+        // every third value is already present, and is dropped
+        for (int32_t v = 0; v < 6'000; v += 3) {
+            mixed.insert (v + 1);
+            mixed.insert (v + 2);
+        }
+
+        int64_t                 before  {bytes};
+
+        // disjoint ranges on either side are concatenated
+        ASSERT_EQ (tree.merge (std::move (high)), (size_t)2'000);
+        ASSERT_EQ (tree.merge (std::move (low)), (size_t)2'000);
+        ASSERT_EQ (tree.size (), (size_t)6'000);
+        ASSERT_EQ (low.size (), (size_t)0);
+        ASSERT_EQ (high.size (), (size_t)0);
+        ASSERT_EQ (tree.check_balance (), true);
+
+        for (int32_t v = 0; v < 6'000; v += 3) {
+            ASSERT_EQ (tree.erase (v), true);
+        }
+
+        ASSERT_EQ (tree.merge (std::move (mixed)), (size_t)0);
+        ASSERT_EQ (tree.size (), (size_t)4'000);
+        ASSERT_EQ (mixed.size (), (size_t)0);
+        ASSERT_EQ (tree.check_balance (), true);
+
+        // the nodes (and chunks) of the merged trees were taken over, only their empty pools were freed
+        ASSERT_LE (bytes, before);
+
+        ASSERT_EQ (mixed.insert (0), true);
+        ASSERT_EQ (mixed.insert (4'500), true);
+
+        before                  = bytes;
+
+        ASSERT_EQ (tree.merge (std::move (mixed)), (size_t)2);
+        ASSERT_EQ (tree.size (), (size_t)4'002);
+        ASSERT_EQ (tree.check_balance (), true);
+        ASSERT_LE (bytes, before);
+
+        for (int32_t v = 0; v < 6'000; ++v) {
+            ASSERT_EQ (tree.exists (v), (v % 3 != 0 || v == 0 || v == 4'500));
+        }
+    }
+    ASSERT_EQ (bytes, 0);
+}
+
+/**
+ * @brief                       Checks select, rank and count_range of a counted tree against the sorted values it should hold
+ *
+ * @param pTree                 Reference to the tree
+ * @param pValues               The values the tree should hold (sorted)
+ * @param pRange                Values are drawn from [0, pRange)
+ */
+template <typename tree_t>
+void
+check_order_statistics (const tree_t & pTree, const std::vector<int32_t> & pValues, int32_t pRange)
+{
+    ASSERT_EQ (pTree.size (), pValues.size ());
+
+    for (size_t i = 0; i < pValues.size (); ++i) {
+        ASSERT_EQ (*pTree.select (i), pValues[i]);
+    }
+    ASSERT_EQ (pTree.select (pValues.size ()) == pTree.end (), true);
+
+    for (int32_t lo = -1; lo <= pRange; lo += 7) {
+
+        auto                    first   {std::lower_bound (pValues.begin (), pValues.end (), lo)};
+
+        ASSERT_EQ (pTree.rank (lo), (size_t)(first - pValues.begin ()));
+
+        for (int32_t hi = lo - 3; hi <= pRange; hi += 13) {
+            auto                last    {std::upper_bound (pValues.begin (), pValues.end (), hi)};
+            size_t              cnt     {(hi < lo) ? (0) : ((size_t)(last - first))};
+
+            ASSERT_EQ (pTree.count_range (lo, hi), cnt);
+        }
+    }
+}
+
+/**
+ * @brief                       Inserts and erases random values in a counted tree, checking the order statistics after every round
+ */
+template <typename tree_t>
+void
+check_counted_tree ()
+{
+    std::mt19937                gen (20);
+    std::set<int32_t>           values;
+    tree_t                      tree;
+
+    constexpr   int32_t         range   {2'000};
+
+    for (int32_t round = 0; round < 20; ++round) {
+
+        for (int32_t i = 0; i < 200; ++i) {
+            int32_t             v       {(int32_t)(gen () % range)};
+            ASSERT_EQ (tree.insert (v), values.insert (v).second);
+        }
+        for (int32_t i = 0; i < 100; ++i) {
+            int32_t             v       {(int32_t)(gen () % range)};
+            ASSERT_EQ (tree.erase (v), values.erase (v) == 1);
+        }
+
+        // the counts are checked at every node, and must match the actual positions of the values
+        ASSERT_EQ (tree.check_balance (), true);
+        check_order_statistics (tree, std::vector<int32_t> (values.begin (), values.end ()), range);
+    }
+}
+
+/**
+ * @brief   Test finding elements by position, and counting elements below a value and in ranges, after random insertions and erasures
+ *
+ */
+TEST (OrderStatistics, select_rank_count_range)
+{
+    check_counted_tree<AgAVLTreeCounted<int32_t>> ();
+    check_counted_tree<AgAVLTreeCounted<int32_t, ag_avl_default_comp<int32_t>, ag_avl_default_equals<int32_t>, std::allocator<int32_t>, true>> ();
+
+    AgAVLTreeCounted<int32_t>   tree;
+
+    ASSERT_EQ (tree.select (0) == tree.end (), true);
+    ASSERT_EQ (tree.rank (5), (size_t)0);
+    ASSERT_EQ (tree.count_range (0, 10), (size_t)0);
+
+    insert (tree, 10, 20, 30);
+
+    ASSERT_EQ (*tree.select (1), 20);
+    ASSERT_EQ (tree.rank (20), (size_t)1);
+    ASSERT_EQ (tree.rank (21), (size_t)2);
+    ASSERT_EQ (tree.count_range (10, 30), (size_t)3);
+    ASSERT_EQ (tree.count_range (11, 29), (size_t)1);
+    ASSERT_EQ (tree.count_range (30, 10), (size_t)0);
+}
+
+/**
+ * @brief   Test that the counts are kept up to date by the operations which move whole subtrees around
+ *
+ */
+TEST (OrderStatistics, split_join_and_batches)
+{
+    using tree_t                = AgAVLTreeCounted<int32_t>;
+
+    std::vector<int32_t>        values;
+
+    for (int32_t v = 0; v < 1'000; ++v) {
+        values.push_back (2 * v);
+    }
+
+    tree_t                      tree    (values.begin (), values.end ());
+
+    ASSERT_EQ (tree.check_balance (), true);
+    check_order_statistics (tree, values, 2'000);
+
+    // both halves of a split know their sizes from their roots
+    tree_t                      right   {tree.split (1'001)};
+    std::vector<int32_t>        low     (values.begin (), values.begin () + 501);
+    std::vector<int32_t>        high    (values.begin () + 501, values.end ());
+
+    ASSERT_EQ (tree.check_balance (), true);
+    ASSERT_EQ (right.check_balance (), true);
+    check_order_statistics (tree, low, 2'000);
+    check_order_statistics (right, high, 2'000);
+
+    ASSERT_EQ (tree.join (std::move (right)), true);
+    ASSERT_EQ (tree.check_balance (), true);
+    check_order_statistics (tree, values, 2'000);
+
+    // odd values are added in a batch, with hints, and by a union
+    std::vector<int32_t>        odd;
+
+    for (int32_t v = 1; v < 600; v += 2) {
+        odd.push_back (v);
+    }
+    ASSERT_EQ (tree.insert_batch (odd.begin (), odd.end ()), odd.size ());
+
+    for (int32_t v = 601; v < 1'200; v += 2) {
+        tree.insert (tree.find (v + 1), v);
+        odd.push_back (v);
+    }
+
+    tree_t                      other;
+
+    for (int32_t v = 1'201; v < 2'000; v += 2) {
+        other.insert (v);
+        odd.push_back (v);
+    }
+    tree.set_union (std::move (other));
+
+    values.insert (values.end (), odd.begin (), odd.end ());
+    std::sort (values.begin (), values.end ());
+
+    ASSERT_EQ (tree.check_balance (), true);
+    check_order_statistics (tree, values, 2'000);
+
+    // a range is cut out
+    ASSERT_EQ (tree.erase_range (500, 1'500), (size_t)1'000);
+    values.erase (values.begin () + 500, values.begin () + 1'500);
+
+    ASSERT_EQ (tree.check_balance (), true);
+    check_order_statistics (tree, values, 2'000);
+
+    // a copy keeps the counts of the nodes it copies
+    tree_t                      cpy     (tree, 4);
+
+    ASSERT_EQ (cpy.check_balance (), true);
+    check_order_statistics (cpy, values, 2'000);
+}
+
+/**
+ * @brief                       Augmentation policy which joins the values of a range into a string (in order), to check the order of combination
+ */
+struct JoinedValues {
+
+    using summary_t             = std::string;
+
+    static summary_t identity ()                                            { return ""; }
+    static summary_t of       (const int32_t & pVal)                        { return std::to_string (pVal) + ","; }
+    static summary_t combine  (const summary_t & pA, const summary_t & pB)  { return pA + pB; }
+};
+
+/**
+ * @brief                       Combines the summaries of the values in [pLo, pHi] one by one
+ *
+ * @param pValues               The values (sorted)
+ * @param pLo                   The smallest value to be included
+ * @param pHi                   The largest value to be included
+ */
+template <typename policy_t>
+typename policy_t::summary_t
+fold_range (const std::vector<int32_t> & pValues, int32_t pLo, int32_t pHi)
+{
+    typename policy_t::summary_t    res     {policy_t::identity ()};
+
+    for (auto v : pValues) {
+        if (pLo <= v && v <= pHi) {
+            res                 = policy_t::combine (res, policy_t::of (v));
+        }
+    }
+    return res;
+}
+
+/**
+ * @brief                       Inserts and erases random values in an augmented tree, checking the aggregates of many ranges after every round
+ */
+template <typename tree_t, typename policy_t>
+void
+check_augmented_tree ()
+{
+    std::mt19937                gen (21);
+    std::set<int32_t>           values;
+    tree_t                      tree;
+
+    constexpr   int32_t         range   {1'000};
+
+    for (int32_t round = 0; round < 10; ++round) {
+
+        for (int32_t i = 0; i < 150; ++i) {
+            int32_t             v       {(int32_t)(gen () % range) - range / 2};
+            ASSERT_EQ (tree.insert (v), values.insert (v).second);
+        }
+        for (int32_t i = 0; i < 75; ++i) {
+            int32_t             v       {(int32_t)(gen () % range) - range / 2};
+            ASSERT_EQ (tree.erase (v), values.erase (v) == 1);
+        }
+
+        ASSERT_EQ (tree.check_balance (), true);
+
+        std::vector<int32_t>    sorted  (values.begin (), values.end ());
+
+        for (int32_t lo = -range / 2 - 1; lo <= range / 2; lo += 17) {
+            for (int32_t hi = lo - 5; hi <= range / 2; hi += 29) {
+                ASSERT_EQ (tree.aggregate (lo, hi), fold_range<policy_t> (sorted, lo, hi));
+            }
+        }
+    }
+}
+
+/**
+ * @brief   Test aggregating ranges with the given policies, after random insertions and erasures
+ *
+ */
+TEST (Aggregate, policies_against_fold)
+{
+    using sum_t                 = AgAVLSum<int32_t, int64_t>;
+
+    check_augmented_tree<AgAVLTreeAugmented<int32_t, sum_t>, sum_t> ();
+    check_augmented_tree<AgAVLTreeAugmented<int32_t, AgAVLMin<int32_t>>, AgAVLMin<int32_t>> ();
+    check_augmented_tree<AgAVLTreeAugmented<int32_t, AgAVLMax<int32_t>>, AgAVLMax<int32_t>> ();
+    check_augmented_tree<AgAVLTreeAugmented<int32_t, JoinedValues>, JoinedValues> ();
+
+    // compact and counted trees keep summaries as well
+    check_augmented_tree<AgAVLTreeAugmented<int32_t, sum_t, ag_avl_default_comp<int32_t>, ag_avl_default_equals<int32_t>, std::allocator<int32_t>, true, true>, sum_t> ();
+
+    AgAVLTreeAugmented<int32_t, sum_t>  tree;
+
+    ASSERT_EQ (tree.aggregate (0, 100), 0);
+
+    insert (tree, 10, 20, 30);
+
+    ASSERT_EQ (tree.aggregate (10, 30), 60);
+    ASSERT_EQ (tree.aggregate (11, 30), 50);
+    ASSERT_EQ (tree.aggregate (15, 25), 20);
+    ASSERT_EQ (tree.aggregate (31, 40), 0);
+    ASSERT_EQ (tree.aggregate (30, 10), 0);
+
+    // any other policy is folded over the range, also in trees without summaries
+    AgAVLTree<int32_t>          plain;
+
+    insert (plain, 3, 1, 2);
+
+    ASSERT_EQ (tree.aggregate<JoinedValues> (0, 25), "10,20,");
+    ASSERT_EQ (plain.aggregate<sum_t> (1, 2), 3);
+    ASSERT_EQ (plain.aggregate<JoinedValues> (0, 5), "1,2,3,");
+}
+
+/**
+ * @brief                       A record ordered by its key, which carries a weight
+ */
+struct Weighted {
+
+    int32_t     mKey;
+    int32_t     mWeight;
+
+    friend bool operator<  (const Weighted & pA, const Weighted & pB) { return pA.mKey < pB.mKey; }
+    friend bool operator== (const Weighted & pA, const Weighted & pB) { return pA.mKey == pB.mKey; }
+};
+
+/**
+ * @brief                       Returns the weight of a record
+ */
+int64_t
+weight_of (const Weighted & pVal)
+{
+    return pVal.mWeight;
+}
+
+/**
+ * @brief   Test that the summaries (of a projection of the values) are kept up to date by the operations which move whole subtrees around
+ *
+ */
+TEST (Aggregate, projection_split_join_and_set_ops)
+{
+    using tree_t                = AgAVLTreeAugmented<Weighted, AgAVLSum<Weighted, int64_t, weight_of>>;
+
+    std::vector<Weighted>       values;
+    int64_t                     total   {0};
+
+    for (int32_t k = 0; k < 1'000; ++k) {
+        values.push_back ({k, k % 7});
+        total                   += k % 7;
+    }
+
+    tree_t                      tree    (values.begin (), values.end ());
+
+    ASSERT_EQ (tree.check_balance (), true);
+    ASSERT_EQ (tree.aggregate ({0, 0}, {999, 0}), total);
+
+    // weight of the records with keys at or above a threshold
+    int64_t                     above   {0};
+
+    for (int32_t k = 600; k < 1'000; ++k) {
+        above                   += k % 7;
+    }
+    ASSERT_EQ (tree.aggregate ({600, 0}, {INT32_MAX, 0}), above);
+
+    tree_t                      right   {tree.split ({600, 0})};
+
+    ASSERT_EQ (tree.check_balance (), true);
+    ASSERT_EQ (right.check_balance (), true);
+    ASSERT_EQ (tree.aggregate ({0, 0}, {INT32_MAX, 0}), total - above);
+    ASSERT_EQ (right.aggregate ({0, 0}, {INT32_MAX, 0}), above);
+
+    ASSERT_EQ (tree.join (std::move (right)), true);
+    ASSERT_EQ (tree.aggregate ({0, 0}, {INT32_MAX, 0}), total);
+
+    // records of weight 100 are added by a batch and a union, and then the records in [100, 200) are erased
+    std::vector<Weighted>       batch;
+    tree_t                      other;
+
+    for (int32_t k = 1'000; k < 1'100; ++k) {
+        batch.push_back ({k, 100});
+        other.insert ({k + 100, 100});
+    }
+    ASSERT_EQ (tree.insert_batch (batch.begin (), batch.end ()), batch.size ());
+    ASSERT_EQ (tree.set_union (std::move (other), 2), (size_t)100);
+
+    int64_t                     erased  {0};
+
+    for (int32_t k = 100; k < 200; ++k) {
+        erased                  += k % 7;
+    }
+    ASSERT_EQ (tree.erase_range ({100, 0}, {200, 0}), (size_t)100);
+
+    ASSERT_EQ (tree.check_balance (), true);
+    ASSERT_EQ (tree.aggregate ({0, 0}, {INT32_MAX, 0}), total + 20'000 - erased);
+    ASSERT_EQ (tree.aggregate ({1'000, 0}, {1'199, 0}), 20'000);
+
+    // a copy keeps the summaries of the nodes it copies
+    tree_t                      cpy     (tree, 4);
+
+    ASSERT_EQ (cpy.check_balance (), true);
+    ASSERT_EQ (cpy.aggregate ({0, 0}, {INT32_MAX, 0}), total + 20'000 - erased);
+}
+
+/**
+ * @brief                       Checks the intervals overlapping many query intervals (and containing many points) against a scan of all intervals
+ *
+ * @param pTree                 Reference to the tree
+ * @param pIntervals            The intervals the tree should hold
+ * @param pRange                Query intervals start in [-10, pRange + 10)
+ */
+template <typename tree_t>
+void
+check_intervals (const tree_t & pTree, const std::set<AgAVLInterval<int32_t>> & pIntervals, int32_t pRange)
+{
+    using iter_t                = typename tree_t::iterator;
+
+    ASSERT_EQ (pTree.size (), pIntervals.size ());
+
+    for (int32_t lo = -10; lo < pRange + 10; lo += 3) {
+        for (int32_t hi = lo - 1; hi < lo + 40; hi += 7) {
+
+            std::vector<AgAVLInterval<int32_t>> expected;
+            std::vector<iter_t>                 found;
+
+            for (auto & e : pIntervals) {
+                if (lo <= hi && e.mStart <= hi && lo <= e.mEnd) {
+                    expected.push_back (e);
+                }
+            }
+            pTree.overlapping (lo, hi, std::back_inserter (found));
+
+            // overlapping intervals are reported in order, and the first one is also found on its own
+            ASSERT_EQ (found.size (), expected.size ());
+            for (size_t i = 0; i < found.size (); ++i) {
+                ASSERT_EQ (*found[i] == expected[i], true);
+            }
+            ASSERT_EQ (pTree.find_overlapping (lo, hi) == ((found.empty ()) ? (pTree.end ()) : (found[0])), true);
+        }
+
+        size_t                  cnt     {0};
+        std::vector<iter_t>     found;
+
+        for (auto & e : pIntervals) {
+            cnt                 += (e.mStart <= lo && lo <= e.mEnd);
+        }
+        pTree.stabbing (lo, std::back_inserter (found));
+
+        ASSERT_EQ (found.size (), cnt);
+    }
+}
+
+/**
+ * @brief   Test finding overlapping intervals, after random insertions and erasures of short and long intervals
+ *
+ */
+TEST (Intervals, overlapping_against_scan)
+{
+    std::mt19937                gen (22);
+    std::set<AgAVLInterval<int32_t>>    intervals;
+    AgAVLIntervalTree<int32_t>  tree;
+
+    constexpr   int32_t         range   {1'000};
+
+    ASSERT_EQ (tree.find_overlapping (0, range) == tree.end (), true);
+
+    for (int32_t round = 0; round < 10; ++round) {
+
+        for (int32_t i = 0; i < 100; ++i) {
+            int32_t             start   {(int32_t)(gen () % range)};
+            int32_t             len     {(int32_t)((i % 10 == 0) ? (gen () % range) : (gen () % 20))};
+
+            ASSERT_EQ (tree.insert ({start, start + len}), intervals.insert ({start, start + len}).second);
+        }
+        for (int32_t i = 0; i < 50; ++i) {
+            auto                it      {std::next (intervals.begin (), gen () % intervals.size ())};
+
+            ASSERT_EQ (tree.erase (*it), true);
+            intervals.erase (it);
+        }
+
+        ASSERT_EQ (tree.check_balance (), true);
+        check_intervals (tree, intervals, range);
+    }
+
+    // the largest ends are kept up to date when subtrees are moved around
+    AgAVLIntervalTree<int32_t>  right   {tree.split ({range / 2, 0})};
+    std::set<AgAVLInterval<int32_t>>    low     (intervals.begin (), intervals.lower_bound ({range / 2, 0}));
+    std::set<AgAVLInterval<int32_t>>    high    (intervals.lower_bound ({range / 2, 0}), intervals.end ());
+
+    check_intervals (tree, low, range);
+    check_intervals (right, high, range);
+
+    ASSERT_EQ (tree.join (std::move (right)), true);
+    ASSERT_EQ (tree.erase_range ({100, 0}, {200, 0}), (size_t)std::distance (intervals.lower_bound ({100, 0}), intervals.lower_bound ({200, 0})));
+    intervals.erase (intervals.lower_bound ({100, 0}), intervals.lower_bound ({200, 0}));
+
+    ASSERT_EQ (tree.check_balance (), true);
+    check_intervals (tree, intervals, range);
+}
+
+/**
+ * @brief                       A train which stays at a station between its arrival and its departure
+ */
+struct Stay {
+
+    int32_t     mArrival;
+    int32_t     mDeparture;
+    int32_t     mId;
+
+    friend bool operator<  (const Stay & pA, const Stay & pB) { return (pA.mArrival != pB.mArrival) ? (pA.mArrival < pB.mArrival) : (pA.mId < pB.mId); }
+    friend bool operator== (const Stay & pA, const Stay & pB) { return pA.mArrival == pB.mArrival && pA.mId == pB.mId; }
+};
+
+/**
+ * @brief                       Returns the arrival of a train
+ */
+int32_t
+arrival_of (const Stay & pVal)
+{
+    return pVal.mArrival;
+}
+
+/**
+ * @brief                       Returns the departure of a train
+ */
+int32_t
+departure_of (const Stay & pVal)
+{
+    return pVal.mDeparture;
+}
+
+/**
+ * @brief   Test finding overlapping intervals of a custom type, whose ends are given by functions
+ *
+ */
+TEST (Intervals, custom_interval_type)
+{
+    AgAVLTreeAugmented<Stay, AgAVLMaxEnd<Stay, int32_t, arrival_of, departure_of>>  tree;
+
+    std::vector<int32_t>        ids;
+
+    insert (tree, Stay {900, 930, 1}, Stay {905, 1'000, 2}, Stay {915, 920, 3}, Stay {940, 945, 4}, Stay {1'010, 1'200, 5}, Stay {1'100, 1'105, 6});
+
+    // trains at the station at 9:25
+    {
+        std::vector<decltype (tree.end ())> found;
+
+        tree.stabbing (925, std::back_inserter (found));
+        for (auto & it : found) {
+            ids.push_back ((*it).mId);
+        }
+        ASSERT_EQ (ids, (std::vector<int32_t> {1, 2}));
+    }
+
+    // trains at the station at some point between 9:40 and 10:10
+    ids.clear ();
+    {
+        std::vector<decltype (tree.end ())> found;
+
+        tree.overlapping (940, 1'010, std::back_inserter (found));
+        for (auto & it : found) {
+            ids.push_back ((*it).mId);
+        }
+        ASSERT_EQ (ids, (std::vector<int32_t> {2, 4, 5}));
+    }
+
+    ASSERT_EQ ((*tree.find_overlapping (1'001, 1'010)).mId, 5);
+    ASSERT_EQ (tree.find_overlapping (1'001, 1'009) == tree.end (), true);
+    ASSERT_EQ (tree.find_overlapping (1'201, 1'300) == tree.end (), true);
+    ASSERT_EQ (tree.find_overlapping (950, 940) == tree.end (), true);
+}
+
+/**
+ * @brief                       Returns the weight of a value (its remainder modulo 4, so that a quarter of the values can never be picked)
+ */
+int64_t
+weight_mod_4 (const int32_t & pVal)
+{
+    return pVal % 4;
+}
+
+/**
+ * @brief                       Returns the weight of a value as a floating point number (its remainder modulo 4)
+ */
+double
+real_weight_mod_4 (const int32_t & pVal)
+{
+    return pVal % 4;
+}
+
+/**
+ * @brief                       Picks many elements of a tree of [0, 100) at random, one at a time and in a batch, and checks how often each was picked
+ *
+ * @tparam weighted             Whether elements are picked in proportion to their weights (value modulo 4), or uniformly
+ *
+ * @param pTree                 Reference to the tree
+ */
+template <bool weighted, typename tree_t>
+void
+check_samples (const tree_t & pTree)
+{
+    using iter_t                = typename tree_t::iterator;
+
+    constexpr   int32_t         draws   {150'000};
+
+    std::mt19937                gen1    (23);
+    std::mt19937                gen2    (23);
+
+    std::vector<int32_t>        single;
+    std::vector<iter_t>         batch;
+
+    for (int32_t i = 0; i < draws; ++i) {
+        iter_t                  it;
+
+        if constexpr (weighted) {
+            it                  = pTree.sample_weighted (gen1);
+        }
+        else {
+            it                  = pTree.sample (gen1);
+        }
+        ASSERT_EQ (it != pTree.end (), true);
+        single.push_back (*it);
+    }
+
+    // a batch draws the same offsets, and writes the picked elements in order
+    if constexpr (weighted) {
+        pTree.sample_weighted (gen2, draws, std::back_inserter (batch));
+    }
+    else {
+        pTree.sample (gen2, draws, std::back_inserter (batch));
+    }
+
+    std::sort (single.begin (), single.end ());
+
+    ASSERT_EQ (batch.size (), single.size ());
+    for (size_t i = 0; i < batch.size (); ++i) {
+        ASSERT_EQ (*batch[i], single[i]);
+    }
+
+    // each element is picked about as often as expected (within 6 standard deviations)
+    std::vector<int32_t>        cnt     (100);
+
+    for (auto v : single) {
+        ++cnt[v];
+    }
+    for (int32_t v = 0; v < 100; ++v) {
+        double                  p       {(weighted) ? ((v % 4) / 150.0) : (1 / 100.0)};
+        double                  sd      {std::sqrt (draws * p * (1 - p))};
+
+        ASSERT_LE (std::abs (cnt[v] - draws * p), 6 * sd + 1);
+    }
+}
+
+/**
+ * @brief   Test picking elements uniformly at random (one at a time and in batches)
+ *
+ */
+TEST (Sampling, uniform)
+{
+    std::vector<int32_t>        values;
+
+    for (int32_t v = 0; v < 100; ++v) {
+        values.push_back (v);
+    }
+
+    AgAVLTreeCounted<int32_t>   tree    (values.begin (), values.end ());
+    AgAVLTree<int32_t>          plain   (values.begin (), values.end ());
+    std::mt19937                gen     (23);
+
+    check_samples<false> (tree);
+    check_samples<false> (plain);
+
+    // nothing can be picked from an empty tree
+    AgAVLTreeCounted<int32_t>   empty;
+    std::vector<AgAVLTreeCounted<int32_t>::iterator>    found;
+
+    ASSERT_EQ (empty.sample (gen) == empty.end (), true);
+    empty.sample (gen, 10, std::back_inserter (found));
+    ASSERT_EQ (found.empty (), true);
+}
+
+/**
+ * @brief   Test picking elements at random in proportion to their weights (one at a time and in batches), with integral and floating point weights
+ *
+ */
+TEST (Sampling, weighted)
+{
+    AgAVLTreeWeighted<int32_t, int64_t, weight_mod_4>       tree;
+    AgAVLTreeWeighted<int32_t, double, real_weight_mod_4>   real;
+
+    // inserted in a scattered order, so that the weights are combined through rotations
+    for (int32_t i = 0; i < 100; ++i) {
+        ASSERT_EQ (tree.insert ((i * 37) % 100), true);
+        ASSERT_EQ (real.insert ((i * 37) % 100), true);
+    }
+    ASSERT_EQ (tree.check_balance (), true);
+
+    check_samples<true> (tree);
+    check_samples<true> (real);
+
+    // elements keep being picked in proportion to their weights after some are erased
+    std::mt19937                gen     (23);
+
+    ASSERT_EQ (tree.erase_range (0, 99), (size_t)99);
+    for (int32_t i = 0; i < 100; ++i) {
+        ASSERT_EQ (*tree.sample_weighted (gen), 99);
+    }
+
+    // nothing can be picked if no element has any weight
+    ASSERT_EQ (tree.erase (99), true);
+    ASSERT_EQ (tree.insert (4), true);
+    ASSERT_EQ (tree.sample_weighted (gen) == tree.end (), true);
+}
+
+/**
+ * @brief                       Shifts the values of a sorted set which lie in a range, as shift_range should (if they keep their order)
+ *
+ * @param pValues               Reference to the set
+ * @param pLo                   The smallest value to be shifted
+ * @param pHi                   The largest value to be shifted
+ * @param pDelta                Constant added to the values
+ *
+ * @return true                 If the values were shifted
+ * @return false                If a shifted value would pass a value outside the range (the set is not changed)
+ */
+bool
+shift_values (std::set<int32_t> & pValues, int32_t pLo, int32_t pHi, int32_t pDelta)
+{
+    auto                        first   {pValues.lower_bound (pLo)};
+    auto                        last    {pValues.upper_bound (pHi)};
+
+    if (first == last) {
+        return true;
+    }
+    if (first != pValues.begin () && *std::prev (first) >= *first + pDelta) {
+        return false;
+    }
+    if (last != pValues.end () && *std::prev (last) + pDelta >= *last) {
+        return false;
+    }
+
+    std::vector<int32_t>        moved   (first, last);
+
+    pValues.erase (first, last);
+    for (auto v : moved) {
+        pValues.insert (v + pDelta);
+    }
+    return true;
+}
+
+/**
+ * @brief                       Shifts random ranges of a tree, mixed with insertions and erasures, checking the elements (and iterators held
+ *                              across the shifts) after every round
+ */
+template <typename tree_t>
+void
+check_shifted_tree ()
+{
+    std::mt19937                gen     (24);
+    std::set<int32_t>           values;
+    tree_t                      tree;
+
+    constexpr   int32_t         range   {2'000};
+
+    for (int32_t round = 0; round < 40; ++round) {
+
+        for (int32_t i = 0; i < 50; ++i) {
+            int32_t             v       {(int32_t)(gen () % range)};
+            ASSERT_EQ (tree.insert (v), values.insert (v).second);
+        }
+        for (int32_t i = 0; i < 20; ++i) {
+            int32_t             v       {(int32_t)(gen () % range)};
+            ASSERT_EQ (tree.erase (v), values.erase (v) == 1);
+        }
+
+        // an iterator to the smallest element is held across the shifts, and must follow its element
+        auto                    first   {tree.begin ()};
+        int32_t                 expect  {*first};
+
+        for (int32_t i = 0; i < 5; ++i) {
+            int32_t             lo      {(int32_t)(gen () % range)};
+            int32_t             hi      {lo + (int32_t)(gen () % 500)};
+            int32_t             delta   {(int32_t)(gen () % 41) - 20};
+            bool                shifted {shift_values (values, lo, hi, delta)};
+
+            ASSERT_EQ (tree.shift_range (lo, hi, delta), shifted);
+            expect              += (shifted && expect >= lo && expect <= hi) ? (delta) : (0);
+        }
+
+        ASSERT_EQ (*first, expect);
+        ASSERT_EQ (*++first, *std::next (values.begin ()));
+
+        // modifications push the offsets down and searches add them up on their path, so every value is found where it belongs
+        ASSERT_EQ (tree.check_balance (), true);
+        ASSERT_EQ (tree.size (), values.size ());
+        for (int32_t v = -20; v < range + 20; v += 3) {
+            ASSERT_EQ (tree.exists (v), values.count (v) == 1);
+        }
+
+        auto                    it      {tree.begin ()};
+        for (auto v : values) {
+            ASSERT_EQ (*it, v);
+            ++it;
+        }
+        ASSERT_EQ (it == tree.end (), true);
+    }
+}
+
+/**
+ * @brief   Test shifting ranges of values, lazily in shiftable trees and one element at a time in others
+ *
+ */
+TEST (Shift, shift_range_against_std_set)
+{
+    check_shifted_tree<AgAVLTreeShiftable<int32_t>> ();
+    check_shifted_tree<AgAVLTreeShiftable<int32_t, ag_avl_default_comp<int32_t>, ag_avl_default_equals<int32_t>, std::allocator<int32_t>, true, true>> ();
+    check_shifted_tree<AgAVLTree<int32_t>> ();
+
+    AgAVLTreeShiftable<int32_t> tree;
+
+    insert (tree, 10, 20, 30, 40);
+
+    // a range may not be shifted past the elements next to it
+    ASSERT_EQ (tree.shift_range (20, 30, 10), false);
+    ASSERT_EQ (tree.shift_range (20, 30, -10), false);
+    ASSERT_EQ (tree.shift_range (20, 30, 9), true);
+    ASSERT_EQ (tree.exists (39), true);
+    ASSERT_EQ (tree.exists (30), false);
+
+    // an empty range is always shifted, and the ends of the tree can move freely
+    ASSERT_EQ (tree.shift_range (21, 28, 1'000), true);
+    ASSERT_EQ (tree.shift_range (40, 40, 1'000), true);
+    ASSERT_EQ (tree.shift_range (0, 10, -1'000), true);
+    ASSERT_EQ (*tree.begin (), -990);
+    ASSERT_EQ (*tree.rbegin (), 1'040);
+
+    // a shift which would overflow is refused, even with no neighbour to run into
+    AgAVLTreeShiftable<uint32_t>    unsig;
+
+    insert (unsig, 0u, UINT32_MAX - 1);
+    ASSERT_EQ (unsig.shift_range (0u, UINT32_MAX, 10u), false);
+    ASSERT_EQ (unsig.shift_range (0u, UINT32_MAX, 1u), true);
+    ASSERT_EQ (unsig.shift_range (0u, UINT32_MAX, -2), false);
+    ASSERT_EQ (unsig.shift_range (0u, UINT32_MAX, -1), true);
+    ASSERT_EQ (unsig.exists (0u), true);
+    ASSERT_EQ (unsig.exists (UINT32_MAX - 1), true);
+
+    AgAVLTreeShiftable<int32_t> sig;
+
+    insert (sig, 0, INT32_MAX - 5, INT32_MAX - 1);
+    ASSERT_EQ (sig.shift_range (INT32_MAX - 5, INT32_MAX, 10), false);
+    ASSERT_EQ (sig.shift_range (INT32_MIN, 0, INT32_MIN), true);
+    ASSERT_EQ (sig.shift_range (INT32_MIN, 0, -1), false);
+
+    // the offsets kept by the nodes are values themselves, so a wider constant must fit in one even if the results would
+    ASSERT_EQ (sig.shift_range (INT32_MIN, 0, (int64_t)INT32_MAX + 2), false);
+    ASSERT_EQ (*sig.begin (), INT32_MIN);
+    ASSERT_EQ (sig.exists (INT32_MAX - 1), true);
+
+    // floating point values rounded onto each other would no longer be in order
+    AgAVLTreeShiftable<double>  real;
+
+    insert (real, 1.0, 1.0 + 1e-12);
+    ASSERT_EQ (real.shift_range (0.0, 2.0, 1e20), false);
+    ASSERT_EQ (real.exists (1.0), true);
+}
+
+/**
+ * @brief   Test that offsets are carried correctly by the operations which move whole subtrees around, and in trees of other types
+ *
+ */
+TEST (Shift, split_join_set_ops_and_copies)
+{
+    using tree_t                = AgAVLTreeShiftable<int32_t, ag_avl_default_comp<int32_t>, ag_avl_default_equals<int32_t>, std::allocator<int32_t>, false, true>;
+
+    std::vector<int32_t>        values;
+
+    for (int32_t v = 0; v < 1'000; ++v) {
+        values.push_back (2 * v);
+    }
+
+    tree_t                      tree    (values.begin (), values.end ());
+
+    // every value above 1000 moves up by a million (in O(log n)), and the pending offsets are carried along by a split
+    ASSERT_EQ (tree.shift_range (1'001, 2'000, 1'000'000), true);
+    for (auto & v : values) {
+        v                       += (v > 1'000) ? (1'000'000) : (0);
+    }
+
+    tree_t                      right   {tree.split (500'000)};
+    std::vector<int32_t>        low     (values.begin (), values.begin () + 501);
+    std::vector<int32_t>        high    (values.begin () + 501, values.end ());
+
+    ASSERT_EQ (tree.check_balance (), true);
+    ASSERT_EQ (right.check_balance (), true);
+    check_order_statistics (tree, low, 2'000);
+    check_order_statistics (right, high, 2'000);
+
+    // the shifted half is shifted back down, and joined again
+    ASSERT_EQ (right.shift_range (1'000'000, 2'000'000, -999'000), true);
+    ASSERT_EQ (tree.join (std::move (right)), true);
+    for (auto & v : values) {
+        v                       -= (v > 1'000) ? (999'000) : (0);
+    }
+    ASSERT_EQ (tree.check_balance (), true);
+    check_order_statistics (tree, values, 4'000);
+
+    // a copy keeps the pending offsets, and a union takes over the nodes of the other tree along with theirs
+    tree_t                      other;
+
+    for (int32_t v = 0; v < 500; ++v) {
+        other.insert (2 * v + 1);
+    }
+    ASSERT_EQ (other.shift_range (0, 1'000, 4'000), true);
+
+    tree_t                      cpy     (other, 4);
+
+    ASSERT_EQ (tree.set_union (std::move (other), 4), (size_t)500);
+    for (int32_t v = 0; v < 500; ++v) {
+        values.push_back (2 * v + 4'001);
+    }
+    std::sort (values.begin (), values.end ());
+
+    ASSERT_EQ (tree.check_balance (), true);
+    check_order_statistics (tree, values, 6'000);
+
+    ASSERT_EQ (tree.set_difference (cpy, 4), (size_t)500);
+    ASSERT_EQ (tree.check_balance (), true);
+    ASSERT_EQ (tree.count_range (4'001, 5'000), (size_t)0);
+    ASSERT_EQ (tree.size (), (size_t)1'000);
+
+    // floating point values are shifted in the same way
+    AgAVLTreeShiftable<double>  real;
+
+    for (int32_t v = 0; v < 100; ++v) {
+        real.insert (v * 0.5);
+    }
+    ASSERT_EQ (real.shift_range (10.0, 49.5, 0.25), true);
+    ASSERT_EQ (real.exists (10.25), true);
+    ASSERT_EQ (real.exists (49.75), true);
+    ASSERT_EQ (real.exists (10.0), false);
+    ASSERT_EQ (*real.last_smaller_strict (10.25), 9.5);
+}
+
+/**
+ * @brief   Test that const methods only read a shifted tree, so that several threads can search and iterate over it at the same time
+ *
+ */
+TEST (Shift, concurrent_readers)
+{
+    AgAVLTreeShiftable<int32_t> tree;
+    std::vector<int32_t>        values;
+
+    for (int32_t v = 0; v < 20'000; ++v) {
+        values.push_back (3 * v);
+        tree.insert (3 * v);
+    }
+
+    // the offsets stay pending on the upper nodes, and are only added up by the readers
+    ASSERT_EQ (tree.shift_range (30'000, 60'000, 1), true);
+    ASSERT_EQ (tree.shift_range (0, 9'000, -1), true);
+    for (auto & v : values) {
+        v                       += (v >= 30'000) ? (1) : ((v <= 9'000) ? (-1) : (0));
+    }
+
+    std::vector<int32_t>        failures (4, 0);
+    std::vector<std::thread>    readers;
+
+    for (int32_t t = 0; t < 4; ++t) {
+        readers.emplace_back ([&, t] {
+            auto                it      {tree.begin ()};
+            for (auto v : values) {
+                failures[t]     += (*it != v || !tree.exists (v) || *tree.find (v) != v || *tree.first_greater_equals (v - 1) != v);
+                ++it;
+            }
+            failures[t]         += (it != tree.end ());
+        });
+    }
+    for (auto & r : readers) {
+        r.join ();
+    }
+    for (auto f : failures) {
+        ASSERT_EQ (f, 0);
+    }
+
+    // an iterator held across insertions and erasures elsewhere still finds the value of its node
+    auto                        it      {tree.find (30'001)};
+
+    for (int32_t v = 0; v < 9'000; v += 3) {
+        tree.erase (v - 1);
+        tree.insert (v + 1);
+    }
+    ASSERT_EQ (*it, 30'001);
+    ASSERT_EQ (*++it, 30'004);
+    ASSERT_EQ (*--tree.end (), 59'998);
+    ASSERT_EQ (tree.check_balance (), true);
+}
+
+/**
+ * @brief                       Checks that the differences found between two trees are those between two sets holding the same values
+ *
+ * @param pA                    Reference to the first tree
+ * @param pB                    Reference to the second tree
+ * @param pSetA                 Reference to the set holding the values of the first tree
+ * @param pSetB                 Reference to the set holding the values of the second tree
+ */
+template <typename tree_t, typename val_t>
+void
+check_diff (const tree_t & pA, const tree_t & pB, const std::set<val_t> & pSetA, const std::set<val_t> & pSetB)
+{
+    std::vector<val_t>          onlyA;
+    std::vector<val_t>          onlyB;
+    std::vector<val_t>          expectedA;
+    std::vector<val_t>          expectedB;
+
+    std::set_difference (pSetA.begin (), pSetA.end (), pSetB.begin (), pSetB.end (), std::back_inserter (expectedA));
+    std::set_difference (pSetB.begin (), pSetB.end (), pSetA.begin (), pSetA.end (), std::back_inserter (expectedB));
+
+    pA.diff (pB, std::back_inserter (onlyA), std::back_inserter (onlyB));
+    ASSERT_EQ (onlyA, expectedA);
+    ASSERT_EQ (onlyB, expectedB);
+
+    // the same differences are found the other way around
+    onlyA.clear ();
+    onlyB.clear ();
+    pB.diff (pA, std::back_inserter (onlyB), std::back_inserter (onlyA));
+    ASSERT_EQ (onlyA, expectedA);
+    ASSERT_EQ (onlyB, expectedB);
+
+    ASSERT_EQ (pA.fingerprint () == pB.fingerprint (), pSetA == pSetB);
+}
+
+/**
+ * @brief                       Fills two trees with mostly the same random values (inserted in different orders, so that the trees have different
+ *                              shapes), and checks their fingerprints and differences after each round of changes
+ */
+template <typename tree_t>
+void
+check_hashed_trees ()
+{
+    std::mt19937                gen     (31);
+    tree_t                      treeA;
+    tree_t                      treeB;
+    std::set<int32_t>           setA;
+    std::set<int32_t>           setB;
+    std::vector<int32_t>        values;
+
+    for (int32_t v = 0; v < 5'000; ++v) {
+        values.push_back ((int32_t)(gen () % 20'000));
+    }
+    for (auto v : values) {
+        treeA.insert (v);
+        setA.insert (v);
+    }
+    std::shuffle (values.begin (), values.end (), gen);
+    for (auto v : values) {
+        treeB.insert (v);
+        setB.insert (v);
+    }
+
+    check_diff (treeA, treeB, setA, setB);
+
+    for (int32_t round = 0; round < 30; ++round) {
+
+        // a few values are inserted into and erased from either tree, and some are put back right away (which may change the shape)
+        for (int32_t i = 0; i < round; ++i) {
+            int32_t             v       {(int32_t)(gen () % 20'000)};
+
+            switch (gen () % 4) {
+                case 0:     treeA.insert (v);   setA.insert (v);    break;
+                case 1:     treeA.erase (v);    setA.erase (v);     break;
+                case 2:     treeB.insert (v);   setB.insert (v);    break;
+                default:    if (treeB.erase (v)) { treeB.insert (v); } break;
+            }
+        }
+        ASSERT_EQ (treeA.check_balance (), true);
+        ASSERT_EQ (treeB.check_balance (), true);
+        check_diff (treeA, treeB, setA, setB);
+    }
+}
+
+/**
+ * @brief   Test fingerprints and differences of hashed trees against std::set
+ *
+ */
+TEST (Hash, fingerprint_and_diff_against_std_set)
+{
+    check_hashed_trees<AgAVLTreeHashed<int32_t>> ();
+    check_hashed_trees<AgAVLTreeHashed<int32_t, ag_avl_default_hash<int32_t>, ag_avl_default_comp<int32_t>, ag_avl_default_equals<int32_t>, std::allocator<int32_t>, true, true>> ();
+
+    // empty trees have the same fingerprint, and everything in the other tree is missing from an empty one
+    AgAVLTreeHashed<int32_t>    empty;
+    AgAVLTreeHashed<int32_t>    other;
+    std::set<int32_t>           none;
+    std::set<int32_t>           some    {0, 7, 8, 100};
+
+    check_diff (empty, other, none, none);
+    ASSERT_EQ (empty.fingerprint (), (uint64_t)0);
+
+    for (auto v : some) {
+        other.insert (v);
+    }
+    check_diff (empty, other, none, some);
+
+    // a single value (even one hashed to zero) is told apart from no value at all
+    other.erase_range (1, 101);
+    check_diff (empty, other, none, std::set<int32_t> {0});
+}
+
+/**
+ * @brief   Test that hashes are kept up to date by splits, joins, set operations and copies, and that other types of values can be hashed
+ *
+ */
+TEST (Hash, split_join_set_ops_and_strings)
+{
+    AgAVLTreeHashed<int32_t>    tree;
+    AgAVLTreeHashed<int32_t>    reference;
+
+    for (int32_t v = 0; v < 1'000; ++v) {
+        tree.insert (3 * v);
+        reference.insert (3 * (999 - v));
+    }
+
+    uint64_t                    fp      {tree.fingerprint ()};
+
+    ASSERT_EQ (reference.fingerprint (), fp);
+
+    // a split tree hashes to the sum of its parts, and gets its fingerprint back when joined
+    AgAVLTreeHashed<int32_t>    right   {tree.split (1'500)};
+
+    ASSERT_EQ (tree.fingerprint () + right.fingerprint (), fp);
+    ASSERT_EQ (tree.join (std::move (right)), true);
+    ASSERT_EQ (tree.fingerprint (), fp);
+
+    // a union with the values in between, and a difference with them, bring it back again
+    AgAVLTreeHashed<int32_t>    other;
+
+    for (int32_t v = 0; v < 1'000; ++v) {
+        other.insert (3 * v + 1);
+    }
+
+    AgAVLTreeHashed<int32_t>    cpy     (other, 4);
+
+    ASSERT_EQ (tree.set_union (std::move (other), 4), (size_t)1'000);
+    ASSERT_EQ (tree.check_balance (), true);
+    ASSERT_NE (tree.fingerprint (), fp);
+    ASSERT_EQ (tree.set_difference (cpy, 4), (size_t)1'000);
+    ASSERT_EQ (tree.fingerprint (), fp);
+
+    std::vector<int32_t>        onlyHere;
+    std::vector<int32_t>        onlyThere;
+
+    tree.diff (reference, std::back_inserter (onlyHere), std::back_inserter (onlyThere));
+    ASSERT_EQ (onlyHere.empty (), true);
+    ASSERT_EQ (onlyThere.empty (), true);
+
+    // strings are hashed with std::hash
+    AgAVLTreeHashed<std::string>    wordsA;
+    AgAVLTreeHashed<std::string>    wordsB;
+    std::set<std::string>           setA;
+    std::set<std::string>           setB;
+
+    for (int32_t v = 0; v < 500; ++v) {
+        wordsA.insert (std::to_string (v));
+        setA.insert (std::to_string (v));
+    }
+    for (int32_t v = 499; v >= 0; --v) {
+        if (v % 97 != 0) {
+            wordsB.insert (std::to_string (v));
+            setB.insert (std::to_string (v));
+        }
+    }
+    wordsB.insert ("extra");
+    setB.insert ("extra");
+
+    check_diff (wordsA, wordsB, setA, setB);
+}